@@ -1,5 +1,16 @@
 library directory_bookmarks;
 
 export 'src/directory_bookmark_handler.dart';
+export 'src/models/batch_operation.dart';
 export 'src/models/bookmark_data.dart';
+export 'src/models/bookmark_usage.dart';
+export 'src/models/bookmark_validation.dart';
+export 'src/models/file_compression.dart';
+export 'src/models/file_durability.dart';
+export 'src/models/file_listing.dart';
+export 'src/models/file_page.dart';
+export 'src/models/metadata_patch.dart';
+export 'src/models/plugin_stats.dart';
+export 'src/models/search_match.dart';
+export 'src/models/watch_event.dart';
 export 'src/platform/platform_handler.dart';
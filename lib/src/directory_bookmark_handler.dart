@@ -1,10 +1,88 @@
 import 'dart:io';
 import 'dart:typed_data';
 import 'dart:convert';
+import 'models/batch_operation.dart';
 import 'models/bookmark_data.dart';
+import 'models/bookmark_usage.dart';
+import 'models/bookmark_validation.dart';
+import 'models/file_compression.dart';
+import 'models/file_durability.dart';
+import 'models/file_listing.dart';
+import 'models/file_page.dart';
+import 'models/metadata_patch.dart';
+import 'models/plugin_stats.dart';
+import 'models/search_match.dart';
+import 'models/watch_event.dart';
 import 'platform/platform_handler.dart';
 
 class DirectoryBookmarkHandler {
+  // ============================================================================
+  // CONFIGURATION
+  // ============================================================================
+
+  /// Configure how the native plugin executes calls
+  ///
+  /// [asyncDispatch] runs method calls on a native worker pool instead of the
+  /// platform thread. Calls for the same bookmark identifier still complete
+  /// in the order they were made; calls for different bookmarks may overlap.
+  /// [workerThreads] bounds the size of that pool.
+  ///
+  /// [journal] switches bookmark persistence to an append-only log: each
+  /// mutation appends one record instead of rewriting the whole store, and
+  /// the log is folded back into `bookmarks.json` in the background once it
+  /// exceeds [journalMaxRecords] records or [journalMaxBytes] bytes.
+  ///
+  /// [snapshotFormat] is `'json'` (the default `bookmarks.json`) or
+  /// `'binary'`, a compact `bookmarks.bin` that loads lazily and so starts
+  /// faster with many bookmarks. Changing it migrates the existing snapshot.
+  ///
+  /// [writeBehindMs] enables write-behind: bookmark changes apply in memory
+  /// immediately and are written together once that many milliseconds have
+  /// passed since the first of them. Pass `sync: true` to a mutating call, or
+  /// call [flush], when a change must be on disk before continuing. `0`
+  /// turns write-behind off and writes anything still queued.
+  ///
+  /// [multiProcess] coordinates the store with other processes (another
+  /// instance of the app, or a helper) that also enable it. Writers lock
+  /// `bookmarks.lock` while they change the store, and every write bumps a
+  /// generation counter shared through that file, so readers use their
+  /// in-memory copy until the counter moves. Changes are always written
+  /// immediately in this mode; [writeBehindMs] is ignored.
+  ///
+  /// [validationTtlMs] is how long results of [validateBookmarks] are reused
+  /// by file operations and [hasWritePermission] (default 30000).
+  ///
+  /// [durability] is the default for file writes that don't pass their own
+  /// (initially [FileDurability.none]). [FileDurability.durable] also makes
+  /// bookmark store writes flush to disk before they are reported done.
+  ///
+  /// Currently only honored on Linux; other platforms ignore it.
+  static Future<void> configure({
+    bool? asyncDispatch,
+    int? workerThreads,
+    bool? journal,
+    int? journalMaxRecords,
+    int? journalMaxBytes,
+    String? snapshotFormat,
+    int? writeBehindMs,
+    bool? multiProcess,
+    int? validationTtlMs,
+    FileDurability? durability,
+  }) async {
+    return PlatformHandler.configure({
+      if (asyncDispatch != null) 'asyncDispatch': asyncDispatch,
+      if (workerThreads != null) 'workerThreads': workerThreads,
+      if (journal != null) 'journal': journal,
+      if (journalMaxRecords != null) 'journalMaxRecords': journalMaxRecords,
+      if (journalMaxBytes != null) 'journalMaxBytes': journalMaxBytes,
+      if (snapshotFormat != null) 'snapshotFormat': snapshotFormat,
+      if (writeBehindMs != null) 'writeBehindMs': writeBehindMs,
+      if (multiProcess != null) 'multiProcess': multiProcess,
+      if (validationTtlMs != null) 'validationTtlMs': validationTtlMs,
+      if (durability != null) 'durability': durability.name,
+    });
+  }
+
   // ============================================================================
   // BOOKMARK MANAGEMENT
   // ============================================================================
@@ -14,10 +92,14 @@ class DirectoryBookmarkHandler {
   /// Returns the identifier on success, null on failure
   /// Throws [DirectoryNotFoundException] if directory doesn't exist
   /// Throws [BookmarkAlreadyExistsException] if identifier is already used
+  ///
+  /// [sync] writes the change to disk before returning even in write-behind
+  /// mode (see [configure])
   static Future<String?> createBookmark(
     String identifier,
     String directoryPath, {
     Map<String, dynamic>? metadata,
+    bool sync = false,
   }) async {
     if (!await Directory(directoryPath).exists()) {
       throw DirectoryNotFoundException(
@@ -34,14 +116,38 @@ class DirectoryBookmarkHandler {
       identifier,
       directoryPath,
       metadata: metadata,
+      sync: sync,
     );
   }
 
   /// List all bookmarks
   ///
   /// Returns list of BookmarkData objects, empty list if none exist
-  static Future<List<BookmarkData>> listBookmarks() async {
-    return PlatformHandler.listBookmarks();
+  ///
+  /// On Linux the list can be narrowed natively so only the page being
+  /// displayed crosses the channel:
+  /// - [where] keeps bookmarks whose metadata has all the given key/value
+  ///   pairs
+  /// - [sortBy] is `'identifier'` (default) or `'createdAt'`
+  /// - [offset] and [limit] select a page of the sorted matches
+  /// - [fields] lists which of `'identifier'`, `'path'`, `'createdAt'` and
+  ///   `'metadata'` to return; the rest are left empty in [BookmarkData]
+  static Future<List<BookmarkData>> listBookmarks({
+    Map<String, Object?>? where,
+    String? sortBy,
+    bool descending = false,
+    int? offset,
+    int? limit,
+    List<String>? fields,
+  }) async {
+    return PlatformHandler.listBookmarks(
+      where: where,
+      sortBy: sortBy,
+      descending: descending,
+      offset: offset,
+      limit: limit,
+      fields: fields,
+    );
   }
 
   /// Get a specific bookmark by identifier
@@ -51,6 +157,24 @@ class DirectoryBookmarkHandler {
     return PlatformHandler.getBookmark(identifier);
   }
 
+  /// Find the bookmark for exactly [path]
+  ///
+  /// Paths are compared after lexical normalization (`.`, `..` and
+  /// duplicate or trailing slashes), without resolving symlinks.
+  /// Returns null if no bookmark points at that directory.
+  static Future<BookmarkData?> findBookmarkByPath(String path) async {
+    return PlatformHandler.findBookmarkByPath(path);
+  }
+
+  /// Find the bookmark whose directory contains [path]
+  ///
+  /// When bookmarks are nested, the deepest one wins. [path] may name a
+  /// file or directory and does not have to exist.
+  /// Returns null if no bookmark contains it.
+  static Future<BookmarkData?> findContainingBookmark(String path) async {
+    return PlatformHandler.findContainingBookmark(path);
+  }
+
   /// Check if a bookmark exists
   static Future<bool> bookmarkExists(String identifier) async {
     return PlatformHandler.bookmarkExists(identifier);
@@ -59,19 +183,92 @@ class DirectoryBookmarkHandler {
   /// Delete a bookmark
   ///
   /// Returns true if deleted, false if not found or deletion failed
-  static Future<bool> deleteBookmark(String identifier) async {
-    return PlatformHandler.deleteBookmark(identifier);
+  /// [sync] bypasses write-behind for this change (see [configure])
+  static Future<bool> deleteBookmark(
+    String identifier, {
+    bool sync = false,
+  }) async {
+    return PlatformHandler.deleteBookmark(identifier, sync: sync);
   }
 
   /// Update bookmark metadata
   ///
   /// Returns true on success, false if bookmark not found or update failed
   /// Note: Does NOT change the bookmarked path, only metadata
+  /// [sync] bypasses write-behind for this change (see [configure])
   static Future<bool> updateBookmarkMetadata(
     String identifier,
-    Map<String, dynamic> metadata,
-  ) async {
-    return PlatformHandler.updateBookmarkMetadata(identifier, metadata);
+    Map<String, dynamic> metadata, {
+    bool sync = false,
+  }) async {
+    return PlatformHandler.updateBookmarkMetadata(identifier, metadata,
+        sync: sync);
+  }
+
+  /// Change individual metadata keys without resending the whole object (Linux)
+  ///
+  /// The [operations] apply in order, and all of them or none: if one is
+  /// invalid (for example incrementing a non-numeric value) a
+  /// `PlatformException` with code `INVALID_ARGUMENT` is thrown and the
+  /// metadata is unchanged.
+  ///
+  /// ```dart
+  /// await DirectoryBookmarkHandler.patchBookmarkMetadata('docs', [
+  ///   MetadataPatch.increment('openCount'),
+  ///   MetadataPatch.set('lastOpened', {'at': now, 'by': user}),
+  ///   MetadataPatch.remove('draft'),
+  /// ]);
+  /// ```
+  ///
+  /// Returns false if the bookmark does not exist or the change could not be
+  /// saved. [sync] bypasses write-behind for this change (see [configure])
+  static Future<bool> patchBookmarkMetadata(
+    String identifier,
+    List<MetadataPatch> operations, {
+    bool sync = false,
+  }) async {
+    return PlatformHandler.patchBookmarkMetadata(identifier, operations,
+        sync: sync);
+  }
+
+  /// Check every bookmarked directory at once (Linux)
+  ///
+  /// Existence, writability and device are probed concurrently, each given
+  /// [timeout] (default 2 seconds), so a dead mount costs at most that long
+  /// instead of hanging startup. Results younger than [maxAge] are reused.
+  /// For `validationTtlMs` (see [configure]) afterwards, file operations
+  /// fail fast on directories found missing or unresponsive, and
+  /// [hasWritePermission] answers from the result.
+  ///
+  /// Returns a result per bookmark identifier.
+  static Future<Map<String, BookmarkValidation>> validateBookmarks({
+    Duration? timeout,
+    Duration? maxAge,
+  }) async {
+    return PlatformHandler.validateBookmarks(timeout: timeout, maxAge: maxAge);
+  }
+
+  /// Write bookmark changes still queued by write-behind mode
+  ///
+  /// Returns true once everything queued is on disk. A no-op when
+  /// write-behind is off or on platforms other than Linux.
+  static Future<bool> flush() async {
+    return PlatformHandler.flush();
+  }
+
+  /// Native call statistics since the last [resetStats] (Linux)
+  ///
+  /// Reports call counts, errors and latency percentiles per method, time
+  /// spent loading and writing the bookmark store, and file bytes moved.
+  /// Use it to tell whether a slow screen waits on store parsing, store
+  /// writes or file I/O.
+  static Future<PluginStats> getStats() async {
+    return PlatformHandler.getStats();
+  }
+
+  /// Clear the statistics reported by [getStats] (Linux)
+  static Future<bool> resetStats() async {
+    return PlatformHandler.resetStats();
   }
 
   // ============================================================================
@@ -80,14 +277,24 @@ class DirectoryBookmarkHandler {
 
   /// Save file to the specified bookmarked directory
   ///
+  /// With [compression] the data is compressed natively on its way to disk,
+  /// which cuts I/O on slow storage for text-heavy files; read it back with
+  /// the same [compression]. [compressionLevel] ranges from 1 (fastest) to
+  /// 9 (smallest).
+  /// [durability] overrides the default set with [configure]: atomic writes
+  /// never leave a partial file behind, durable ones are also on disk when
+  /// the call returns.
   /// Automatically requests write permission if needed
   /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
   /// Throws [PermissionDeniedException] if write permission denied
   static Future<bool> saveFile(
     String identifier,
     String fileName,
-    List<int> data,
-  ) async {
+    List<int> data, {
+    FileCompression compression = FileCompression.none,
+    int? compressionLevel,
+    FileDurability? durability,
+  }) async {
     if (!await hasWritePermission(identifier)) {
       final hasPermission = await requestWritePermission(identifier);
       if (!hasPermission) {
@@ -95,45 +302,142 @@ class DirectoryBookmarkHandler {
             'Write permission denied for bookmark "$identifier"');
       }
     }
-    return PlatformHandler.saveFile(identifier, fileName, data);
+    return PlatformHandler.saveFile(identifier, fileName, data,
+        compression: compression,
+        compressionLevel: compressionLevel,
+        durability: durability);
   }
 
   /// Save string content to a file
   static Future<bool> saveStringToFile(
     String identifier,
     String fileName,
-    String content,
-  ) async {
+    String content, {
+    FileCompression compression = FileCompression.none,
+    int? compressionLevel,
+    FileDurability? durability,
+  }) async {
     final data = utf8.encode(content);
-    return saveFile(identifier, fileName, data);
+    return saveFile(identifier, fileName, data,
+        compression: compression,
+        compressionLevel: compressionLevel,
+        durability: durability);
   }
 
   /// Save bytes to a file
   static Future<bool> saveBytesToFile(
     String identifier,
     String fileName,
-    Uint8List bytes,
-  ) async {
-    return saveFile(identifier, fileName, bytes);
+    Uint8List bytes, {
+    FileCompression compression = FileCompression.none,
+    int? compressionLevel,
+    FileDurability? durability,
+  }) async {
+    return saveFile(identifier, fileName, bytes,
+        compression: compression,
+        compressionLevel: compressionLevel,
+        durability: durability);
+  }
+
+  /// Save a stream of bytes to a file without buffering it in memory
+  ///
+  /// Chunks are written to a temporary file as they arrive and published
+  /// atomically once the stream completes, so readers never observe a
+  /// partially written file. If the stream fails the target is left untouched.
+  /// Pass [expectedSize] when known to let the native side preallocate space.
+  /// With [FileDurability.durable] the file is flushed to disk on commit.
+  /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
+  /// Throws [PermissionDeniedException] if write permission denied
+  static Future<bool> saveFileFromStream(
+    String identifier,
+    String fileName,
+    Stream<List<int>> data, {
+    int? expectedSize,
+    FileDurability? durability,
+  }) async {
+    final session = await beginWrite(
+      identifier,
+      fileName,
+      expectedSize: expectedSize,
+      durability: durability,
+    );
+    try {
+      await for (final chunk in data) {
+        await appendChunk(session, chunk);
+      }
+    } catch (_) {
+      await abortWrite(session);
+      rethrow;
+    }
+    return commitWrite(session);
+  }
+
+  /// Start a streaming write session for a file
+  ///
+  /// Returns a session handle for [appendChunk], [commitWrite] and
+  /// [abortWrite]. Nothing is visible under [fileName] until the session is
+  /// committed. Sessions are always atomic; [FileDurability.durable] also
+  /// flushes the file to disk on commit.
+  /// On Linux a session left idle for five minutes is discarded, and at most
+  /// 64 sessions can be open at once.
+  /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
+  /// Throws [PermissionDeniedException] if write permission denied
+  static Future<int> beginWrite(
+    String identifier,
+    String fileName, {
+    int? expectedSize,
+    FileDurability? durability,
+  }) async {
+    return PlatformHandler.beginWrite(
+      identifier,
+      fileName,
+      expectedSize: expectedSize,
+      durability: durability,
+    );
+  }
+
+  /// Append bytes to a write session
+  ///
+  /// Returns the total number of bytes written to the session so far
+  static Future<int> appendChunk(int session, List<int> data) async {
+    return PlatformHandler.appendChunk(session, data);
+  }
+
+  /// Atomically replace the target file with the session's contents
+  static Future<bool> commitWrite(int session) async {
+    return PlatformHandler.commitWrite(session);
+  }
+
+  /// Discard a write session
+  ///
+  /// Returns false if the session was already committed or aborted
+  static Future<bool> abortWrite(int session) async {
+    return PlatformHandler.abortWrite(session);
   }
 
   /// Read file from the specified bookmarked directory
   ///
+  /// Pass the [compression] the file was saved with to get its original
+  /// contents back.
   /// Returns file data or null if file not found
   /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
   static Future<List<int>?> readFile(
     String identifier,
-    String fileName,
-  ) async {
-    return PlatformHandler.readFile(identifier, fileName);
+    String fileName, {
+    FileCompression compression = FileCompression.none,
+  }) async {
+    return PlatformHandler.readFile(identifier, fileName,
+        compression: compression);
   }
 
   /// Read string content from a file
   static Future<String?> readStringFromFile(
     String identifier,
-    String fileName,
-  ) async {
-    final bytes = await readFile(identifier, fileName);
+    String fileName, {
+    FileCompression compression = FileCompression.none,
+  }) async {
+    final bytes =
+        await readFile(identifier, fileName, compression: compression);
     if (bytes == null) return null;
     return String.fromCharCodes(bytes);
   }
@@ -141,13 +445,84 @@ class DirectoryBookmarkHandler {
   /// Read bytes from a file
   static Future<Uint8List?> readBytesFromFile(
     String identifier,
-    String fileName,
-  ) async {
-    final bytes = await readFile(identifier, fileName);
+    String fileName, {
+    FileCompression compression = FileCompression.none,
+  }) async {
+    final bytes =
+        await readFile(identifier, fileName, compression: compression);
     if (bytes == null) return null;
     return Uint8List.fromList(bytes);
   }
 
+  /// Read part of a file without loading the whole file into memory
+  ///
+  /// Returns up to [length] bytes starting at [offset]; fewer bytes are
+  /// returned when the range extends past the end of the file.
+  /// Returns null if the file is not found
+  /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
+  static Future<Uint8List?> readFileRange(
+    String identifier,
+    String fileName,
+    int offset,
+    int length,
+  ) async {
+    return PlatformHandler.readFileRange(identifier, fileName, offset, length);
+  }
+
+  /// Read many files at once
+  ///
+  /// Returns the contents keyed by file name, with null for files that do
+  /// not exist. The files are opened, read and closed in batches through
+  /// io_uring where the kernel supports it, otherwise on a few threads.
+  /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
+  /// Throws [PermissionDeniedException] if any existing file cannot be read
+  static Future<Map<String, Uint8List?>> readFiles(
+    String identifier,
+    List<String> fileNames,
+  ) async {
+    return PlatformHandler.readFiles(identifier, fileNames);
+  }
+
+  /// Write many files at once
+  ///
+  /// [files] maps file names to their new contents. Returns whether each
+  /// file was written; files are independent, so one failure does not undo
+  /// the others. Batched like [readFiles]. A [FileDurability.durable] batch
+  /// is flushed to disk with one sync per filesystem rather than per file.
+  /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
+  static Future<Map<String, bool>> saveFiles(
+    String identifier,
+    Map<String, Uint8List> files, {
+    FileDurability? durability,
+  }) async {
+    return PlatformHandler.saveFiles(identifier, files, durability: durability);
+  }
+
+  /// Stream a file in chunks of at most [chunkSize] bytes
+  ///
+  /// Native memory stays bounded by the chunk size regardless of file size.
+  /// Optionally restrict the stream to [length] bytes starting at [offset].
+  /// With [compression] the file is decompressed as it streams, and
+  /// [offset] and [length] count decompressed bytes.
+  /// Cancelling the subscription stops the native read.
+  static Stream<Uint8List> readFileStream(
+    String identifier,
+    String fileName, {
+    int? chunkSize,
+    int? offset,
+    int? length,
+    FileCompression compression = FileCompression.none,
+  }) {
+    return PlatformHandler.readFileStream(
+      identifier,
+      fileName,
+      chunkSize: chunkSize,
+      offset: offset,
+      length: length,
+      compression: compression,
+    );
+  }
+
   /// List all files in the specified bookmarked directory
   ///
   /// Returns list of file names, empty list if directory is empty
@@ -157,6 +532,147 @@ class DirectoryBookmarkHandler {
     return files ?? [];
   }
 
+  /// List files in the specified bookmarked directory one page at a time
+  ///
+  /// Pass the [FilePage.cursor] of the previous page as [cursor] to continue;
+  /// it is null once the listing is complete. [limit] caps the page size
+  /// (default 1000). Applies the same filtering as [listFiles], in directory
+  /// order, so it suits very large directories and virtualized lists.
+  /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
+  static Future<FilePage> listFilesPaged(
+    String identifier, {
+    String? cursor,
+    int? limit,
+  }) async {
+    return PlatformHandler.listFilesPaged(identifier,
+        cursor: cursor, limit: limit);
+  }
+
+  /// Measure the space used below a bookmarked directory (Linux)
+  ///
+  /// Walks the whole tree natively in parallel and returns total and
+  /// allocated bytes, file and directory counts, and the [largest] files
+  /// (default 10, at most 32). Symlinks are neither counted nor followed.
+  ///
+  /// Per-directory results are cached, so repeat calls only read
+  /// directories whose contents changed. While a [watchBookmark] stream
+  /// covers a directory, it is trusted until a change is reported in it;
+  /// otherwise it is read again when its modification time changes, which
+  /// misses files rewritten in place. [refresh] ignores the cache.
+  /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
+  static Future<BookmarkUsage> getBookmarkUsage(
+    String identifier, {
+    int? largest,
+    bool refresh = false,
+  }) async {
+    return PlatformHandler.getBookmarkUsage(identifier,
+        largest: largest, refresh: refresh);
+  }
+
+  /// Recursively list files below a bookmarked directory
+  ///
+  /// Emits batches of paths relative to the bookmark as they are found,
+  /// in no particular order. Subdirectories are read in parallel natively.
+  ///
+  /// [pattern] is a glob: `*`, `?` and `[...]` match within one path
+  /// component and `**` spans directories. A pattern without `/` is matched
+  /// against file names (`*.jpg`), otherwise against the relative path
+  /// (`photos/**/*.jpg`). [maxDepth] limits how many directory levels below
+  /// the bookmark are entered (`0` lists only the bookmark itself). Hidden
+  /// files and directories are skipped unless [includeHidden] is set.
+  /// Symlinks to files are reported; symlinks to directories are only
+  /// followed with [followLinks], and every directory is visited at most
+  /// once so link cycles terminate.
+  ///
+  /// Cancelling the subscription stops the walk.
+  static Stream<List<String>> walkFiles(
+    String identifier, {
+    String? pattern,
+    int? maxDepth,
+    bool includeHidden = false,
+    bool followLinks = false,
+  }) {
+    return PlatformHandler.walkFiles(
+      identifier,
+      pattern: pattern,
+      maxDepth: maxDepth,
+      includeHidden: includeHidden,
+      followLinks: followLinks,
+    );
+  }
+
+  /// Search the contents of files in a bookmarked directory
+  ///
+  /// Emits batches of matches as they are found, in no particular order
+  /// across files. Files are scanned natively in parallel, so their
+  /// contents never cross the platform channel. By default only files
+  /// directly in the bookmark are searched; [recursive] descends into
+  /// subdirectories. Symlinks are never followed, to files or directories.
+  /// Hidden files are skipped unless [includeHidden] is set, and files that
+  /// look binary (a NUL byte near the start) are always skipped.
+  ///
+  /// [query] is matched as a plain substring of the file bytes;
+  /// [caseInsensitive] folds ASCII letters only. The search stops once
+  /// [maxResults] matches have been reported.
+  ///
+  /// Cancelling the subscription stops the search.
+  /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
+  static Stream<List<SearchMatch>> searchFiles(
+    String identifier,
+    String query, {
+    bool recursive = false,
+    int? maxResults,
+    bool caseInsensitive = false,
+    bool includeHidden = false,
+  }) {
+    return PlatformHandler.searchFiles(
+      identifier,
+      query,
+      recursive: recursive,
+      maxResults: maxResults,
+      caseInsensitive: caseInsensitive,
+      includeHidden: includeHidden,
+    );
+  }
+
+  /// Watch a bookmarked directory for changes
+  ///
+  /// Emits lists of [WatchEvent]s with paths relative to the bookmark.
+  /// Changes are coalesced over about 100ms, so bursts of writes arrive as
+  /// one event per file. With [recursive] subdirectories are watched too,
+  /// including ones created later, whose existing contents are reported as
+  /// created. A [WatchEventType.overflow] event means changes were lost and
+  /// the directory should be rescanned.
+  ///
+  /// The stream closes if the bookmarked directory itself is removed or
+  /// moved. Cancelling the subscription stops watching.
+  /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
+  static Stream<List<WatchEvent>> watchBookmark(
+    String identifier, {
+    bool recursive = false,
+  }) {
+    return PlatformHandler.watchBookmark(identifier, recursive: recursive);
+  }
+
+  /// List the entries of a bookmarked directory with size, modification
+  /// time, permission bits and type, in a single call
+  ///
+  /// Unlike [listFiles] this includes directories and other entry types;
+  /// hidden entries are skipped unless [includeHidden] is set. Symlinks are
+  /// described by their target. [cursor] and [limit] page through the
+  /// directory like [listFilesPaged]; without a [limit] everything is
+  /// returned at once.
+  /// Throws [BookmarkNotFoundException] if bookmark doesn't exist
+  static Future<FileListing> listFilesDetailed(
+    String identifier, {
+    bool includeHidden = false,
+    String? cursor,
+    int? limit,
+  }) async {
+    return PlatformHandler.listFilesDetailed(identifier,
+        includeHidden: includeHidden, cursor: cursor, limit: limit);
+  }
+
   /// Delete a file in the bookmarked directory
   ///
   /// Returns true if deleted, false if file not found or deletion failed
@@ -173,6 +689,73 @@ class DirectoryBookmarkHandler {
     return PlatformHandler.deleteFile(identifier, fileName);
   }
 
+  /// Copy a file from one bookmarked directory to another
+  ///
+  /// The bytes never pass through Dart: the native side reflinks the file
+  /// where the filesystem supports it, otherwise copies in the kernel. The
+  /// copy appears under [targetFileName] only once complete. With
+  /// [overwrite] false an existing target fails the call with `FILE_EXISTS`.
+  /// Both bookmarks may be the same.
+  /// Throws [BookmarkNotFoundException] if either bookmark doesn't exist
+  /// Throws [PermissionDeniedException] if the target cannot be written
+  static Future<bool> copyFile(
+    String sourceIdentifier,
+    String sourceFileName,
+    String targetIdentifier,
+    String targetFileName, {
+    bool overwrite = true,
+  }) async {
+    return PlatformHandler.copyFile(
+        sourceIdentifier, sourceFileName, targetIdentifier, targetFileName,
+        overwrite: overwrite);
+  }
+
+  /// Move a file from one bookmarked directory to another
+  ///
+  /// A rename when both are on the same filesystem, so instant regardless
+  /// of size; otherwise a [copyFile] followed by removing the source.
+  /// Throws [BookmarkNotFoundException] if either bookmark doesn't exist
+  /// Throws [PermissionDeniedException] if either directory is read-only
+  static Future<bool> moveFile(
+    String sourceIdentifier,
+    String sourceFileName,
+    String targetIdentifier,
+    String targetFileName, {
+    bool overwrite = true,
+  }) async {
+    return PlatformHandler.moveFile(
+        sourceIdentifier, sourceFileName, targetIdentifier, targetFileName,
+        overwrite: overwrite);
+  }
+
+  /// Compute the digest of a file in the bookmarked directory
+  ///
+  /// The file is read and hashed natively, so its contents never cross the
+  /// channel. [algorithm] is `'sha256'` (default) or `'xxh64'`, a much faster
+  /// non-cryptographic checksum. Returns lowercase hex, or null if the file
+  /// does not exist. Digests are cached until the file's size, mtime or
+  /// ctime changes.
+  /// Throws [BookmarkNotFoundException] if the bookmark doesn't exist
+  static Future<String?> hashFile(
+    String identifier,
+    String fileName, {
+    String algorithm = 'sha256',
+  }) async {
+    return PlatformHandler.hashFile(identifier, fileName, algorithm: algorithm);
+  }
+
+  /// Compute the digests of many files in the bookmarked directory at once
+  ///
+  /// Files are hashed in parallel. Missing files map to null.
+  /// Throws [BookmarkNotFoundException] if the bookmark doesn't exist
+  static Future<Map<String, String?>> hashFiles(
+    String identifier,
+    List<String> fileNames, {
+    String algorithm = 'sha256',
+  }) async {
+    return PlatformHandler.hashFiles(identifier, fileNames, algorithm: algorithm);
+  }
+
   /// Check if a file exists in the bookmarked directory
   static Future<bool> fileExists(
     String identifier,
@@ -181,6 +764,30 @@ class DirectoryBookmarkHandler {
     return PlatformHandler.fileExists(identifier, fileName);
   }
 
+  // ============================================================================
+  // BATCH OPERATIONS
+  // ============================================================================
+
+  /// Execute many bookmark and file operations in one platform call
+  ///
+  /// Each run of consecutive bookmark operations sees one view of the store
+  /// and its changes are saved once; file operations in between run without
+  /// holding the store, so they don't block other calls. Results are returned
+  /// in operation order; a failed operation yields a [BatchResult] with an
+  /// error code instead of throwing.
+  ///
+  /// With [atomic], the batch stops at the first failure and discards all of
+  /// its bookmark changes ([BatchResponse.committed] is false). Since file
+  /// writes could not be rolled back with them, an atomic batch may only
+  /// contain bookmark operations; otherwise it throws a `PlatformException`
+  /// with code `INVALID_ARGUMENT` before running anything.
+  static Future<BatchResponse> executeBatch(
+    List<BatchOperation> operations, {
+    bool atomic = false,
+  }) async {
+    return PlatformHandler.executeBatch(operations, atomic: atomic);
+  }
+
   // ============================================================================
   // PERMISSION MANAGEMENT
   // ============================================================================
@@ -0,0 +1,98 @@
+import 'dart:typed_data';
+
+import 'metadata_patch.dart';
+
+/// A single operation inside an `executeBatch` call
+///
+/// [method] is any method channel method name (for example `fileExists` or
+/// `updateBookmarkMetadata`) and [arguments] its usual arguments.
+class BatchOperation {
+  final String method;
+  final Map<String, dynamic> arguments;
+
+  const BatchOperation(this.method, [this.arguments = const {}]);
+
+  BatchOperation.fileExists(String identifier, String fileName)
+      : this('fileExists', {'identifier': identifier, 'fileName': fileName});
+
+  BatchOperation.readFile(String identifier, String fileName)
+      : this('readFile', {'identifier': identifier, 'fileName': fileName});
+
+  BatchOperation.saveFile(String identifier, String fileName, List<int> data)
+      : this('saveFile', {
+          'identifier': identifier,
+          'fileName': fileName,
+          'data': data is Uint8List ? data : Uint8List.fromList(data),
+        });
+
+  BatchOperation.deleteFile(String identifier, String fileName)
+      : this('deleteFile', {'identifier': identifier, 'fileName': fileName});
+
+  BatchOperation.getBookmark(String identifier)
+      : this('getBookmark', {'identifier': identifier});
+
+  BatchOperation.deleteBookmark(String identifier)
+      : this('deleteBookmark', {'identifier': identifier});
+
+  BatchOperation.updateBookmarkMetadata(
+    String identifier,
+    Map<String, dynamic> metadata,
+  ) : this('updateBookmarkMetadata', {
+          'identifier': identifier,
+          'metadata': metadata,
+        });
+
+  BatchOperation.patchBookmarkMetadata(
+    String identifier,
+    List<MetadataPatch> operations,
+  ) : this('patchBookmarkMetadata', {
+          'identifier': identifier,
+          'operations':
+              operations.map((operation) => operation.toJson()).toList(),
+        });
+
+  Map<String, dynamic> toJson() {
+    return {
+      'method': method,
+      'arguments': arguments,
+    };
+  }
+
+  @override
+  String toString() => 'BatchOperation(method: $method, arguments: $arguments)';
+}
+
+/// The outcome of one [BatchOperation]
+class BatchResult {
+  /// Raw value the method returned, null on error
+  final Object? value;
+  final String? errorCode;
+  final String? errorMessage;
+
+  const BatchResult({this.value, this.errorCode, this.errorMessage});
+
+  bool get isSuccess => errorCode == null;
+
+  factory BatchResult.fromJson(Map<Object?, Object?> json) {
+    return BatchResult(
+      value: json['result'],
+      errorCode: json['errorCode'] as String?,
+      errorMessage: json['errorMessage'] as String?,
+    );
+  }
+
+  @override
+  String toString() => isSuccess
+      ? 'BatchResult(value: $value)'
+      : 'BatchResult(errorCode: $errorCode, errorMessage: $errorMessage)';
+}
+
+/// Results of an `executeBatch` call, in operation order
+class BatchResponse {
+  final List<BatchResult> results;
+
+  /// False when an atomic batch failed and its store changes were discarded
+  final bool committed;
+
+  const BatchResponse({required this.results, required this.committed});
+}
@@ -0,0 +1,69 @@
+/// A file reported among the largest by `getBookmarkUsage`
+class UsageFile {
+  /// Path relative to the bookmark
+  final String path;
+  final int size;
+
+  const UsageFile({required this.path, required this.size});
+
+  factory UsageFile.fromJson(Map<Object?, Object?> json) {
+    return UsageFile(
+      path: json['path'] as String? ?? '',
+      size: json['size'] as int? ?? 0,
+    );
+  }
+
+  @override
+  String toString() => 'UsageFile(path: $path, size: $size)';
+}
+
+/// Space used below a bookmarked directory, as found by `getBookmarkUsage`
+class BookmarkUsage {
+  /// Sum of the regular files' sizes
+  final int totalBytes;
+
+  /// Space actually allocated for them on disk
+  final int allocatedBytes;
+  final int fileCount;
+
+  /// Directories below the bookmark, not counting the bookmark itself
+  final int directoryCount;
+
+  /// Biggest files first
+  final List<UsageFile> largestFiles;
+
+  /// Directories that could not be read and are missing from the totals
+  final int skipped;
+
+  /// Directories answered from the cache without being read again
+  final int cached;
+
+  const BookmarkUsage({
+    required this.totalBytes,
+    required this.allocatedBytes,
+    required this.fileCount,
+    required this.directoryCount,
+    required this.largestFiles,
+    required this.skipped,
+    required this.cached,
+  });
+
+  factory BookmarkUsage.fromJson(Map<Object?, Object?> json) {
+    return BookmarkUsage(
+      totalBytes: json['totalBytes'] as int? ?? 0,
+      allocatedBytes: json['allocatedBytes'] as int? ?? 0,
+      fileCount: json['fileCount'] as int? ?? 0,
+      directoryCount: json['directoryCount'] as int? ?? 0,
+      largestFiles: (json['largestFiles'] as List? ?? const [])
+          .map((file) => UsageFile.fromJson(file as Map<Object?, Object?>))
+          .toList(),
+      skipped: json['skipped'] as int? ?? 0,
+      cached: json['cached'] as int? ?? 0,
+    );
+  }
+
+  @override
+  String toString() => 'BookmarkUsage(totalBytes: $totalBytes, '
+      'allocatedBytes: $allocatedBytes, fileCount: $fileCount, '
+      'directoryCount: $directoryCount, skipped: $skipped)';
+}
@@ -0,0 +1,32 @@
+/// State of a bookmarked directory as found by `validateBookmarks`
+class BookmarkValidation {
+  /// The directory exists (false as well when the check timed out)
+  final bool exists;
+  final bool writable;
+
+  /// Device number of the file system holding the directory, 0 if unknown
+  final int device;
+
+  /// The check did not answer in time, as happens on a dead network mount
+  final bool timedOut;
+
+  const BookmarkValidation({
+    required this.exists,
+    required this.writable,
+    required this.device,
+    required this.timedOut,
+  });
+
+  factory BookmarkValidation.fromJson(Map<Object?, Object?> json) {
+    return BookmarkValidation(
+      exists: json['exists'] as bool? ?? false,
+      writable: json['writable'] as bool? ?? false,
+      device: json['device'] as int? ?? 0,
+      timedOut: json['timedOut'] as bool? ?? false,
+    );
+  }
+
+  @override
+  String toString() => 'BookmarkValidation(exists: $exists, '
+      'writable: $writable, device: $device, timedOut: $timedOut)';
+}
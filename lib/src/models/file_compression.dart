@@ -0,0 +1,8 @@
+/// On-disk compression applied natively by `saveFile` and undone by `readFile`
+enum FileCompression {
+  /// Bytes are stored as given
+  none,
+
+  /// Standard gzip, readable with `gzip -d`
+  gzip,
+}
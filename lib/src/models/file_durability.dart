@@ -0,0 +1,13 @@
+/// How hard a native file write works to survive a crash or power loss
+enum FileDurability {
+  /// Written in place; fastest, but a crash can leave a partial file
+  none,
+
+  /// Written to a temporary file and renamed over the target, so readers
+  /// and crashes only ever see the old or the complete new contents
+  atomic,
+
+  /// Atomic, and also flushed to disk together with the directory entry
+  /// before the call returns
+  durable,
+}
@@ -0,0 +1,83 @@
+import 'dart:typed_data';
+
+/// Kind of directory entry reported by `listFilesDetailed`
+enum FileEntryType { unknown, file, directory, link, other }
+
+/// A single entry of a [FileListing]
+class FileEntry {
+  final String name;
+  final int size;
+  final DateTime modified;
+
+  /// Permission bits (for example `0x1a4` for `rw-r--r--`)
+  final int mode;
+  final FileEntryType type;
+
+  const FileEntry({
+    required this.name,
+    required this.size,
+    required this.modified,
+    required this.mode,
+    required this.type,
+  });
+}
+
+/// Directory listing with attributes, returned by `listFilesDetailed`
+///
+/// Attributes arrive as parallel typed arrays, one slot per entry, which is
+/// much cheaper to transfer than a map per file. Use [entryAt] or [entries]
+/// for object access, or read the arrays directly when sorting large lists.
+class FileListing {
+  final List<String> names;
+  final Int64List sizes;
+
+  /// Modification times in microseconds since the epoch
+  final Int64List modifiedMicros;
+  final Int32List modes;
+
+  /// [FileEntryType] indexes
+  final Uint8List types;
+
+  /// Resumes the listing after this page, or null once it is complete
+  final String? cursor;
+
+  const FileListing({
+    required this.names,
+    required this.sizes,
+    required this.modifiedMicros,
+    required this.modes,
+    required this.types,
+    this.cursor,
+  });
+
+  int get length => names.length;
+
+  bool get hasMore => cursor != null;
+
+  FileEntry entryAt(int index) {
+    final type = types[index];
+    return FileEntry(
+      name: names[index],
+      size: sizes[index],
+      modified: DateTime.fromMicrosecondsSinceEpoch(modifiedMicros[index]),
+      mode: modes[index],
+      type: type < FileEntryType.values.length
+          ? FileEntryType.values[type]
+          : FileEntryType.unknown,
+    );
+  }
+
+  Iterable<FileEntry> get entries =>
+      Iterable<FileEntry>.generate(length, entryAt);
+
+  factory FileListing.fromJson(Map<Object?, Object?> json) {
+    return FileListing(
+      names: List<String>.from(json['names'] as List? ?? const []),
+      sizes: json['sizes'] as Int64List? ?? Int64List(0),
+      modifiedMicros: json['modifiedMicros'] as Int64List? ?? Int64List(0),
+      modes: json['modes'] as Int32List? ?? Int32List(0),
+      types: json['types'] as Uint8List? ?? Uint8List(0),
+      cursor: json['cursor'] as String?,
+    );
+  }
+}
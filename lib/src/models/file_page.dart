@@ -0,0 +1,20 @@
+/// One page of a directory listing returned by `listFilesPaged`
+class FilePage {
+  /// File names in directory order (not sorted)
+  final List<String> files;
+
+  /// Opaque token that resumes the listing after this page, or null once the
+  /// end of the directory has been reached
+  final String? cursor;
+
+  const FilePage({required this.files, this.cursor});
+
+  bool get hasMore => cursor != null;
+
+  factory FilePage.fromJson(Map<Object?, Object?> json) {
+    return FilePage(
+      files: List<String>.from(json['files'] as List? ?? const []),
+      cursor: json['cursor'] as String?,
+    );
+  }
+}
@@ -0,0 +1,33 @@
+/// A single change applied by `patchBookmarkMetadata`
+///
+/// Values may be any codec-encodable value, including nested maps and lists.
+class MetadataPatch {
+  /// `'set'`, `'remove'` or `'increment'`
+  final String op;
+  final String key;
+  final Object? value;
+
+  const MetadataPatch._(this.op, this.key, [this.value]);
+
+  /// Set [key] to [value], replacing any previous value
+  const MetadataPatch.set(String key, Object? value)
+      : this._('set', key, value);
+
+  /// Remove [key] if present
+  const MetadataPatch.remove(String key) : this._('remove', key);
+
+  /// Add [by] to the number stored under [key], starting from 0 if unset
+  const MetadataPatch.increment(String key, [num by = 1])
+      : this._('increment', key, by);
+
+  Map<String, dynamic> toJson() {
+    return {
+      'op': op,
+      'key': key,
+      if (op != 'remove') 'value': value,
+    };
+  }
+
+  @override
+  String toString() => 'MetadataPatch(op: $op, key: $key, value: $value)';
+}
@@ -0,0 +1,93 @@
+/// Latency summary of one method or storage operation, from `getStats`
+///
+/// Percentiles come from a log-scale histogram and are accurate to within
+/// about 25%; [max] is exact.
+class LatencyStats {
+  final int count;
+  final Duration total;
+  final Duration p50;
+  final Duration p99;
+  final Duration max;
+
+  /// Calls that returned an error (always 0 for storage operations)
+  final int errors;
+
+  const LatencyStats({
+    required this.count,
+    required this.total,
+    required this.p50,
+    required this.p99,
+    required this.max,
+    this.errors = 0,
+  });
+
+  Duration get mean => count == 0
+      ? Duration.zero
+      : Duration(microseconds: total.inMicroseconds ~/ count);
+
+  static Duration _nanoseconds(Object? value) =>
+      Duration(microseconds: (value as int? ?? 0) ~/ 1000);
+
+  factory LatencyStats.fromJson(Map<Object?, Object?> json) {
+    return LatencyStats(
+      count: json['count'] as int? ?? 0,
+      total: _nanoseconds(json['totalNs']),
+      p50: _nanoseconds(json['p50Ns']),
+      p99: _nanoseconds(json['p99Ns']),
+      max: _nanoseconds(json['maxNs']),
+      errors: json['errors'] as int? ?? 0,
+    );
+  }
+}
+
+/// Native call statistics returned by `getStats`
+class PluginStats {
+  /// When the statistics were last reset (or the plugin started)
+  final DateTime since;
+
+  /// Per method channel call, keyed by method name. Raw binary channel
+  /// transfers appear as `binaryRead` and `binaryWrite`.
+  final Map<String, LatencyStats> methods;
+
+  /// Loads of the bookmark store from disk
+  final LatencyStats storeLoads;
+
+  /// Full snapshot writes of the bookmark store, including fsync and rename
+  final LatencyStats storeSaves;
+
+  /// Journal appends in journal mode
+  final LatencyStats journalAppends;
+
+  /// File payload bytes read and written by file operations
+  final int bytesRead;
+  final int bytesWritten;
+
+  const PluginStats({
+    required this.since,
+    required this.methods,
+    required this.storeLoads,
+    required this.storeSaves,
+    required this.journalAppends,
+    required this.bytesRead,
+    required this.bytesWritten,
+  });
+
+  factory PluginStats.fromJson(Map<Object?, Object?> json) {
+    final methods = json['methods'] as Map<Object?, Object?>? ?? const {};
+    final store = json['store'] as Map<Object?, Object?>? ?? const {};
+    LatencyStats storeStats(String key) => LatencyStats.fromJson(
+        store[key] as Map<Object?, Object?>? ?? const {});
+
+    return PluginStats(
+      since: DateTime.fromMicrosecondsSinceEpoch(
+          json['sinceMicros'] as int? ?? 0),
+      methods: methods.map((name, value) => MapEntry(name as String,
+          LatencyStats.fromJson(value as Map<Object?, Object?>))),
+      storeLoads: storeStats('load'),
+      storeSaves: storeStats('save'),
+      journalAppends: storeStats('journal'),
+      bytesRead: json['bytesRead'] as int? ?? 0,
+      bytesWritten: json['bytesWritten'] as int? ?? 0,
+    );
+  }
+}
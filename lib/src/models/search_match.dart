@@ -0,0 +1,41 @@
+import 'dart:typed_data';
+
+/// An occurrence of the query found by `searchFiles`
+class SearchMatch {
+  /// Path of the file relative to the bookmark
+  final String path;
+
+  /// Byte offset of the match in the file
+  final int offset;
+
+  /// 1-based line number of the match
+  final int line;
+
+  /// The line containing the match, cut to at most 80 bytes on either side
+  /// of it. Bytes that are not valid UTF-8 are replaced with `?`.
+  final String snippet;
+
+  const SearchMatch({
+    required this.path,
+    required this.offset,
+    required this.line,
+    required this.snippet,
+  });
+
+  /// Matches of one `batch` event, which arrive as parallel arrays
+  static List<SearchMatch> listFromBatch(Map<Object?, Object?> event) {
+    final paths = event['paths'] as List? ?? const [];
+    final offsets = event['offsets'] as Int64List? ?? Int64List(0);
+    final lines = event['lines'] as Int64List? ?? Int64List(0);
+    final snippets = event['snippets'] as List? ?? const [];
+    return List<SearchMatch>.generate(
+      paths.length,
+      (i) => SearchMatch(
+        path: paths[i] as String,
+        offset: offsets[i],
+        line: lines[i],
+        snippet: snippets[i] as String,
+      ),
+    );
+  }
+}
@@ -0,0 +1,30 @@
+/// Kind of change reported by `watchBookmark`
+enum WatchEventType { created, modified, deleted, moved, overflow }
+
+/// A change below a watched bookmark
+///
+/// Changes are coalesced natively over a short window: a file written
+/// several times is reported once, and a file created and removed within
+/// the window is not reported at all.
+class WatchEvent {
+  final WatchEventType type;
+
+  /// Path relative to the bookmark (empty for [WatchEventType.overflow])
+  final String path;
+
+  /// Previous relative path of a [WatchEventType.moved] entry
+  final String? fromPath;
+
+  const WatchEvent({required this.type, required this.path, this.fromPath});
+
+  factory WatchEvent.fromJson(Map<Object?, Object?> json) {
+    return WatchEvent(
+      type: WatchEventType.values.firstWhere(
+        (type) => type.name == json['type'],
+        orElse: () => WatchEventType.modified,
+      ),
+      path: json['path'] as String? ?? '',
+      fromPath: json['from'] as String?,
+    );
+  }
+}
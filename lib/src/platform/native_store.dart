@@ -0,0 +1,140 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:typed_data';
+
+typedef _VersionNative = Int32 Function();
+typedef _Version = int Function();
+typedef _AllocNative = Pointer<Void> Function(Size size);
+typedef _Alloc = Pointer<Void> Function(int size);
+typedef _FreeNative = Void Function(Pointer<Void> pointer);
+typedef _Free = void Function(Pointer<Void> pointer);
+typedef _QueryNative = Int32 Function(Pointer<Uint8> identifier);
+typedef _Query = int Function(Pointer<Uint8> identifier);
+typedef _FileQueryNative = Int32 Function(
+    Pointer<Uint8> identifier, Pointer<Uint8> fileName);
+typedef _FileQuery = int Function(
+    Pointer<Uint8> identifier, Pointer<Uint8> fileName);
+typedef _GetNative = Int32 Function(Pointer<Uint8> identifier,
+    Pointer<Pointer<Uint8>> json, Pointer<Size> length);
+typedef _Get = int Function(Pointer<Uint8> identifier,
+    Pointer<Pointer<Uint8>> json, Pointer<Size> length);
+
+/// Synchronous read-only queries against the Linux plugin's bookmark store
+///
+/// Calls go straight into the plugin library through dart:ffi instead of the
+/// method channel, for lookups hot enough that the channel round trip
+/// dominates. Every query returns null when the native side can't answer
+/// (no plugin instance registered yet), in which case callers use the
+/// channel instead.
+class NativeStore {
+  /// Matches `directory_bookmarks_ffi_version` in the plugin library
+  static const _abiVersion = 2;
+
+  /// Null off Linux or when the plugin library doesn't export the C ABI
+  static final NativeStore? instance = _open();
+
+  final _Free _free;
+  final _Alloc _alloc;
+  final _Query _bookmarkExists;
+  final _Query _hasWritePermission;
+  final _FileQuery _fileExists;
+  final _Get _getBookmark;
+
+  /// Argument scratch space, reused across calls and grown on demand
+  Pointer<Uint8> _scratch = nullptr;
+  int _scratchSize = 0;
+  late final Pointer<Size> _length = _alloc(sizeOf<Size>()).cast<Size>();
+  late final Pointer<Pointer<Uint8>> _json =
+      _alloc(sizeOf<Pointer<Uint8>>()).cast<Pointer<Uint8>>();
+
+  NativeStore._(DynamicLibrary library)
+      : _alloc = library
+            .lookupFunction<_AllocNative, _Alloc>('directory_bookmarks_ffi_alloc'),
+        _free = library
+            .lookupFunction<_FreeNative, _Free>('directory_bookmarks_ffi_free'),
+        _bookmarkExists = library.lookupFunction<_QueryNative, _Query>(
+            'directory_bookmarks_ffi_bookmark_exists'),
+        _hasWritePermission = library.lookupFunction<_QueryNative, _Query>(
+            'directory_bookmarks_ffi_has_write_permission'),
+        _fileExists = library.lookupFunction<_FileQueryNative, _FileQuery>(
+            'directory_bookmarks_ffi_file_exists'),
+        _getBookmark = library
+            .lookupFunction<_GetNative, _Get>('directory_bookmarks_ffi_get_bookmark');
+
+  static NativeStore? _open() {
+    if (!Platform.isLinux) return null;
+    try {
+      // Plugin libraries are linked into the runner, so their symbols are
+      // visible process-wide
+      final library = DynamicLibrary.process();
+      final version = library.lookupFunction<_VersionNative, _Version>(
+          'directory_bookmarks_ffi_version');
+      if (version() != _abiVersion) return null;
+      return NativeStore._(library);
+    } on ArgumentError {
+      return null;
+    }
+  }
+
+  bool? bookmarkExists(String identifier) =>
+      _withStrings([identifier], (args) => _bool(_bookmarkExists(args[0])));
+
+  bool? hasWritePermission(String identifier) =>
+      _withStrings([identifier], (args) => _bool(_hasWritePermission(args[0])));
+
+  bool? fileExists(String identifier, String fileName) => _withStrings(
+      [identifier, fileName], (args) => _bool(_fileExists(args[0], args[1])));
+
+  /// The bookmark's fields as returned by the `getBookmark` method, with
+  /// `bookmark` null if there is no such bookmark
+  ({Map<String, dynamic>? bookmark})? getBookmark(String identifier) {
+    return _withStrings([identifier], (args) {
+      final status = _getBookmark(args[0], _json, _length);
+      if (status < 0) return null;
+      if (status == 0) return (bookmark: null);
+      final result = _json.value;
+      try {
+        return (
+          bookmark: jsonDecode(utf8.decode(result.asTypedList(_length.value)))
+              as Map<String, dynamic>
+        );
+      } finally {
+        _free(result.cast());
+      }
+    });
+  }
+
+  static bool? _bool(int result) => result < 0 ? null : result != 0;
+
+  /// Copies [strings] into the scratch buffer as NUL-terminated UTF-8 and
+  /// runs [call] with a pointer to each
+  T? _withStrings<T>(List<String> strings, T? Function(List<Pointer<Uint8>>) call) {
+    final encoded = <Uint8List>[];
+    var size = 0;
+    for (final string in strings) {
+      final bytes = utf8.encode(string);
+      // Embedded NULs would silently truncate the native string
+      if (bytes.contains(0)) return null;
+      encoded.add(bytes);
+      size += bytes.length + 1;
+    }
+
+    if (size > _scratchSize) {
+      if (_scratch != nullptr) _free(_scratch.cast());
+      _scratchSize = size < 256 ? 256 : size;
+      _scratch = _alloc(_scratchSize).cast<Uint8>();
+    }
+
+    final buffer = _scratch.asTypedList(size);
+    final pointers = <Pointer<Uint8>>[];
+    var offset = 0;
+    for (final bytes in encoded) {
+      pointers.add(Pointer<Uint8>.fromAddress(_scratch.address + offset));
+      buffer.setRange(offset, offset + bytes.length, bytes);
+      buffer[offset + bytes.length] = 0;
+      offset += bytes.length + 1;
+    }
+    return call(pointers);
+  }
+}
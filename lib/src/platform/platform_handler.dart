@@ -1,11 +1,33 @@
+import 'dart:async';
+import 'dart:convert';
+
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
 import '../../directory_bookmarks.dart';
+import 'native_store.dart';
 
 abstract class PlatformHandler {
   static const _channel =
       MethodChannel('com.example.directory_bookmarks/bookmark');
+  static const _events =
+      EventChannel('com.example.directory_bookmarks/events');
+
+  /// Shared native event stream, multiplexed by `streamId`
+  static final Stream<Map<Object?, Object?>> _eventStream = _events
+      .receiveBroadcastStream()
+      .map((event) => event as Map<Object?, Object?>);
+  static int _nextStreamId = 1;
+
+  /// Raw binary channel for file payloads (Linux), see [_binaryRequest]
+  static const _binaryChannel = 'com.example.directory_bookmarks/binary';
+  static const _binaryOpRead = 1;
+  static const _binaryOpWrite = 2;
+  static const _binaryRequestHeaderSize = 32;
+  static const _binaryResponseHeaderSize = 8;
+
+  static bool get _useBinaryChannel =>
+      defaultTargetPlatform == TargetPlatform.linux;
 
   /// Throws an UnsupportedError if the current platform is not supported
   static void _checkPlatformSupport() {
@@ -23,6 +45,21 @@ abstract class PlatformHandler {
         defaultTargetPlatform == TargetPlatform.linux;
   }
 
+  // ============================================================================
+  // CONFIGURATION
+  // ============================================================================
+
+  /// Configure native plugin behavior (Linux only, no-op elsewhere)
+  static Future<void> configure(Map<String, dynamic> options) async {
+    _checkPlatformSupport();
+    if (defaultTargetPlatform != TargetPlatform.linux) return;
+    try {
+      await _channel.invokeMethod('configure', options);
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
   // ============================================================================
   // BOOKMARK MANAGEMENT
   // ============================================================================
@@ -32,6 +69,7 @@ abstract class PlatformHandler {
     String identifier,
     String path, {
     Map<String, dynamic>? metadata,
+    bool sync = false,
   }) async {
     _checkPlatformSupport();
     try {
@@ -39,6 +77,7 @@ abstract class PlatformHandler {
         'identifier': identifier,
         'path': path,
         'metadata': metadata,
+        if (sync) 'sync': true,
       });
       return result as String?;
     } on PlatformException catch (e) {
@@ -46,11 +85,27 @@ abstract class PlatformHandler {
     }
   }
 
-  /// List all bookmarks
-  static Future<List<BookmarkData>> listBookmarks() async {
+  /// List bookmarks, optionally filtered, sorted, paged and projected
+  static Future<List<BookmarkData>> listBookmarks({
+    Map<String, Object?>? where,
+    String? sortBy,
+    bool descending = false,
+    int? offset,
+    int? limit,
+    List<String>? fields,
+  }) async {
     _checkPlatformSupport();
     try {
-      final result = await _channel.invokeMethod('listBookmarks');
+      final arguments = <String, Object?>{
+        if (where != null) 'where': where,
+        if (sortBy != null) 'sortBy': sortBy,
+        if (descending) 'descending': true,
+        if (offset != null) 'offset': offset,
+        if (limit != null) 'limit': limit,
+        if (fields != null) 'fields': fields,
+      };
+      final result = await _channel.invokeMethod(
+          'listBookmarks', arguments.isEmpty ? null : arguments);
       if (result == null) return [];
 
       final List<dynamic> bookmarksList = result as List<dynamic>;
@@ -72,29 +127,65 @@ abstract class PlatformHandler {
   /// Get a specific bookmark
   static Future<BookmarkData?> getBookmark(String identifier) async {
     _checkPlatformSupport();
+    final native = NativeStore.instance?.getBookmark(identifier);
+    if (native != null) {
+      final bookmark = native.bookmark;
+      return bookmark == null ? null : BookmarkData.fromJson(bookmark);
+    }
     try {
       final result = await _channel.invokeMethod('getBookmark', {
         'identifier': identifier,
       });
+      return _bookmarkFromResult(result);
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
 
-      if (result == null) return null;
+  /// Find the bookmark whose directory is exactly [path]
+  static Future<BookmarkData?> findBookmarkByPath(String path) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('findBookmarkByPath', {
+        'path': path,
+      });
+      return _bookmarkFromResult(result);
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
 
-      final Map<String, dynamic> bookmarkData;
-      if (result is Map<Object?, Object?>) {
-        bookmarkData = Map<String, dynamic>.from(
-            result.map((key, value) => MapEntry(key.toString(), value)));
-      } else {
-        bookmarkData = Map<String, dynamic>.from(result);
-      }
-      return BookmarkData.fromJson(bookmarkData);
+  /// Find the bookmark with the deepest directory containing [path]
+  static Future<BookmarkData?> findContainingBookmark(String path) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('findContainingBookmark', {
+        'path': path,
+      });
+      return _bookmarkFromResult(result);
     } on PlatformException catch (e) {
       throw _handlePlatformException(e);
     }
   }
 
+  static BookmarkData? _bookmarkFromResult(dynamic result) {
+    if (result == null) return null;
+
+    final Map<String, dynamic> bookmarkData;
+    if (result is Map<Object?, Object?>) {
+      bookmarkData = Map<String, dynamic>.from(
+          result.map((key, value) => MapEntry(key.toString(), value)));
+    } else {
+      bookmarkData = Map<String, dynamic>.from(result);
+    }
+    return BookmarkData.fromJson(bookmarkData);
+  }
+
   /// Check if bookmark exists
   static Future<bool> bookmarkExists(String identifier) async {
     _checkPlatformSupport();
+    final native = NativeStore.instance?.bookmarkExists(identifier);
+    if (native != null) return native;
     try {
       final result = await _channel.invokeMethod('bookmarkExists', {
         'identifier': identifier,
@@ -106,11 +197,15 @@ abstract class PlatformHandler {
   }
 
   /// Delete a bookmark
-  static Future<bool> deleteBookmark(String identifier) async {
+  static Future<bool> deleteBookmark(
+    String identifier, {
+    bool sync = false,
+  }) async {
     _checkPlatformSupport();
     try {
       final result = await _channel.invokeMethod('deleteBookmark', {
         'identifier': identifier,
+        if (sync) 'sync': true,
       });
       return result ?? false;
     } on PlatformException catch (e) {
@@ -121,13 +216,35 @@ abstract class PlatformHandler {
   /// Update bookmark metadata
   static Future<bool> updateBookmarkMetadata(
     String identifier,
-    Map<String, dynamic> metadata,
-  ) async {
+    Map<String, dynamic> metadata, {
+    bool sync = false,
+  }) async {
     _checkPlatformSupport();
     try {
       final result = await _channel.invokeMethod('updateBookmarkMetadata', {
         'identifier': identifier,
         'metadata': metadata,
+        if (sync) 'sync': true,
+      });
+      return result ?? false;
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Change individual metadata keys of a bookmark
+  static Future<bool> patchBookmarkMetadata(
+    String identifier,
+    List<MetadataPatch> operations, {
+    bool sync = false,
+  }) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('patchBookmarkMetadata', {
+        'identifier': identifier,
+        'operations':
+            operations.map((operation) => operation.toJson()).toList(),
+        if (sync) 'sync': true,
       });
       return result ?? false;
     } on PlatformException catch (e) {
@@ -135,6 +252,61 @@ abstract class PlatformHandler {
     }
   }
 
+  /// Probe every bookmarked directory concurrently
+  static Future<Map<String, BookmarkValidation>> validateBookmarks({
+    Duration? timeout,
+    Duration? maxAge,
+  }) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('validateBookmarks', {
+        if (timeout != null) 'timeoutMs': timeout.inMilliseconds,
+        if (maxAge != null) 'maxAgeMs': maxAge.inMilliseconds,
+      });
+      if (result == null) return {};
+
+      return (result as Map<Object?, Object?>).map((key, value) => MapEntry(
+          key as String,
+          BookmarkValidation.fromJson(value as Map<Object?, Object?>)));
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Write any bookmark changes queued by write-behind mode
+  static Future<bool> flush() async {
+    _checkPlatformSupport();
+    if (defaultTargetPlatform != TargetPlatform.linux) return true;
+    try {
+      final result = await _channel.invokeMethod('flush');
+      return result ?? false;
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Fetch native call statistics
+  static Future<PluginStats> getStats() async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('getStats');
+      return PluginStats.fromJson(result as Map<Object?, Object?>);
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Clear native call statistics
+  static Future<bool> resetStats() async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('resetStats');
+      return result ?? false;
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
   // ============================================================================
   // FILE OPERATIONS
   // ============================================================================
@@ -143,14 +315,90 @@ abstract class PlatformHandler {
   static Future<bool> saveFile(
     String identifier,
     String fileName,
-    List<int> data,
-  ) async {
+    List<int> data, {
+    FileCompression compression = FileCompression.none,
+    int? compressionLevel,
+    FileDurability? durability,
+  }) async {
     _checkPlatformSupport();
+    if (_useBinaryChannel) {
+      await _binaryRequest(_binaryOpWrite, identifier, fileName,
+          payload: data,
+          compression: compression,
+          compressionLevel: compressionLevel,
+          durability: durability);
+      return true;
+    }
     try {
       final result = await _channel.invokeMethod('saveFile', {
         'identifier': identifier,
         'fileName': fileName,
         'data': data,
+        if (compression != FileCompression.none)
+          'compression': compression.name,
+        if (compressionLevel != null) 'compressionLevel': compressionLevel,
+        if (durability != null) 'durability': durability.name,
+      });
+      return result ?? false;
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Start a streaming write session for a file in a bookmarked directory
+  static Future<int> beginWrite(
+    String identifier,
+    String fileName, {
+    int? expectedSize,
+    FileDurability? durability,
+  }) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('beginWrite', {
+        'identifier': identifier,
+        'fileName': fileName,
+        if (expectedSize != null) 'expectedSize': expectedSize,
+        if (durability != null) 'durability': durability.name,
+      });
+      return result as int;
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Append bytes to a write session, returning the total bytes written
+  static Future<int> appendChunk(int session, List<int> data) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('appendChunk', {
+        'session': session,
+        'data': data is Uint8List ? data : Uint8List.fromList(data),
+      });
+      return result as int;
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Atomically publish the data written to a session
+  static Future<bool> commitWrite(int session) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('commitWrite', {
+        'session': session,
+      });
+      return result ?? false;
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Discard a write session without touching the target file
+  static Future<bool> abortWrite(int session) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('abortWrite', {
+        'session': session,
       });
       return result ?? false;
     } on PlatformException catch (e) {
@@ -161,13 +409,20 @@ abstract class PlatformHandler {
   /// Read file from bookmarked directory
   static Future<List<int>?> readFile(
     String identifier,
-    String fileName,
-  ) async {
+    String fileName, {
+    FileCompression compression = FileCompression.none,
+  }) async {
     _checkPlatformSupport();
+    if (_useBinaryChannel) {
+      return _binaryRequest(_binaryOpRead, identifier, fileName,
+          compression: compression);
+    }
     try {
       final result = await _channel.invokeMethod('readFile', {
         'identifier': identifier,
         'fileName': fileName,
+        if (compression != FileCompression.none)
+          'compression': compression.name,
       });
       return result != null ? List<int>.from(result) : null;
     } on PlatformException catch (e) {
@@ -175,6 +430,93 @@ abstract class PlatformHandler {
     }
   }
 
+  /// Read a byte range of a file in a bookmarked directory
+  static Future<Uint8List?> readFileRange(
+    String identifier,
+    String fileName,
+    int offset,
+    int length,
+  ) async {
+    _checkPlatformSupport();
+    if (_useBinaryChannel) {
+      return _binaryRequest(_binaryOpRead, identifier, fileName,
+          offset: offset, length: length);
+    }
+    try {
+      final result = await _channel.invokeMethod('readFileRange', {
+        'identifier': identifier,
+        'fileName': fileName,
+        'offset': offset,
+        'length': length,
+      });
+      return result as Uint8List?;
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Read many files in a bookmarked directory in one call
+  static Future<Map<String, Uint8List?>> readFiles(
+    String identifier,
+    List<String> fileNames,
+  ) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('readFiles', {
+        'identifier': identifier,
+        'fileNames': fileNames,
+      }) as Map<Object?, Object?>;
+      return result.map((name, data) => MapEntry(name as String, data as Uint8List?));
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Write many files to a bookmarked directory in one call
+  static Future<Map<String, bool>> saveFiles(
+    String identifier,
+    Map<String, Uint8List> files, {
+    FileDurability? durability,
+  }) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('saveFiles', {
+        'identifier': identifier,
+        'files': files,
+        if (durability != null) 'durability': durability.name,
+      }) as Map<Object?, Object?>;
+      return result.map((name, saved) => MapEntry(name as String, saved as bool));
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Stream a file in a bookmarked directory as fixed-size chunks
+  static Stream<Uint8List> readFileStream(
+    String identifier,
+    String fileName, {
+    int? chunkSize,
+    int? offset,
+    int? length,
+    FileCompression compression = FileCompression.none,
+  }) {
+    return _nativeStream<Uint8List>(
+      'startReadStream',
+      {
+        'identifier': identifier,
+        'fileName': fileName,
+        if (chunkSize != null) 'chunkSize': chunkSize,
+        if (offset != null) 'offset': offset,
+        if (length != null) 'length': length,
+        if (compression != FileCompression.none)
+          'compression': compression.name,
+      },
+      (event, sink) {
+        if (event['type'] == 'chunk') sink.add(event['data'] as Uint8List);
+      },
+    );
+  }
+
   /// List files in bookmarked directory
   static Future<List<String>?> listFiles(String identifier) async {
     _checkPlatformSupport();
@@ -188,6 +530,140 @@ abstract class PlatformHandler {
     }
   }
 
+  /// List one page of files in bookmarked directory
+  static Future<FilePage> listFilesPaged(
+    String identifier, {
+    String? cursor,
+    int? limit,
+  }) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('listFilesPaged', {
+        'identifier': identifier,
+        if (cursor != null) 'cursor': cursor,
+        if (limit != null) 'limit': limit,
+      });
+      return FilePage.fromJson(result as Map<Object?, Object?>);
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// List entries of bookmarked directory with their attributes
+  static Future<FileListing> listFilesDetailed(
+    String identifier, {
+    bool includeHidden = false,
+    String? cursor,
+    int? limit,
+  }) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('listFilesDetailed', {
+        'identifier': identifier,
+        'includeHidden': includeHidden,
+        if (cursor != null) 'cursor': cursor,
+        if (limit != null) 'limit': limit,
+      });
+      return FileListing.fromJson(result as Map<Object?, Object?>);
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Measure the space used below bookmarked directory
+  static Future<BookmarkUsage> getBookmarkUsage(
+    String identifier, {
+    int? largest,
+    bool refresh = false,
+  }) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('getBookmarkUsage', {
+        'identifier': identifier,
+        if (largest != null) 'largest': largest,
+        if (refresh) 'refresh': true,
+      });
+      return BookmarkUsage.fromJson(result as Map<Object?, Object?>);
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Recursively walk bookmarked directory, streaming batches of matches
+  static Stream<List<String>> walkFiles(
+    String identifier, {
+    String? pattern,
+    int? maxDepth,
+    bool includeHidden = false,
+    bool followLinks = false,
+    int? batchSize,
+  }) {
+    return _nativeStream<List<String>>(
+      'startWalk',
+      {
+        'identifier': identifier,
+        if (pattern != null) 'pattern': pattern,
+        if (maxDepth != null) 'maxDepth': maxDepth,
+        'includeHidden': includeHidden,
+        'followLinks': followLinks,
+        if (batchSize != null) 'batchSize': batchSize,
+      },
+      (event, sink) {
+        if (event['type'] == 'batch') {
+          sink.add(List<String>.from(event['paths'] as List));
+        }
+      },
+    );
+  }
+
+  /// Search file contents in bookmarked directory, streaming batches of matches
+  static Stream<List<SearchMatch>> searchFiles(
+    String identifier,
+    String query, {
+    bool recursive = false,
+    int? maxResults,
+    bool caseInsensitive = false,
+    bool includeHidden = false,
+    int? batchSize,
+  }) {
+    return _nativeStream<List<SearchMatch>>(
+      'startSearch',
+      {
+        'identifier': identifier,
+        'query': query,
+        'recursive': recursive,
+        if (maxResults != null) 'maxResults': maxResults,
+        'caseInsensitive': caseInsensitive,
+        'includeHidden': includeHidden,
+        if (batchSize != null) 'batchSize': batchSize,
+      },
+      (event, sink) {
+        if (event['type'] == 'batch') sink.add(SearchMatch.listFromBatch(event));
+      },
+    );
+  }
+
+  /// Watch a bookmarked directory for changes
+  static Stream<List<WatchEvent>> watchBookmark(
+    String identifier, {
+    bool recursive = false,
+  }) {
+    return _nativeStream<List<WatchEvent>>(
+      'startWatch',
+      {
+        'identifier': identifier,
+        'recursive': recursive,
+      },
+      (event, sink) {
+        if (event['type'] == 'changes') {
+          sink.add((event['changes'] as List)
+              .map((change) => WatchEvent.fromJson(change as Map))
+              .toList());
+        }
+      },
+    );
+  }
+
   /// Delete file in bookmarked directory
   static Future<bool> deleteFile(
     String identifier,
@@ -205,12 +681,99 @@ abstract class PlatformHandler {
     }
   }
 
+  /// Copy or move a file between bookmarked directories
+  static Future<bool> _copyOrMoveFile(
+    String method,
+    String sourceIdentifier,
+    String sourceFileName,
+    String targetIdentifier,
+    String targetFileName,
+    bool overwrite,
+  ) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod(method, {
+        'identifier': sourceIdentifier,
+        'fileName': sourceFileName,
+        'targetIdentifier': targetIdentifier,
+        'targetFileName': targetFileName,
+        'overwrite': overwrite,
+      });
+      return result ?? false;
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Copy a file between bookmarked directories
+  static Future<bool> copyFile(
+    String sourceIdentifier,
+    String sourceFileName,
+    String targetIdentifier,
+    String targetFileName, {
+    bool overwrite = true,
+  }) {
+    return _copyOrMoveFile('copyFile', sourceIdentifier, sourceFileName,
+        targetIdentifier, targetFileName, overwrite);
+  }
+
+  /// Move a file between bookmarked directories
+  static Future<bool> moveFile(
+    String sourceIdentifier,
+    String sourceFileName,
+    String targetIdentifier,
+    String targetFileName, {
+    bool overwrite = true,
+  }) {
+    return _copyOrMoveFile('moveFile', sourceIdentifier, sourceFileName,
+        targetIdentifier, targetFileName, overwrite);
+  }
+
+  /// Hash a file in a bookmarked directory natively
+  static Future<String?> hashFile(
+    String identifier,
+    String fileName, {
+    String algorithm = 'sha256',
+  }) async {
+    _checkPlatformSupport();
+    try {
+      return await _channel.invokeMethod<String>('hashFile', {
+        'identifier': identifier,
+        'fileName': fileName,
+        'algorithm': algorithm,
+      });
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  /// Hash many files in a bookmarked directory in one call
+  static Future<Map<String, String?>> hashFiles(
+    String identifier,
+    List<String> fileNames, {
+    String algorithm = 'sha256',
+  }) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('hashFiles', {
+        'identifier': identifier,
+        'fileNames': fileNames,
+        'algorithm': algorithm,
+      }) as Map<Object?, Object?>;
+      return result.map((name, digest) => MapEntry(name as String, digest as String?));
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
   /// Check if file exists in bookmarked directory
   static Future<bool> fileExists(
     String identifier,
     String fileName,
   ) async {
     _checkPlatformSupport();
+    final native = NativeStore.instance?.fileExists(identifier, fileName);
+    if (native != null) return native;
     try {
       final result = await _channel.invokeMethod('fileExists', {
         'identifier': identifier,
@@ -229,6 +792,8 @@ abstract class PlatformHandler {
   /// Check write permission
   static Future<bool> hasWritePermission(String identifier) async {
     _checkPlatformSupport();
+    final native = NativeStore.instance?.hasWritePermission(identifier);
+    if (native != null) return native;
     try {
       final result = await _channel.invokeMethod('hasWritePermission', {
         'identifier': identifier,
@@ -252,6 +817,177 @@ abstract class PlatformHandler {
     }
   }
 
+  // ============================================================================
+  // BATCH
+  // ============================================================================
+
+  /// Execute many operations in one round trip
+  static Future<BatchResponse> executeBatch(
+    List<BatchOperation> operations, {
+    bool atomic = false,
+  }) async {
+    _checkPlatformSupport();
+    try {
+      final result = await _channel.invokeMethod('executeBatch', {
+        'operations': operations.map((op) => op.toJson()).toList(),
+        'atomic': atomic,
+      }) as Map<Object?, Object?>;
+      final results = (result['results'] as List<Object?>)
+          .map((item) => BatchResult.fromJson(item as Map<Object?, Object?>))
+          .toList();
+      return BatchResponse(
+        results: results,
+        committed: result['committed'] as bool? ?? true,
+      );
+    } on PlatformException catch (e) {
+      throw _handlePlatformException(e);
+    }
+  }
+
+  // ============================================================================
+  // BINARY CHANNEL
+  // ============================================================================
+
+  /// Send a file request over the raw binary channel
+  ///
+  /// Avoids the standard codec for file payloads. The request is a 32-byte
+  /// little-endian header (op, identifier length, name length, offset,
+  /// length) followed by the UTF-8 identifier, name and payload; the response
+  /// is an 8-byte header whose first byte is a status, followed by the data.
+  /// Returns null when the file does not exist. A negative [length] reads
+  /// to the end of the file. With [compression] set, writes are compressed
+  /// and reads decompress the whole file; the second and third header bytes
+  /// carry the [FileCompression] index and level (0 for the default). The
+  /// fourth byte is the [FileDurability] index plus one, or 0 for the
+  /// default set through [configure].
+  static Future<Uint8List?> _binaryRequest(
+    int op,
+    String identifier,
+    String fileName, {
+    int offset = 0,
+    int length = -1,
+    List<int>? payload,
+    FileCompression compression = FileCompression.none,
+    int? compressionLevel,
+    FileDurability? durability,
+  }) async {
+    final identifierBytes = utf8.encode(identifier);
+    final nameBytes = utf8.encode(fileName);
+    final payloadLength = payload?.length ?? 0;
+
+    final request = Uint8List(_binaryRequestHeaderSize +
+        identifierBytes.length +
+        nameBytes.length +
+        payloadLength);
+    final header = ByteData.sublistView(request, 0, _binaryRequestHeaderSize);
+    header.setUint8(0, op);
+    header.setUint8(1, compression.index);
+    header.setUint8(2, compressionLevel ?? 0);
+    header.setUint8(3, durability == null ? 0 : durability.index + 1);
+    header.setUint32(4, identifierBytes.length, Endian.little);
+    header.setUint32(8, nameBytes.length, Endian.little);
+    header.setInt64(16, offset, Endian.little);
+    header.setInt64(24, length, Endian.little);
+
+    final nameStart = _binaryRequestHeaderSize + identifierBytes.length;
+    final payloadStart = nameStart + nameBytes.length;
+    request.setRange(_binaryRequestHeaderSize, nameStart, identifierBytes);
+    request.setRange(nameStart, payloadStart, nameBytes);
+    if (payload != null) {
+      request.setRange(payloadStart, payloadStart + payloadLength, payload);
+    }
+
+    final reply = await ServicesBinding.instance.defaultBinaryMessenger
+        .send(_binaryChannel, ByteData.sublistView(request));
+    if (reply == null) {
+      throw MissingPluginException(
+          'No handler for $_binaryChannel on this platform');
+    }
+
+    final body = Uint8List.sublistView(reply, _binaryResponseHeaderSize);
+    final status = reply.getUint8(0);
+    switch (status) {
+      case 0:
+        return body;
+      case 1:
+        return null;
+      default:
+        throw _handlePlatformException(PlatformException(
+          code: const {
+                2: 'BOOKMARK_NOT_FOUND',
+                3: 'PERMISSION_DENIED',
+                4: 'INVALID_ARGUMENT',
+              }[status] ??
+              (op == _binaryOpRead ? 'READ_ERROR' : 'WRITE_ERROR'),
+          message: utf8.decode(body, allowMalformed: true),
+        ));
+    }
+  }
+
+  // ============================================================================
+  // STREAMS
+  // ============================================================================
+
+  /// Start a native operation that reports through the events channel
+  ///
+  /// The native side tags every event with the stream id handed to [method].
+  /// `done` and `error` events end the stream; every other event is passed to
+  /// [onEvent]. Cancelling the returned stream cancels the native operation.
+  static Stream<T> _nativeStream<T>(
+    String method,
+    Map<String, dynamic> arguments,
+    void Function(Map<Object?, Object?> event, EventSink<T> sink) onEvent,
+  ) {
+    _checkPlatformSupport();
+    final streamId = _nextStreamId++;
+    StreamSubscription<Map<Object?, Object?>>? subscription;
+    var finished = false;
+
+    late final StreamController<T> controller;
+    controller = StreamController<T>(
+      onListen: () async {
+        subscription = _eventStream
+            .where((event) => event['streamId'] == streamId)
+            .listen((event) {
+          switch (event['type']) {
+            case 'done':
+              finished = true;
+              controller.close();
+              break;
+            case 'error':
+              finished = true;
+              controller.addError(_handlePlatformException(PlatformException(
+                code: event['code'] as String? ?? 'STREAM_ERROR',
+                message: event['message'] as String?,
+              )));
+              controller.close();
+              break;
+            default:
+              onEvent(event, controller.sink);
+          }
+        });
+
+        try {
+          await _channel.invokeMethod(method, {
+            ...arguments,
+            'streamId': streamId,
+          });
+        } on PlatformException catch (e) {
+          finished = true;
+          controller.addError(_handlePlatformException(e));
+          await controller.close();
+        }
+      },
+      onCancel: () async {
+        await subscription?.cancel();
+        if (!finished) {
+          await _channel.invokeMethod('cancelStream', {'streamId': streamId});
+        }
+      },
+    );
+    return controller.stream;
+  }
+
   /// Handle platform-specific exceptions
   static Exception _handlePlatformException(PlatformException e) {
     switch (e.code) {
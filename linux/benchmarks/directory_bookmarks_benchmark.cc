@@ -0,0 +1,303 @@
+// Benchmarks for the Linux plugin's storage and file paths.
+//
+// Configure with -DDIRECTORY_BOOKMARKS_BENCHMARKS=ON and run
+// directory_bookmarks_benchmark. Besides the console report, results are
+// written to directory_bookmarks_benchmark.json (override with
+// --benchmark_out=...) so they can be compared across releases.
+//
+// The helpers under test are file-local to the plugin, so its source is
+// compiled into this executable rather than exported for the benchmarks.
+#include "directory_bookmarks_plugin.cc"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+DirectoryBookmarksPlugin* plugin = nullptr;
+
+// Scratch space for the run, removed again in main
+const fs::path& bench_root() {
+  static const fs::path root = [] {
+    const char* tmp = getenv("TMPDIR");
+    fs::path path = fs::path(tmp != nullptr ? tmp : "/tmp") /
+                    ("directory_bookmarks_bench." + std::to_string(getpid()));
+    fs::create_directories(path);
+    return path;
+  }();
+  return root;
+}
+
+// `count` bookmarks, each with about `metadata_size` bytes of metadata
+// spread over string values of up to 64 bytes
+json synthetic_store(int64_t count, int64_t metadata_size) {
+  json bookmarks = json::object();
+  for (int64_t i = 0; i < count; i++) {
+    json metadata = json::object();
+    for (int64_t written = 0, key = 0; written < metadata_size; key++) {
+      std::string value(std::min<int64_t>(64, metadata_size - written), 'a' + key % 26);
+      written += value.size();
+      metadata["key" + std::to_string(key)] = std::move(value);
+    }
+
+    std::string id = "bookmark-" + std::to_string(i);
+    bookmarks[id] = {
+      {"id", id},
+      {"path", "/home/user/Documents/project-" + std::to_string(i)},
+      {"createdAt", "2024-01-01T00:00:00.000Z"},
+      {"metadata", std::move(metadata)}
+    };
+  }
+  return {{"version", "2.0"}, {"bookmarks", std::move(bookmarks)}};
+}
+
+FlValue* string_args(std::initializer_list<std::pair<const char*, const char*>> entries) {
+  FlValue* args = fl_value_new_map();
+  for (const auto& [key, value] : entries) {
+    fl_value_set_string_take(args, key, fl_value_new_string(value));
+  }
+  return args;
+}
+
+// Bookmark `identifier` at a directory of its own below the scratch space
+fs::path bench_bookmark(const std::string& identifier) {
+  fs::path path = bench_root() / identifier;
+  fs::create_directories(path);
+
+  g_autoptr(FlValue) args = string_args({{"identifier", identifier.c_str()},
+                                         {"path", path.c_str()}});
+  g_autoptr(FlMethodResponse) response = dispatch_method_call(plugin, "createBookmark", args);
+  return path;
+}
+
+// Directory holding `count` empty files, bookmarked as files-<count>
+std::string file_tree(int64_t count) {
+  static std::set<int64_t> created;
+  std::string identifier = "files-" + std::to_string(count);
+  if (created.insert(count).second) {
+    fs::path path = bench_bookmark(identifier);
+    for (int64_t i = 0; i < count; i++) {
+      std::string name = (path / ("file-" + std::to_string(i) + ".dat")).string();
+      int fd = open(name.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+  return identifier;
+}
+
+// Bookmark holding the payload files
+const fs::path& payloads_dir() {
+  static const fs::path path = bench_bookmark("payloads");
+  return path;
+}
+
+// File of `size` bytes in the payloads bookmark, returning its name
+std::string payload_file(int64_t size) {
+  static std::set<int64_t> created;
+  std::string name = "payload-" + std::to_string(size);
+  if (created.insert(size).second) {
+    const fs::path& path = payloads_dir();
+    std::vector<uint8_t> chunk(std::min<int64_t>(size, 1 << 20));
+    for (size_t i = 0; i < chunk.size(); i++) {
+      chunk[i] = static_cast<uint8_t>(i * 131 + 7);
+    }
+
+    int fd = open((path / name).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    for (int64_t written = 0; fd >= 0 && written < size; written += chunk.size()) {
+      write_full(fd, chunk.data(), std::min<int64_t>(chunk.size(), size - written));
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  return name;
+}
+
+bool check_response(benchmark::State& state, FlMethodResponse* response) {
+  if (FL_IS_METHOD_ERROR_RESPONSE(response)) {
+    state.SkipWithError(fl_method_error_response_get_message(FL_METHOD_ERROR_RESPONSE(response)));
+    return false;
+  }
+  return true;
+}
+
+void BM_LoadBookmarks(benchmark::State& state) {
+  std::string path = (bench_root() / "load.json").string();
+  save_bookmarks(path, synthetic_store(state.range(0), state.range(1)), false);
+
+  for (auto _ : state) {
+    json data = load_bookmarks(path);
+    benchmark::DoNotOptimize(data);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * fs::file_size(path));
+}
+
+void BM_SaveBookmarks(benchmark::State& state) {
+  std::string path = (bench_root() / "save.json").string();
+  json data = synthetic_store(state.range(0), state.range(1));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(save_bookmarks(path, data, false));
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * fs::file_size(path));
+}
+
+void BM_SaveBookmarksBinary(benchmark::State& state) {
+  std::string path = (bench_root() / "save.bin").string();
+  json data = synthetic_store(state.range(0), state.range(1));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(save_bookmarks_binary(path, data, false));
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * fs::file_size(path));
+}
+
+// Opening a binary snapshot maps it without decoding any record
+void BM_OpenBinarySnapshot(benchmark::State& state) {
+  std::string path = (bench_root() / "open.bin").string();
+  save_bookmarks_binary(path, synthetic_store(state.range(0), state.range(1)), false);
+
+  for (auto _ : state) {
+    std::unique_ptr<BinarySnapshot> snapshot = binary_snapshot_open(path);
+    benchmark::DoNotOptimize(snapshot);
+  }
+}
+
+void BM_BinarySnapshotFind(benchmark::State& state) {
+  std::string path = (bench_root() / "find.bin").string();
+  save_bookmarks_binary(path, synthetic_store(state.range(0), 64), false);
+  std::unique_ptr<BinarySnapshot> snapshot = binary_snapshot_open(path);
+
+  int64_t i = 0;
+  for (auto _ : state) {
+    std::string identifier = "bookmark-" + std::to_string(i++ % state.range(0));
+    benchmark::DoNotOptimize(binary_snapshot_find(snapshot.get(), identifier));
+  }
+}
+
+// getBookmark against the resident store
+void BM_GetBookmark(benchmark::State& state) {
+  {
+    std::lock_guard<std::recursive_mutex> lock(plugin->store->mutex);
+    json& data = store_get(plugin);
+    json store = synthetic_store(state.range(0), 256);
+    for (auto& [identifier, bookmark] : store["bookmarks"].items()) {
+      data["bookmarks"][identifier] = bookmark;
+    }
+  }
+
+  int64_t i = 0;
+  for (auto _ : state) {
+    std::string identifier = "bookmark-" + std::to_string(i++ % state.range(0));
+    g_autoptr(FlValue) args = string_args({{"identifier", identifier.c_str()}});
+    g_autoptr(FlMethodResponse) response = dispatch_method_call(plugin, "getBookmark", args);
+    benchmark::DoNotOptimize(response);
+  }
+}
+
+void BM_ListFiles(benchmark::State& state) {
+  std::string identifier = file_tree(state.range(0));
+  g_autoptr(FlValue) args = string_args({{"identifier", identifier.c_str()}});
+
+  for (auto _ : state) {
+    g_autoptr(FlMethodResponse) response = dispatch_method_call(plugin, "listFiles", args);
+    if (!check_response(state, response)) {
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ReadFile(benchmark::State& state) {
+  std::string name = payload_file(state.range(0));
+  g_autoptr(FlValue) args = string_args({{"identifier", "payloads"}, {"fileName", name.c_str()}});
+
+  for (auto _ : state) {
+    g_autoptr(FlMethodResponse) response = dispatch_method_call(plugin, "readFile", args);
+    if (!check_response(state, response)) {
+      break;
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void BM_SaveFile(benchmark::State& state) {
+  payloads_dir();
+  std::vector<uint8_t> data(state.range(0), 0x5a);
+  g_autoptr(FlValue) args = string_args({{"identifier", "payloads"}, {"fileName", "saved.dat"}});
+  fl_value_set_string_take(args, "data", fl_value_new_uint8_list(data.data(), data.size()));
+
+  for (auto _ : state) {
+    g_autoptr(FlMethodResponse) response = dispatch_method_call(plugin, "saveFile", args);
+    if (!check_response(state, response)) {
+      break;
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+// Bookmark counts 10 to 100k with no, small and large metadata
+void store_sizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgsProduct({benchmark::CreateRange(10, 100000, 10), {0, 256, 4096}})
+      ->ArgNames({"bookmarks", "metadata"})
+      ->Unit(benchmark::kMicrosecond);
+}
+
+}  // namespace
+
+BENCHMARK(BM_LoadBookmarks)->Apply(store_sizes);
+BENCHMARK(BM_SaveBookmarks)->Apply(store_sizes);
+BENCHMARK(BM_SaveBookmarksBinary)->Apply(store_sizes);
+BENCHMARK(BM_OpenBinarySnapshot)->Apply(store_sizes);
+BENCHMARK(BM_BinarySnapshotFind)->RangeMultiplier(10)->Range(10, 100000)->ArgName("bookmarks");
+BENCHMARK(BM_GetBookmark)->RangeMultiplier(10)->Range(10, 100000)->ArgName("bookmarks");
+BENCHMARK(BM_ListFiles)
+    ->RangeMultiplier(100)->Range(1, 1000000)->ArgName("files")->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ReadFile)
+    ->RangeMultiplier(32)->Range(1 << 10, 1 << 30)->ArgName("bytes")
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SaveFile)
+    ->RangeMultiplier(32)->Range(1 << 10, 1 << 30)->ArgName("bytes")
+    ->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char** argv) {
+  // GLib caches the config directory on first use, so point it at the
+  // scratch space before the plugin is created
+  const fs::path& root = bench_root();
+  setenv("XDG_CONFIG_HOME", (root / "config").c_str(), 1);
+
+  std::vector<char*> args(argv, argv + argc);
+  std::string out_flag = "--benchmark_out=directory_bookmarks_benchmark.json";
+  std::string format_flag = "--benchmark_out_format=json";
+  bool has_out = std::any_of(args.begin() + 1, args.end(), [](const char* arg) {
+    return strncmp(arg, "--benchmark_out=", 16) == 0;
+  });
+  if (!has_out) {
+    args.push_back(out_flag.data());
+    args.push_back(format_flag.data());
+  }
+
+  int count = args.size();
+  benchmark::Initialize(&count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+    return 1;
+  }
+
+  plugin = DIRECTORY_BOOKMARKS_PLUGIN(g_object_new(directory_bookmarks_plugin_get_type(), nullptr));
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  g_object_unref(plugin);
+  fs::remove_all(root);
+  return 0;
+}
@@ -1,16 +1,64 @@
 #include "include/directory_bookmarks/directory_bookmarks_plugin.h"
 
 #include <flutter_linux/flutter_linux.h>
+#include <glib-unix.h>
 #include <gtk/gtk.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
+#include <linux/fs.h>
+#include <linux/io_uring.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
 #include "json.hpp"
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// USDT probes for tracing with bpftrace or perf, enabled with the
+// DIRECTORY_BOOKMARKS_USDT CMake option (needs sys/sdt.h)
+#ifdef DIRECTORY_BOOKMARKS_USDT
+#include <sys/sdt.h>
+#define BOOKMARKS_PROBE2(name, a, b) DTRACE_PROBE2(directory_bookmarks, name, a, b)
+#define BOOKMARKS_PROBE3(name, a, b, c) DTRACE_PROBE3(directory_bookmarks, name, a, b, c)
+#else
+#define BOOKMARKS_PROBE2(name, a, b) ((void)0)
+#define BOOKMARKS_PROBE3(name, a, b, c) ((void)0)
+#endif
+
 namespace fs = std::filesystem;
 using json = nlohmann::json;
 
@@ -18,12 +66,357 @@ using json = nlohmann::json;
   (G_TYPE_CHECK_INSTANCE_CAST((obj), directory_bookmarks_plugin_get_type(), \
                                DirectoryBookmarksPlugin))
 
+// On-disk identity of a file, used to notice changes made behind our back
+struct FileIdentity {
+  bool present = false;
+  dev_t dev = 0;
+  ino_t ino = 0;
+  off_t size = 0;
+  struct timespec mtime = {0, 0};
+
+  bool operator==(const FileIdentity& other) const {
+    return present == other.present && dev == other.dev && ino == other.ino &&
+           size == other.size && mtime.tv_sec == other.mtime.tv_sec &&
+           mtime.tv_nsec == other.mtime.tv_nsec;
+  }
+};
+
+// Latency histogram with four sub-buckets per power of two, so percentiles
+// are exact below 8ns and within 25% above, from nanoseconds to hours
+static constexpr size_t kLatencyBuckets = 256;
+
+struct LatencyHistogram {
+  uint64_t count = 0;
+  uint64_t total_ns = 0;
+  uint64_t max_ns = 0;
+  uint64_t buckets[kLatencyBuckets] = {};
+};
+
+static uint64_t monotonic_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t latency_bucket(uint64_t ns) {
+  if (ns < 8) {
+    return ns;
+  }
+  int log = 63 - __builtin_clzll(ns);
+  return (log - 1) * 4 + ((ns >> (log - 2)) & 3);
+}
+
+// Largest value that falls into `bucket`
+static uint64_t latency_bucket_limit(size_t bucket) {
+  if (bucket < 8) {
+    return bucket;
+  }
+  int log = bucket / 4 + 1;
+  uint64_t width = uint64_t{1} << (log - 2);
+  return (4 + bucket % 4) * width + width - 1;
+}
+
+static void latency_record(LatencyHistogram* histogram, uint64_t ns) {
+  histogram->count++;
+  histogram->total_ns += ns;
+  histogram->max_ns = std::max(histogram->max_ns, ns);
+  histogram->buckets[latency_bucket(ns)]++;
+}
+
+// Upper bound of the bucket holding the `fraction` quantile
+static uint64_t latency_quantile(const LatencyHistogram& histogram, double fraction) {
+  uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(histogram.count * fraction + 0.5));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kLatencyBuckets; i++) {
+    seen += histogram.buckets[i];
+    if (seen >= rank) {
+      return std::min(latency_bucket_limit(i), histogram.max_ns);
+    }
+  }
+  return histogram.max_ns;
+}
+
+// {count, totalNs, p50Ns, p99Ns, maxNs}
+static FlValue* latency_to_value(const LatencyHistogram& histogram) {
+  FlValue* value = fl_value_new_map();
+  fl_value_set_string_take(value, "count", fl_value_new_int(histogram.count));
+  fl_value_set_string_take(value, "totalNs", fl_value_new_int(histogram.total_ns));
+  fl_value_set_string_take(value, "p50Ns", fl_value_new_int(latency_quantile(histogram, 0.5)));
+  fl_value_set_string_take(value, "p99Ns", fl_value_new_int(latency_quantile(histogram, 0.99)));
+  fl_value_set_string_take(value, "maxNs", fl_value_new_int(histogram.max_ns));
+  return value;
+}
+
+// Call statistics reported by getStats. Method handlers record themselves
+// through dispatch_method_call; store I/O is timed in BookmarkStore.
+struct MethodStats {
+  LatencyHistogram latency;
+  uint64_t errors = 0;
+};
+
+struct CallStats {
+  std::mutex mutex;
+  std::unordered_map<std::string, MethodStats> methods;
+
+  // File payload bytes moved by the file operations
+  std::atomic<uint64_t> bytes_read{0};
+  std::atomic<uint64_t> bytes_written{0};
+
+  // Wall-clock time of the last reset, in microseconds since the epoch
+  std::atomic<int64_t> since_us{0};
+};
+
+// Parsed bookmarks.json kept resident for the lifetime of the plugin.
+//
+// The files are only re-read when their identity (device, inode, size, mtime)
+// differs from what we last loaded or wrote. An inotify watch on the config
+// directory tells us when that check is worth doing; without one we fall back
+// to a stat() per access, which is still far cheaper than reparsing.
+//
+// In journaled mode, mutations are appended to bookmarks.log as one JSON
+// record per line instead of rewriting the snapshot. Records carry a sequence
+// number and the snapshot stores the last one it includes (`journalSeq`), so
+// replay is safe whatever point a compaction was interrupted at.
+//
+// The snapshot is either bookmarks.json or the binary bookmarks.bin. A binary
+// snapshot is loaded lazily: `data` starts out empty and records are decoded
+// into it as they are looked up, with `removed` masking records the journal
+// deleted. Anything that needs the whole document materializes it first.
+struct BinarySnapshot;
+
+// Reverse index from bookmarked directory to identifier: a trie over the
+// components of the lexically normalized path. Several bookmarks may point at
+// the same directory, so each node keeps the set of identifiers ending there.
+struct PathTrieNode {
+  std::unordered_map<std::string, std::unique_ptr<PathTrieNode>> children;
+  std::set<std::string> identifiers;
+};
+
+struct PathIndex {
+  PathTrieNode root;
+  // Path each identifier was indexed under, so it can be removed again
+  std::unordered_map<std::string, std::vector<std::string>> indexed;
+  bool valid = false;
+};
+
+// Secondary indexes behind listBookmarks queries. Like the path index they
+// are rebuilt lazily after a load and then kept current by store_commit.
+// Metadata keys are indexed on first use as a filter, by serialized value.
+struct MetadataIndex {
+  std::unordered_map<std::string, std::set<std::string>> by_value;
+  // Value each identifier was indexed under
+  std::unordered_map<std::string, std::string> indexed;
+};
+
+struct QueryIndex {
+  // (createdAt, identifier), so ties keep identifier order
+  std::set<std::pair<std::string, std::string>> by_created;
+  std::unordered_map<std::string, std::string> created;
+  std::map<std::string, MetadataIndex> metadata;
+  bool valid = false;
+};
+
+// Header shared by every process using the store in multi-process mode,
+// mapped from the start of bookmarks.lock. Each successful write under the
+// lock bumps `generation`, so a process only has to compare it with the
+// generation it last loaded to know whether its resident copy is current.
+struct SharedStoreHeader {
+  std::atomic<uint64_t> generation;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the generation counter must be usable across processes");
+static constexpr size_t kSharedStoreHeaderSize = 64;
+
+// How hard a write works to survive a crash or power loss:
+//   none     write in place; fastest, readers may see a partial file
+//   atomic   write out of place and rename over the target
+//   durable  atomic, plus fdatasync of the data and fsync of the directory
+// The bookmark store itself is always at least atomic.
+enum Durability : uint8_t {
+  kDurabilityNone = 0,
+  kDurabilityAtomic = 1,
+  kDurabilityDurable = 2,
+};
+
+struct BookmarkStore {
+  std::string config_path;
+  std::string bin_path;
+  std::string log_path;
+  std::string lock_path;
+  json data;
+  bool loaded = false;
+
+  // Snapshot format to write; follows whatever was loaded until configured
+  bool binary = false;
+  bool format_configured = false;
+  std::unique_ptr<BinarySnapshot> snapshot;
+  std::set<std::string> removed;
+
+  // Rebuilt lazily after a load, then kept current by store_commit
+  PathIndex path_index;
+  QueryIndex query_index;
+
+  // Prebuilt listBookmarks/getBookmark results, built on first use and
+  // dropped when the bookmark (or anything, for the list) changes
+  FlValue* list_value = nullptr;
+  std::unordered_map<std::string, FlValue*> bookmark_values;
+
+  FileIdentity snapshot_identity;
+  FileIdentity bin_identity;
+  FileIdentity log_identity;
+
+  int inotify_fd = -1;
+
+  bool journal = false;
+  size_t journal_max_records = 1000;
+  off_t journal_max_bytes = 1 << 20;
+  uint64_t journal_seq = 0;
+  size_t log_records = 0;
+  bool compacting = false;
+
+  // Bumped whenever the snapshot is written or the store reloaded, so a
+  // background compaction can tell that its copy of the data went stale
+  uint64_t snapshot_epoch = 0;
+
+  // Held for the duration of any access to `data` or the identity fields,
+  // since handlers may run on worker threads in async dispatch mode.
+  // Recursive so executeBatch can hold it across the handlers it runs.
+  std::recursive_mutex mutex;
+
+  // Commits are deferred while executeBatch runs and written once at the end
+  int batch_depth = 0;
+  std::set<std::string> batch_changes;
+
+  // Write-behind: when non-zero, commits are queued in `pending_changes` and
+  // written together once this many milliseconds have passed since the first
+  // of them. `flush_source` is the main-context timer doing that.
+  guint write_behind_ms = 0;
+  std::set<std::string> pending_changes;
+  guint flush_source = 0;
+
+  // Multi-process mode: writers hold an OFD write lock on `lock_fd` from
+  // before they re-check the store until their change is on disk, and
+  // reloads take a read lock. `lock_depth` counts nested StoreWriteGuards
+  // so only the outermost one locks; `published` marks that the files were
+  // written under the current lock and the generation must be bumped.
+  bool multi_process = false;
+  int lock_fd = -1;
+  SharedStoreHeader* shared = nullptr;
+  uint64_t generation = 0;
+  int lock_depth = 0;
+  bool published = false;
+
+  // Time spent loading and writing the files, under `mutex` like the rest
+  LatencyHistogram load_latency;
+  LatencyHistogram save_latency;
+  LatencyHistogram journal_latency;
+
+  // Default for file writes that don't ask for a mode, and whether store
+  // writes are synced. Read without `mutex` by the file handlers.
+  std::atomic<uint8_t> durability{kDurabilityNone};
+};
+
+struct DispatchJob;
+
+// Worker pool used in async dispatch mode.
+//
+// Calls are queued per lane (the bookmark identifier they target), so
+// operations on one bookmark run in arrival order while calls on different
+// bookmarks overlap. Only the head of each lane is ever in the pool.
+struct Dispatcher {
+  bool async = false;
+  guint max_threads = 4;
+  GThreadPool* pool = nullptr;
+
+  std::mutex mutex;
+  std::unordered_map<std::string, std::deque<DispatchJob*>> lanes;
+};
+
+// Base for long-running operations that report through the events channel.
+//
+// Every event carries the Dart-assigned `streamId` so a single EventChannel
+// can multiplex any number of concurrent streams.
+struct EventStream {
+  int64_t id = 0;
+  std::atomic<bool> cancelled{false};
+
+  // Runs once after `cancelled` is set, outside the stream registry lock.
+  // Streams driven by a worker thread just notice the flag instead.
+  virtual void on_cancel() {}
+
+  virtual ~EventStream() = default;
+};
+
+struct EventStreams {
+  std::mutex mutex;
+  std::unordered_map<int64_t, std::shared_ptr<EventStream>> active;
+};
+
+// Open handle on a bookmarked directory, shared by the file operations on it.
+// File names are resolved relative to `fd`, so the directory itself is only
+// looked up by path when the handle is opened.
+struct BookmarkDir {
+  int fd = -1;  // O_PATH | O_DIRECTORY
+  std::string path;
+
+  ~BookmarkDir() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+};
+
+struct BookmarkDirs {
+  std::mutex mutex;
+  std::unordered_map<std::string, std::shared_ptr<BookmarkDir>> open;
+};
+
+struct WriteSessions;
+struct Watcher;
+struct DigestCache;
+struct Validations;
+struct UsageCache;
+
 struct _DirectoryBookmarksPlugin {
   GObject parent_instance;
+  BookmarkStore* store;
+  Dispatcher* dispatcher;
+
+  // Shared channel for streamed results; only touched on the main context
+  FlEventChannel* events;
+  bool events_listening;
+  EventStreams* streams;
+
+  BookmarkDirs* dirs;
+  WriteSessions* write_sessions;
+  Watcher* watcher;
+  DigestCache* digests;
+  CallStats* stats;
+  Validations* validations;
+  UsageCache* usage;
 };
 
 G_DEFINE_TYPE(DirectoryBookmarksPlugin, directory_bookmarks_plugin, g_object_get_type())
 
+// Add file payload bytes moved by a file operation to the call statistics
+static void stats_count_bytes(DirectoryBookmarksPlugin* self, uint64_t read, uint64_t written) {
+  self->stats->bytes_read += read;
+  self->stats->bytes_written += written;
+}
+
+// Record one handled call under `method`
+static void stats_record_call(DirectoryBookmarksPlugin* self, const char* method, uint64_t ns,
+                              bool error) {
+  BOOKMARKS_PROBE3(method__done, method, ns, error);
+
+  std::lock_guard<std::mutex> lock(self->stats->mutex);
+  MethodStats& stats = self->stats->methods[method];
+  latency_record(&stats.latency, ns);
+  if (error) {
+    stats.errors++;
+  }
+}
+
 // Helper function to get the bookmarks config file path
 static std::string get_bookmarks_config_path() {
   const char* config_home = g_get_user_config_dir();
@@ -40,6 +433,16 @@ static FlValue* fl_value_new_string_safe(const std::string& str) {
   return fl_value_new_string(str.c_str());
 }
 
+static gboolean object_unref_cb(gpointer user_data) {
+  g_object_unref(user_data);
+  return G_SOURCE_REMOVE;
+}
+
+// Drop a reference from a worker thread so dispose always runs on the main context
+static void object_unref_on_main(gpointer object) {
+  g_main_context_invoke_full(nullptr, G_PRIORITY_DEFAULT, object_unref_cb, object, nullptr);
+}
+
 // Helper function to get current timestamp in ISO8601 format
 static std::string get_iso8601_timestamp() {
   time_t now = time(nullptr);
@@ -48,13 +451,72 @@ static std::string get_iso8601_timestamp() {
   return std::string(timestamp);
 }
 
-// Helper function to convert FlValue map to json
-static json fl_value_to_json(FlValue* value) {
-  if (value == nullptr || fl_value_get_type(value) == FL_VALUE_TYPE_NULL) {
-    return json::object();
+// Convert any FlValue to json. Maps with non-string keys and custom values
+// have no json equivalent and become null; typed lists become plain arrays.
+static json fl_value_to_json_value(FlValue* value) {
+  if (value == nullptr) {
+    return nullptr;
+  }
+
+  // fl_value_get_length only accepts list and map types
+  switch (fl_value_get_type(value)) {
+    case FL_VALUE_TYPE_STRING:
+      return fl_value_get_string(value);
+    case FL_VALUE_TYPE_INT:
+      return fl_value_get_int(value);
+    case FL_VALUE_TYPE_FLOAT:
+      return fl_value_get_float(value);
+    case FL_VALUE_TYPE_BOOL:
+      return static_cast<bool>(fl_value_get_bool(value));
+    case FL_VALUE_TYPE_UINT8_LIST: {
+      const uint8_t* items = fl_value_get_uint8_list(value);
+      return json(std::vector<uint8_t>(items, items + fl_value_get_length(value)));
+    }
+    case FL_VALUE_TYPE_INT32_LIST: {
+      const int32_t* items = fl_value_get_int32_list(value);
+      return json(std::vector<int32_t>(items, items + fl_value_get_length(value)));
+    }
+    case FL_VALUE_TYPE_INT64_LIST: {
+      const int64_t* items = fl_value_get_int64_list(value);
+      return json(std::vector<int64_t>(items, items + fl_value_get_length(value)));
+    }
+    case FL_VALUE_TYPE_FLOAT32_LIST: {
+      const float* items = fl_value_get_float32_list(value);
+      return json(std::vector<float>(items, items + fl_value_get_length(value)));
+    }
+    case FL_VALUE_TYPE_FLOAT_LIST: {
+      const double* items = fl_value_get_float_list(value);
+      return json(std::vector<double>(items, items + fl_value_get_length(value)));
+    }
+    case FL_VALUE_TYPE_LIST: {
+      json result = json::array();
+      size_t length = fl_value_get_length(value);
+      for (size_t i = 0; i < length; i++) {
+        result.push_back(fl_value_to_json_value(fl_value_get_list_value(value, i)));
+      }
+      return result;
+    }
+    case FL_VALUE_TYPE_MAP: {
+      json result = json::object();
+      size_t length = fl_value_get_length(value);
+      for (size_t i = 0; i < length; i++) {
+        FlValue* key_value = fl_value_get_map_key(value, i);
+        if (fl_value_get_type(key_value) != FL_VALUE_TYPE_STRING) {
+          return nullptr;
+        }
+        result[fl_value_get_string(key_value)] =
+            fl_value_to_json_value(fl_value_get_map_value(value, i));
+      }
+      return result;
+    }
+    default:
+      return nullptr;
   }
+}
 
-  if (fl_value_get_type(value) != FL_VALUE_TYPE_MAP) {
+// Helper function to convert FlValue map to json
+static json fl_value_to_json(FlValue* value) {
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_MAP) {
     return json::object();
   }
 
@@ -63,80 +525,119 @@ static json fl_value_to_json(FlValue* value) {
 
   for (size_t i = 0; i < length; i++) {
     FlValue* key_value = fl_value_get_map_key(value, i);
-    FlValue* val = fl_value_get_map_value(value, i);
-
     if (fl_value_get_type(key_value) == FL_VALUE_TYPE_STRING) {
-      const char* key = fl_value_get_string(key_value);
-
-      switch (fl_value_get_type(val)) {
-        case FL_VALUE_TYPE_STRING:
-          result[key] = fl_value_get_string(val);
-          break;
-        case FL_VALUE_TYPE_INT:
-          result[key] = fl_value_get_int(val);
-          break;
-        case FL_VALUE_TYPE_FLOAT:
-          result[key] = fl_value_get_float(val);
-          break;
-        case FL_VALUE_TYPE_BOOL:
-          result[key] = fl_value_get_bool(val);
-          break;
-        default:
-          result[key] = nullptr;
-          break;
-      }
+      result[fl_value_get_string(key_value)] =
+          fl_value_to_json_value(fl_value_get_map_value(value, i));
     }
   }
 
   return result;
 }
 
+// Convert any json value to FlValue, strings copied straight out of the json
+static FlValue* json_value_to_fl_value(const json& j) {
+  switch (j.type()) {
+    case json::value_t::string: {
+      const std::string& text = j.get_ref<const std::string&>();
+      return fl_value_new_string_sized(text.data(), text.size());
+    }
+    case json::value_t::number_integer:
+      return fl_value_new_int(j.get<int64_t>());
+    case json::value_t::number_unsigned:
+      // Dart ints are 64-bit signed; larger values wrap like they would in Dart
+      return fl_value_new_int(static_cast<int64_t>(j.get<uint64_t>()));
+    case json::value_t::number_float:
+      return fl_value_new_float(j.get<double>());
+    case json::value_t::boolean:
+      return fl_value_new_bool(j.get<bool>());
+    case json::value_t::array: {
+      FlValue* result = fl_value_new_list();
+      for (const json& item : j) {
+        fl_value_append_take(result, json_value_to_fl_value(item));
+      }
+      return result;
+    }
+    case json::value_t::object: {
+      FlValue* result = fl_value_new_map();
+      for (const auto& [key, value] : j.items()) {
+        fl_value_set_string_take(result, key.c_str(), json_value_to_fl_value(value));
+      }
+      return result;
+    }
+    default:
+      return fl_value_new_null();
+  }
+}
+
 // Helper function to convert json to FlValue map
 static FlValue* json_to_fl_value(const json& j) {
-  if (j.is_null() || !j.is_object()) {
+  if (!j.is_object()) {
     return fl_value_new_map();
   }
 
-  g_autoptr(FlValue) result = fl_value_new_map();
+  return json_value_to_fl_value(j);
+}
 
-  for (auto& [key, value] : j.items()) {
-    if (value.is_string()) {
-      fl_value_set_string_take(result, key.c_str(),
-                               fl_value_new_string(value.get<std::string>().c_str()));
-    } else if (value.is_number_integer()) {
-      fl_value_set_string_take(result, key.c_str(),
-                               fl_value_new_int(value.get<int64_t>()));
-    } else if (value.is_number_float()) {
-      fl_value_set_string_take(result, key.c_str(),
-                               fl_value_new_float(value.get<double>()));
-    } else if (value.is_boolean()) {
-      fl_value_set_string_take(result, key.c_str(),
-                               fl_value_new_bool(value.get<bool>()));
+// Write the whole buffer, retrying short writes
+static bool write_full(int fd, const uint8_t* data, size_t length) {
+  while (length > 0) {
+    ssize_t n = write(fd, data, length);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
     }
+    data += n;
+    length -= n;
+  }
+  return true;
+}
+
+// Flush a directory's entries, so a file created or renamed in it survives
+// a crash. fsync() needs a real descriptor, an O_PATH one gets EBADF.
+static bool directory_sync(int base_fd, const char* path) {
+  int fd = openat(base_fd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
   }
+  bool ok = fsync(fd) == 0;
+  int saved_errno = errno;
+  close(fd);
+  errno = saved_errno;
+  return ok;
+}
 
-  return fl_value_ref(result);
+// Flush the data of the file at `path`
+static bool file_sync_path(const std::string& path) {
+  int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = fdatasync(fd) == 0;
+  close(fd);
+  return ok;
 }
 
-// Load all bookmarks from storage
-static json load_bookmarks() {
-  std::string config_path = get_bookmarks_config_path();
+// Helper function to create an empty bookmark store document
+static json empty_bookmarks() {
+  return json{
+    {"version", "2.0"},
+    {"bookmarks", json::object()}
+  };
+}
 
+// Load all bookmarks from storage
+static json load_bookmarks(const std::string& config_path) {
   // If file doesn't exist, return empty structure
   if (!fs::exists(config_path)) {
-    return json{
-      {"version", "2.0"},
-      {"bookmarks", json::object()}
-    };
+    return empty_bookmarks();
   }
 
   try {
     std::ifstream in(config_path);
     if (!in.is_open()) {
-      return json{
-        {"version", "2.0"},
-        {"bookmarks", json::object()}
-      };
+      return empty_bookmarks();
     }
 
     json data = json::parse(in);
@@ -144,25 +645,19 @@ static json load_bookmarks() {
 
     // Validate structure
     if (!data.contains("bookmarks") || !data["bookmarks"].is_object()) {
-      return json{
-        {"version", "2.0"},
-        {"bookmarks", json::object()}
-      };
+      return empty_bookmarks();
     }
 
     return data;
   } catch (const std::exception& e) {
     // Parse error - return empty structure
-    return json{
-      {"version", "2.0"},
-      {"bookmarks", json::object()}
-    };
+    return empty_bookmarks();
   }
 }
 
-// Save all bookmarks to storage (atomic write)
-static bool save_bookmarks(const json& data) {
-  std::string config_path = get_bookmarks_config_path();
+// Save all bookmarks to storage (atomic write). A durable save also syncs
+// the data before the rename and the directory after it.
+static bool save_bookmarks(const std::string& config_path, const json& data, bool durable) {
   std::string temp_path = config_path + ".tmp";
 
   try {
@@ -173,9 +668,16 @@ static bool save_bookmarks(const json& data) {
 
     out << data.dump(2);  // Pretty print with 2-space indent
     out.close();
+    if (out.fail() || (durable && !file_sync_path(temp_path))) {
+      fs::remove(temp_path);
+      return false;
+    }
 
     // Atomic rename
     fs::rename(temp_path, config_path);
+    if (durable) {
+      directory_sync(AT_FDCWD, fs::path(config_path).parent_path().c_str());
+    }
     return true;
   } catch (const std::exception& e) {
     // Clean up temp file if it exists
@@ -186,546 +688,8159 @@ static bool save_bookmarks(const json& data) {
   }
 }
 
-// Method: createBookmark
-static FlMethodResponse* create_bookmark(FlValue* args) {
-  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
-  FlValue* path_value = fl_value_lookup_string(args, "path");
+// Binary snapshot (bookmarks.bin), an alternative to bookmarks.json for fast
+// cold starts. All integers are little-endian:
+//
+//   u8[8]  magic "DBKSNAP\0"
+//   u32    format version
+//   u32    record count
+//   u64    journalSeq
+//   u64    total file size (catches truncated copies)
+//   str    store version ("2.0")
+//   u32[count]  record offsets, ordered by identifier
+//   records: str id, str path, blob (MessagePack of the remaining fields)
+//
+// where str and blob are a u32 length followed by that many bytes. The file
+// is mapped read-only and records are only decoded when looked up, so opening
+// it costs the same however many bookmarks it holds. Writers always replace
+// the file by rename, never in place, so the mapping cannot be truncated
+// under us.
+static const char kBinarySnapshotMagic[8] = {'D', 'B', 'K', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t kBinarySnapshotVersion = 1;
+static const size_t kBinarySnapshotHeaderSize = 32;
+
+struct BinarySnapshot {
+  uint8_t* base = nullptr;
+  size_t size = 0;
+  uint32_t count = 0;
+  uint64_t journal_seq = 0;
+  std::string version;
+  const uint8_t* offsets = nullptr;
+
+  ~BinarySnapshot() {
+    if (base != nullptr) {
+      munmap(base, size);
+    }
+  }
+};
 
-  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+static void put_u32(std::string& out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
   }
+}
 
-  if (path_value == nullptr || fl_value_get_type(path_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "path must be a string", nullptr));
+static void put_u64(std::string& out, uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
   }
+}
 
-  const char* identifier = fl_value_get_string(identifier_value);
-  const char* path = fl_value_get_string(path_value);
+static void put_str(std::string& out, const std::string& value) {
+  put_u32(out, static_cast<uint32_t>(value.size()));
+  out += value;
+}
 
-  // Validate directory exists and is accessible
-  struct stat st;
-  if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "DIRECTORY_NOT_FOUND", "Directory not found or is not accessible", nullptr));
-  }
+static uint32_t get_u32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
 
-  // Load existing bookmarks
-  json data = load_bookmarks();
+static uint64_t get_u64(const uint8_t* p) {
+  return static_cast<uint64_t>(get_u32(p)) | (static_cast<uint64_t>(get_u32(p + 4)) << 32);
+}
 
-  // Check if bookmark already exists
-  if (data["bookmarks"].contains(identifier)) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "BOOKMARK_ALREADY_EXISTS",
-        ("Bookmark with identifier '" + std::string(identifier) + "' already exists").c_str(),
-        nullptr));
+// Read a length-prefixed string at `*pos`, advancing past it
+static bool get_str(const BinarySnapshot* snapshot, size_t* pos, const char** out,
+                    size_t* out_length) {
+  if (*pos + 4 > snapshot->size) {
+    return false;
+  }
+  size_t length = get_u32(snapshot->base + *pos);
+  if (length > snapshot->size - *pos - 4) {
+    return false;
   }
 
-  // Create bookmark entry
-  json bookmark = {
-    {"id", identifier},
-    {"path", path},
-    {"createdAt", get_iso8601_timestamp()},
-    {"metadata", json::object()}
-  };
+  *out = reinterpret_cast<const char*>(snapshot->base + *pos + 4);
+  *out_length = length;
+  *pos += 4 + length;
+  return true;
+}
 
-  // Handle custom metadata if provided
-  FlValue* metadata_value = fl_value_lookup_string(args, "metadata");
-  if (metadata_value != nullptr && fl_value_get_type(metadata_value) == FL_VALUE_TYPE_MAP) {
-    bookmark["metadata"] = fl_value_to_json(metadata_value);
-  }
+// Serialize the store into the binary snapshot layout
+static bool encode_binary_snapshot(const json& data, std::string& out) {
+  const json& bookmarks = data["bookmarks"];
+
+  out.assign(kBinarySnapshotMagic, sizeof(kBinarySnapshotMagic));
+  put_u32(out, kBinarySnapshotVersion);
+  put_u32(out, static_cast<uint32_t>(bookmarks.size()));
+  put_u64(out, data.value("journalSeq", uint64_t{0}));
+  size_t size_pos = out.size();
+  put_u64(out, 0);
+  put_str(out, data.value("version", "2.0"));
+
+  size_t table_pos = out.size();
+  out.resize(table_pos + 4 * bookmarks.size());
+
+  // json objects iterate in key order, which is what lookups bisect on
+  std::vector<uint32_t> offsets;
+  offsets.reserve(bookmarks.size());
+  for (const auto& [id, bookmark] : bookmarks.items()) {
+    if (out.size() > std::numeric_limits<uint32_t>::max()) {
+      return false;
+    }
+    offsets.push_back(static_cast<uint32_t>(out.size()));
 
-  // Add to bookmarks
-  data["bookmarks"][identifier] = bookmark;
+    json rest = bookmark;
+    rest.erase("id");
+    rest.erase("path");
+    std::vector<uint8_t> packed = json::to_msgpack(rest);
 
-  // Save to storage
-  if (!save_bookmarks(data)) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "WRITE_ERROR", "Failed to save bookmark", nullptr));
+    put_str(out, id);
+    put_str(out, bookmark.value("path", ""));
+    put_u32(out, static_cast<uint32_t>(packed.size()));
+    out.append(reinterpret_cast<const char*>(packed.data()), packed.size());
+  }
+  if (out.size() > std::numeric_limits<uint32_t>::max()) {
+    return false;
   }
 
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(
-      fl_value_new_string(identifier)));
+  std::string table;
+  for (uint32_t offset : offsets) {
+    put_u32(table, offset);
+  }
+  out.replace(table_pos, table.size(), table);
+
+  std::string size;
+  put_u64(size, out.size());
+  out.replace(size_pos, size.size(), size);
+  return true;
 }
 
-// Method: listBookmarks
-static FlMethodResponse* list_bookmarks() {
-  json data = load_bookmarks();
-  g_autoptr(FlValue) result = fl_value_new_list();
+// Save all bookmarks as a binary snapshot (atomic write, synced if durable)
+static bool save_bookmarks_binary(const std::string& bin_path, const json& data,
+                                  bool durable) {
+  std::string encoded;
+  if (!encode_binary_snapshot(data, encoded)) {
+    return false;
+  }
+
+  std::string temp_path = bin_path + ".tmp";
+  int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
 
-  for (auto& [id, bookmark] : data["bookmarks"].items()) {
-    g_autoptr(FlValue) bookmark_map = fl_value_new_map();
+  bool ok = write_full(fd, reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+  if (ok && durable && fdatasync(fd) != 0) {
+    ok = false;
+  }
+  if (close(fd) != 0) {
+    ok = false;
+  }
+  if (!ok || rename(temp_path.c_str(), bin_path.c_str()) != 0) {
+    unlink(temp_path.c_str());
+    return false;
+  }
+  if (durable) {
+    directory_sync(AT_FDCWD, fs::path(bin_path).parent_path().c_str());
+  }
 
-    fl_value_set_string_take(bookmark_map, "identifier",
-                             fl_value_new_string(bookmark["id"].get<std::string>().c_str()));
-    fl_value_set_string_take(bookmark_map, "path",
-                             fl_value_new_string(bookmark["path"].get<std::string>().c_str()));
-    fl_value_set_string_take(bookmark_map, "createdAt",
-                             fl_value_new_string(bookmark["createdAt"].get<std::string>().c_str()));
+  return true;
+}
 
-    if (bookmark.contains("metadata") && bookmark["metadata"].is_object()) {
-      fl_value_set_string_take(bookmark_map, "metadata",
-                               json_to_fl_value(bookmark["metadata"]));
-    } else {
-      fl_value_set_string_take(bookmark_map, "metadata", fl_value_new_map());
+// Encode `data` in either snapshot format into `temp_path`, without
+// publishing it; the caller renames it into place
+static bool snapshot_write_temp(const std::string& temp_path, const json& data, bool binary,
+                                bool durable) {
+  std::string encoded;
+  if (binary) {
+    if (!encode_binary_snapshot(data, encoded)) {
+      return false;
+    }
+  } else {
+    try {
+      encoded = data.dump(2);
+    } catch (const std::exception& e) {
+      return false;
     }
+  }
 
-    fl_value_append_take(result, fl_value_ref(bookmark_map));
+  int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
   }
 
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  bool ok = write_full(fd, reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+  if (ok && durable && fdatasync(fd) != 0) {
+    ok = false;
+  }
+  if (close(fd) != 0) {
+    ok = false;
+  }
+  if (!ok) {
+    unlink(temp_path.c_str());
+  }
+  return ok;
 }
 
-// Method: getBookmark
-static FlMethodResponse* get_bookmark(FlValue* args) {
-  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
-
-  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+// Map a binary snapshot, validating only its header and offset table
+static std::unique_ptr<BinarySnapshot> binary_snapshot_open(const std::string& bin_path) {
+  int fd = open(bin_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
   }
 
-  const char* identifier = fl_value_get_string(identifier_value);
-  json data = load_bookmarks();
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kBinarySnapshotHeaderSize) {
+    close(fd);
+    return nullptr;
+  }
 
-  // Check if bookmark exists
-  if (!data["bookmarks"].contains(identifier)) {
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_null()));
+  void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return nullptr;
   }
 
-  json bookmark = data["bookmarks"][identifier];
+  auto snapshot = std::make_unique<BinarySnapshot>();
+  snapshot->base = static_cast<uint8_t*>(base);
+  snapshot->size = st.st_size;
 
-  g_autoptr(FlValue) result = fl_value_new_map();
-  fl_value_set_string_take(result, "identifier",
-                           fl_value_new_string(bookmark["id"].get<std::string>().c_str()));
-  fl_value_set_string_take(result, "path",
-                           fl_value_new_string(bookmark["path"].get<std::string>().c_str()));
-  fl_value_set_string_take(result, "createdAt",
-                           fl_value_new_string(bookmark["createdAt"].get<std::string>().c_str()));
-
-  if (bookmark.contains("metadata") && bookmark["metadata"].is_object()) {
-    fl_value_set_string_take(result, "metadata",
-                             json_to_fl_value(bookmark["metadata"]));
-  } else {
-    fl_value_set_string_take(result, "metadata", fl_value_new_map());
+  const uint8_t* p = snapshot->base;
+  if (memcmp(p, kBinarySnapshotMagic, sizeof(kBinarySnapshotMagic)) != 0 ||
+      get_u32(p + 8) != kBinarySnapshotVersion || get_u64(p + 24) != snapshot->size) {
+    return nullptr;
   }
+  snapshot->count = get_u32(p + 12);
+  snapshot->journal_seq = get_u64(p + 16);
+
+  size_t pos = kBinarySnapshotHeaderSize;
+  const char* version;
+  size_t version_length;
+  if (!get_str(snapshot.get(), &pos, &version, &version_length) ||
+      snapshot->count > (snapshot->size - pos) / 4) {
+    return nullptr;
+  }
+  snapshot->version.assign(version, version_length);
+  snapshot->offsets = snapshot->base + pos;
 
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  return snapshot;
 }
 
-// Method: bookmarkExists
-static FlMethodResponse* bookmark_exists(FlValue* args) {
-  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+// Read the identifier of record `index`
+static bool binary_snapshot_id(const BinarySnapshot* snapshot, uint32_t index,
+                               const char** id, size_t* id_length) {
+  size_t pos = get_u32(snapshot->offsets + 4 * static_cast<size_t>(index));
+  return get_str(snapshot, &pos, id, id_length);
+}
 
-  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+// Decode record `index` into its identifier and bookmark object
+static bool binary_snapshot_decode(const BinarySnapshot* snapshot, uint32_t index,
+                                   std::string& out_id, json& out_bookmark) {
+  size_t pos = get_u32(snapshot->offsets + 4 * static_cast<size_t>(index));
+  const char* id;
+  size_t id_length;
+  const char* path;
+  size_t path_length;
+  const char* packed;
+  size_t packed_length;
+  if (!get_str(snapshot, &pos, &id, &id_length) ||
+      !get_str(snapshot, &pos, &path, &path_length) ||
+      !get_str(snapshot, &pos, &packed, &packed_length)) {
+    return false;
   }
 
-  const char* identifier = fl_value_get_string(identifier_value);
-  json data = load_bookmarks();
+  json bookmark = json::from_msgpack(packed, packed + packed_length, true, false);
+  if (!bookmark.is_object()) {
+    return false;
+  }
 
-  bool exists = data["bookmarks"].contains(identifier);
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(exists)));
+  out_id.assign(id, id_length);
+  bookmark["id"] = out_id;
+  bookmark["path"] = std::string(path, path_length);
+  out_bookmark = std::move(bookmark);
+  return true;
 }
 
-// Method: deleteBookmark
-static FlMethodResponse* delete_bookmark(FlValue* args) {
-  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+// Binary search the offset table for `identifier`, returning its index or -1
+static int64_t binary_snapshot_find(const BinarySnapshot* snapshot, const std::string& identifier) {
+  int64_t low = 0;
+  int64_t high = static_cast<int64_t>(snapshot->count) - 1;
+
+  while (low <= high) {
+    int64_t mid = low + (high - low) / 2;
+    const char* id;
+    size_t id_length;
+    if (!binary_snapshot_id(snapshot, static_cast<uint32_t>(mid), &id, &id_length)) {
+      return -1;
+    }
 
-  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+    int order = identifier.compare(0, std::string::npos, id, id_length);
+    if (order == 0) {
+      return mid;
+    }
+    if (order < 0) {
+      high = mid - 1;
+    } else {
+      low = mid + 1;
+    }
   }
 
-  const char* identifier = fl_value_get_string(identifier_value);
-  json data = load_bookmarks();
+  return -1;
+}
 
-  // Check if bookmark exists
-  if (!data["bookmarks"].contains(identifier)) {
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+// Read the on-disk identity of a file (all zero when it does not exist)
+static FileIdentity file_identity_read(const std::string& path) {
+  FileIdentity identity;
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return identity;
   }
 
-  // Remove bookmark
-  data["bookmarks"].erase(identifier);
+  identity.present = true;
+  identity.dev = st.st_dev;
+  identity.ino = st.st_ino;
+  identity.size = st.st_size;
+  identity.mtime = st.st_mtim;
+  return identity;
+}
 
-  // Save to storage
-  if (!save_bookmarks(data)) {
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
-  }
+// Check whether the store files changed since they were last loaded or written
+static bool store_identity_changed(BookmarkStore* store) {
+  return !(file_identity_read(store->config_path) == store->snapshot_identity) ||
+         !(file_identity_read(store->bin_path) == store->bin_identity) ||
+         !(file_identity_read(store->log_path) == store->log_identity);
+}
 
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+// Apply one journal record to the resident store
+static void apply_journal_record(BookmarkStore* store, const json& record) {
+  std::string op = record.value("op", "");
+  std::string identifier = record.value("id", "");
+
+  if (op == "put" && record.contains("bookmark")) {
+    store->data["bookmarks"][identifier] = record["bookmark"];
+    store->removed.erase(identifier);
+  } else if (op == "delete") {
+    store->data["bookmarks"].erase(identifier);
+    if (store->snapshot) {
+      store->removed.insert(identifier);
+    }
+  }
 }
 
-// Method: updateBookmarkMetadata
-static FlMethodResponse* update_bookmark_metadata(FlValue* args) {
-  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
-  FlValue* metadata_value = fl_value_lookup_string(args, "metadata");
+// Replay journal records newer than the snapshot on top of it.
+//
+// Returns the number of records applied. A torn final record left by an
+// interrupted append is cut off so later appends start on a clean line.
+static size_t replay_journal(BookmarkStore* store) {
+  std::ifstream in(store->log_path, std::ios::binary);
+  if (!in.is_open()) {
+    return 0;
+  }
 
-  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  size_t applied = 0;
+  off_t valid_size = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (in.eof()) {
+      // Last line without a trailing newline was never fully appended
+      break;
+    }
+
+    json record = json::parse(line, nullptr, false);
+    if (record.is_discarded() || !record.is_object()) {
+      break;
+    }
+    valid_size += line.size() + 1;
+
+    uint64_t seq = record.value("seq", uint64_t{0});
+    if (seq > store->journal_seq) {
+      apply_journal_record(store, record);
+      store->journal_seq = seq;
+      applied++;
+    }
   }
+  in.close();
 
-  if (metadata_value == nullptr || fl_value_get_type(metadata_value) != FL_VALUE_TYPE_MAP) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "metadata must be a map", nullptr));
+  if (valid_size < file_identity_read(store->log_path).size) {
+    truncate(store->log_path.c_str(), valid_size);
   }
 
-  const char* identifier = fl_value_get_string(identifier_value);
-  json data = load_bookmarks();
+  return applied;
+}
 
-  // Check if bookmark exists
-  if (!data["bookmarks"].contains(identifier)) {
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+// Drain pending inotify events, returning true if any concerned the store files
+static bool store_drain_events(BookmarkStore* store) {
+  alignas(struct inotify_event) char buffer[4096];
+  bool touched = false;
+
+  for (;;) {
+    ssize_t length = read(store->inotify_fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      break;
+    }
+
+    for (char* ptr = buffer; ptr < buffer + length;) {
+      auto* event = reinterpret_cast<struct inotify_event*>(ptr);
+      if (event->mask & IN_IGNORED) {
+        // Config directory went away; fall back to stat() on every access
+        close(store->inotify_fd);
+        store->inotify_fd = -1;
+        return true;
+      }
+      if ((event->mask & IN_Q_OVERFLOW) ||
+          (event->len > 0 && (strcmp(event->name, "bookmarks.json") == 0 ||
+                              strcmp(event->name, "bookmarks.bin") == 0 ||
+                              strcmp(event->name, "bookmarks.log") == 0))) {
+        touched = true;
+      }
+      ptr += sizeof(struct inotify_event) + event->len;
+    }
   }
 
-  // Update metadata
-  data["bookmarks"][identifier]["metadata"] = fl_value_to_json(metadata_value);
+  return touched;
+}
 
-  // Save to storage
-  if (!save_bookmarks(data)) {
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+static BookmarkStore* bookmark_store_new() {
+  auto* store = new BookmarkStore();
+  store->config_path = get_bookmarks_config_path();
+
+  std::string config_dir = fs::path(store->config_path).parent_path().string();
+  store->bin_path = config_dir + "/bookmarks.bin";
+  store->log_path = config_dir + "/bookmarks.log";
+  store->lock_path = config_dir + "/bookmarks.lock";
+
+  store->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (store->inotify_fd >= 0 &&
+      inotify_add_watch(store->inotify_fd, config_dir.c_str(),
+                        IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_MOVED_FROM |
+                        IN_DELETE | IN_CREATE) < 0) {
+    close(store->inotify_fd);
+    store->inotify_fd = -1;
   }
 
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+  return store;
 }
 
-// Helper: Get bookmarked directory path by identifier
-static bool get_bookmarked_path(const char* identifier, std::string& out_path) {
-  json data = load_bookmarks();
+// Drop the cached result for `identifier` along with the list that contains it
+static void store_invalidate_value(BookmarkStore* store, const std::string& identifier) {
+  auto it = store->bookmark_values.find(identifier);
+  if (it != store->bookmark_values.end()) {
+    fl_value_unref(it->second);
+    store->bookmark_values.erase(it);
+  }
+  if (store->list_value != nullptr) {
+    fl_value_unref(store->list_value);
+    store->list_value = nullptr;
+  }
+}
 
-  if (!data["bookmarks"].contains(identifier)) {
-    return false;
+static void store_clear_values(BookmarkStore* store) {
+  for (auto& [identifier, value] : store->bookmark_values) {
+    fl_value_unref(value);
+  }
+  store->bookmark_values.clear();
+  if (store->list_value != nullptr) {
+    fl_value_unref(store->list_value);
+    store->list_value = nullptr;
   }
+}
 
-  json bookmark = data["bookmarks"][identifier];
-  out_path = bookmark["path"].get<std::string>();
+// Map the shared header of bookmarks.lock, creating the file if needed
+static bool shared_store_open(BookmarkStore* store) {
+  if (store->shared != nullptr) {
+    return true;
+  }
 
-  // Validate directory still exists
+  fs::create_directories(fs::path(store->lock_path).parent_path());
+  int fd = open(store->lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+
+  // Growing is idempotent, so racing processes all end up with the same zeroed header
   struct stat st;
-  if (stat(out_path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+  if (fstat(fd, &st) != 0 ||
+      (st.st_size < static_cast<off_t>(kSharedStoreHeaderSize) &&
+       ftruncate(fd, kSharedStoreHeaderSize) != 0)) {
+    close(fd);
     return false;
   }
 
+  void* mapping = mmap(nullptr, kSharedStoreHeaderSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+
+  store->lock_fd = fd;
+  store->shared = static_cast<SharedStoreHeader*>(mapping);
   return true;
 }
 
-// Method: saveFile
-static FlMethodResponse* save_file(FlValue* args) {
-  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
-  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
-  FlValue* data_value = fl_value_lookup_string(args, "data");
-
-  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+static void shared_store_close(BookmarkStore* store) {
+  if (store->shared != nullptr) {
+    munmap(store->shared, kSharedStoreHeaderSize);
+    store->shared = nullptr;
   }
-
-  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  if (store->lock_fd >= 0) {
+    close(store->lock_fd);
+    store->lock_fd = -1;
   }
+}
 
-  if (data_value == nullptr || fl_value_get_type(data_value) != FL_VALUE_TYPE_UINT8_LIST) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "data must be a Uint8List", nullptr));
+// Take (F_RDLCK, F_WRLCK) or drop (F_UNLCK) the whole-file OFD lock on bookmarks.lock.
+//
+// OFD locks belong to the open file description rather than the process, so
+// they also exclude other plugin instances in this process; threads of one
+// instance are already serialized by the store mutex.
+static bool shared_store_lock(BookmarkStore* store, short type) {
+  struct flock lock = {};
+  lock.l_type = type;
+  lock.l_whence = SEEK_SET;
+  while (fcntl(store->lock_fd, F_OFD_SETLKW, &lock) != 0) {
+    if (errno != EINTR) {
+      return false;
+    }
   }
+  return true;
+}
 
-  const char* identifier = fl_value_get_string(identifier_value);
-  const char* filename = fl_value_get_string(filename_value);
-
-  // Get bookmarked directory
-  std::string bookmark_path;
-  if (!get_bookmarked_path(identifier, bookmark_path)) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "BOOKMARK_NOT_FOUND",
-        ("Bookmark with identifier '" + std::string(identifier) + "' not found").c_str(),
-        nullptr));
+static void bookmark_store_free(BookmarkStore* store) {
+  if (store->inotify_fd >= 0) {
+    close(store->inotify_fd);
   }
+  shared_store_close(store);
+  store_clear_values(store);
+  delete store;
+}
 
-  // Check write permission
-  if (access(bookmark_path.c_str(), W_OK) != 0) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "PERMISSION_DENIED", "No write permission for bookmarked directory", nullptr));
+// Load the newest snapshot plus any journal records past it
+static void store_load(BookmarkStore* store) {
+  uint64_t start = monotonic_ns();
+
+  // Take the identities first so a write racing the parse triggers a reload
+  store->snapshot_identity = file_identity_read(store->config_path);
+  store->bin_identity = file_identity_read(store->bin_path);
+  store->snapshot.reset();
+  store->removed.clear();
+  store->path_index.valid = false;
+  store->query_index.valid = false;
+  store_clear_values(store);
+
+  // Both only exist if a migration was interrupted; the newer one wins
+  bool use_binary = store->bin_identity.present &&
+                    (!store->snapshot_identity.present ||
+                     store->bin_identity.mtime.tv_sec > store->snapshot_identity.mtime.tv_sec ||
+                     (store->bin_identity.mtime.tv_sec == store->snapshot_identity.mtime.tv_sec &&
+                      store->bin_identity.mtime.tv_nsec >= store->snapshot_identity.mtime.tv_nsec));
+  if (use_binary) {
+    store->snapshot = binary_snapshot_open(store->bin_path);
   }
 
-  // Build full file path
-  std::string file_path = bookmark_path + "/" + filename;
-
-  // Write file
-  try {
-    std::ofstream out(file_path, std::ios::binary);
-    if (!out.is_open()) {
-      return FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "PERMISSION_DENIED", "Cannot write file", nullptr));
+  if (store->snapshot) {
+    store->data = {{"version", store->snapshot->version}, {"bookmarks", json::object()}};
+    store->journal_seq = store->snapshot->journal_seq;
+    if (!store->format_configured) {
+      store->binary = true;
     }
+  } else {
+    // Legacy JSON, or a binary snapshot we cannot read
+    store->data = load_bookmarks(store->config_path);
+    store->journal_seq = store->data.value("journalSeq", uint64_t{0});
+  }
 
-    const uint8_t* data = fl_value_get_uint8_list(data_value);
-    size_t data_length = fl_value_get_length(data_value);
-    out.write(reinterpret_cast<const char*>(data), data_length);
-    out.close();
+  store->log_records = replay_journal(store);
+  store->log_identity = file_identity_read(store->log_path);
+  store->loaded = true;
+  store->snapshot_epoch++;
 
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
-  } catch (const std::exception& e) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "WRITE_ERROR", e.what(), nullptr));
-  }
+  uint64_t elapsed = monotonic_ns() - start;
+  latency_record(&store->load_latency, elapsed);
+  BOOKMARKS_PROBE2(store__load, elapsed, store->log_records);
 }
 
-// Method: readFile
-static FlMethodResponse* read_file(FlValue* args) {
-  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
-  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+static bool store_flush(DirectoryBookmarksPlugin* self);
 
-  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+// Make sure the resident store reflects the files on disk
+static void store_refresh(DirectoryBookmarksPlugin* self) {
+  BookmarkStore* store = self->store;
+
+  // Other processes announce their writes through the generation counter,
+  // so an unchanged counter is all it takes to trust the resident copy
+  if (store->multi_process) {
+    if (store->loaded &&
+        store->shared->generation.load(std::memory_order_acquire) == store->generation) {
+      return;
+    }
+
+    // A writer already holds the exclusive lock; asking for a read lock on
+    // the same description would downgrade it
+    bool locked = store->lock_depth == 0 && shared_store_lock(store, F_RDLCK);
+    store->generation = store->shared->generation.load(std::memory_order_acquire);
+    store_load(store);
+    if (locked) {
+      shared_store_lock(store, F_UNLCK);
+    }
+    return;
   }
 
-  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  bool check = !store->loaded;
+  if (!check) {
+    check = store->inotify_fd < 0 || store_drain_events(store);
   }
 
-  const char* identifier = fl_value_get_string(identifier_value);
-  const char* filename = fl_value_get_string(filename_value);
+  if (check && (!store->loaded || store_identity_changed(store))) {
+    // Don't let a reload throw away changes still waiting to be written
+    if (store->loaded && !store->pending_changes.empty()) {
+      store_flush(self);
+      if (store->loaded && !store_identity_changed(store)) {
+        return;
+      }
+    }
+    store_load(store);
+  }
+}
 
-  // Get bookmarked directory
-  std::string bookmark_path;
-  if (!get_bookmarked_path(identifier, bookmark_path)) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "BOOKMARK_NOT_FOUND",
-        ("Bookmark with identifier '" + std::string(identifier) + "' not found").c_str(),
-        nullptr));
+// Holds the cross-process write lock for the scope of a mutation.
+//
+// Taken after the store mutex, before the handler first looks at the store,
+// so the store_refresh that follows sees every write that came before it.
+// A no-op outside multi-process mode.
+struct StoreWriteGuard {
+  explicit StoreWriteGuard(DirectoryBookmarksPlugin* self)
+      : store(self->store), active(self->store->multi_process) {
+    if (!active) {
+      return;
+    }
+    if (store->lock_depth++ == 0 && !shared_store_lock(store, F_WRLCK)) {
+      g_warning("directory_bookmarks: could not lock %s: %s", store->lock_path.c_str(),
+                strerror(errno));
+    }
+  }
+
+  ~StoreWriteGuard() {
+    if (!active || --store->lock_depth > 0) {
+      return;
+    }
+    if (store->published) {
+      store->generation = store->shared->generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+      store->published = false;
+    }
+    shared_store_lock(store, F_UNLCK);
   }
 
-  // Build full file path
-  std::string file_path = bookmark_path + "/" + filename;
+  StoreWriteGuard(const StoreWriteGuard&) = delete;
+  StoreWriteGuard& operator=(const StoreWriteGuard&) = delete;
 
-  // Check if file exists
-  if (!fs::exists(file_path) || !fs::is_regular_file(file_path)) {
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_null()));
+  BookmarkStore* store;
+  bool active;
+};
+
+// Decode every record of a lazily loaded binary snapshot into `data`
+static void store_materialize(BookmarkStore* store) {
+  if (!store->snapshot) {
+    return;
   }
 
-  // Read file
-  try {
-    std::ifstream in(file_path, std::ios::binary | std::ios::ate);
-    if (!in.is_open()) {
-      return FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "PERMISSION_DENIED", "Cannot read file", nullptr));
+  json& bookmarks = store->data["bookmarks"];
+  for (uint32_t i = 0; i < store->snapshot->count; i++) {
+    std::string id;
+    json bookmark;
+    if (!binary_snapshot_decode(store->snapshot.get(), i, id, bookmark)) {
+      continue;
+    }
+    // Records already resident were decoded earlier or replaced by the journal
+    if (store->removed.count(id) == 0 && !bookmarks.contains(id)) {
+      bookmarks[id] = std::move(bookmark);
     }
+  }
 
-    std::streamsize size = in.tellg();
-    in.seekg(0, std::ios::beg);
+  store->snapshot.reset();
+  store->removed.clear();
+}
 
-    std::vector<uint8_t> buffer(size);
-    in.read(reinterpret_cast<char*>(buffer.data()), size);
-    in.close();
+// Get the whole resident store, (re)loading it from disk only if the files changed
+static json& store_get(DirectoryBookmarksPlugin* self) {
+  store_refresh(self);
+  store_materialize(self->store);
+  return self->store->data;
+}
 
-    g_autoptr(FlValue) result = fl_value_new_uint8_list(buffer.data(), buffer.size());
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } catch (const std::exception& e) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "READ_ERROR", e.what(), nullptr));
+// Look up a single bookmark without materializing the rest of the store.
+//
+// The returned pointer is only valid while the store mutex is held and no
+// mutation happens.
+static const json* store_find(DirectoryBookmarksPlugin* self, const std::string& identifier) {
+  store_refresh(self);
+  BookmarkStore* store = self->store;
+
+  json& bookmarks = store->data["bookmarks"];
+  auto it = bookmarks.find(identifier);
+  if (it != bookmarks.end()) {
+    return &*it;
   }
-}
 
-// Method: listFiles
-static FlMethodResponse* list_files(FlValue* args) {
-  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  if (!store->snapshot || store->removed.count(identifier) > 0) {
+    return nullptr;
+  }
 
-  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  int64_t index = binary_snapshot_find(store->snapshot.get(), identifier);
+  std::string id;
+  json bookmark;
+  if (index < 0 ||
+      !binary_snapshot_decode(store->snapshot.get(), static_cast<uint32_t>(index), id, bookmark)) {
+    return nullptr;
   }
 
-  const char* identifier = fl_value_get_string(identifier_value);
+  return &(bookmarks[id] = std::move(bookmark));
+}
 
-  // Get bookmarked directory
-  std::string bookmark_path;
-  if (!get_bookmarked_path(identifier, bookmark_path)) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "BOOKMARK_NOT_FOUND",
-        ("Bookmark with identifier '" + std::string(identifier) + "' not found").c_str(),
-        nullptr));
+// Split a path into its lexically normalized components ("/a/./b/" -> a, b)
+static std::vector<std::string> path_components(const std::string& path) {
+  std::vector<std::string> components;
+  for (const auto& part : fs::path(path).lexically_normal()) {
+    std::string component = part.string();
+    if (component.empty() || component == "/" || component == ".") {
+      continue;
+    }
+    components.push_back(std::move(component));
   }
+  return components;
+}
 
-  // List files
-  try {
-    g_autoptr(FlValue) result = fl_value_new_list();
-
-    for (const auto& entry : fs::directory_iterator(bookmark_path)) {
-      if (entry.is_regular_file()) {
-        std::string filename = entry.path().filename().string();
-        // Filter hidden files (starting with .)
-        if (!filename.empty() && filename[0] != '.') {
-          fl_value_append_take(result, fl_value_new_string_safe(filename));
-        }
-      }
+static void path_index_remove(PathIndex* index, const std::string& identifier) {
+  auto it = index->indexed.find(identifier);
+  if (it == index->indexed.end()) {
+    return;
+  }
+
+  // Walk down recording the nodes so empty ones can be pruned on the way up
+  std::vector<PathTrieNode*> nodes = {&index->root};
+  for (const std::string& component : it->second) {
+    auto child = nodes.back()->children.find(component);
+    if (child == nodes.back()->children.end()) {
+      break;
     }
+    nodes.push_back(child->second.get());
+  }
 
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } catch (const std::exception& e) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "READ_ERROR", e.what(), nullptr));
+  if (nodes.size() == it->second.size() + 1) {
+    nodes.back()->identifiers.erase(identifier);
+    for (size_t depth = it->second.size(); depth > 0; depth--) {
+      PathTrieNode* node = nodes[depth];
+      if (!node->identifiers.empty() || !node->children.empty()) {
+        break;
+      }
+      nodes[depth - 1]->children.erase(it->second[depth - 1]);
+    }
   }
+
+  index->indexed.erase(it);
 }
 
-// Method: deleteFile
-static FlMethodResponse* delete_file(FlValue* args) {
-  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
-  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+static void path_index_add(PathIndex* index, const std::string& identifier,
+                           const std::string& path) {
+  path_index_remove(index, identifier);
 
-  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  std::vector<std::string> components = path_components(path);
+  PathTrieNode* node = &index->root;
+  for (const std::string& component : components) {
+    std::unique_ptr<PathTrieNode>& child = node->children[component];
+    if (!child) {
+      child = std::make_unique<PathTrieNode>();
+    }
+    node = child.get();
   }
 
-  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  node->identifiers.insert(identifier);
+  index->indexed[identifier] = std::move(components);
+}
+
+// Bring the path index in line with the resident store, rebuilding if needed
+static PathIndex* store_path_index(DirectoryBookmarksPlugin* self) {
+  store_refresh(self);
+  BookmarkStore* store = self->store;
+  PathIndex* index = &store->path_index;
+  if (index->valid) {
+    return index;
   }
 
-  const char* identifier = fl_value_get_string(identifier_value);
-  const char* filename = fl_value_get_string(filename_value);
+  index->root.children.clear();
+  index->root.identifiers.clear();
+  index->indexed.clear();
 
-  // Get bookmarked directory
-  std::string bookmark_path;
-  if (!get_bookmarked_path(identifier, bookmark_path)) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "BOOKMARK_NOT_FOUND",
-        ("Bookmark with identifier '" + std::string(identifier) + "' not found").c_str(),
-        nullptr));
+  const json& bookmarks = store->data["bookmarks"];
+  for (const auto& [id, bookmark] : bookmarks.items()) {
+    path_index_add(index, id, bookmark.value("path", ""));
   }
 
-  // Check write permission
-  if (access(bookmark_path.c_str(), W_OK) != 0) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "PERMISSION_DENIED", "No write permission for bookmarked directory", nullptr));
+  // Records of a lazy binary snapshot only need their id and path decoded
+  if (store->snapshot) {
+    const BinarySnapshot* snapshot = store->snapshot.get();
+    for (uint32_t i = 0; i < snapshot->count; i++) {
+      size_t pos = get_u32(snapshot->offsets + 4 * static_cast<size_t>(i));
+      const char* id;
+      size_t id_length;
+      const char* path;
+      size_t path_length;
+      if (!get_str(snapshot, &pos, &id, &id_length) ||
+          !get_str(snapshot, &pos, &path, &path_length)) {
+        continue;
+      }
+
+      std::string identifier(id, id_length);
+      if (store->removed.count(identifier) == 0 && !bookmarks.contains(identifier)) {
+        path_index_add(index, identifier, std::string(path, path_length));
+      }
+    }
   }
 
-  // Build full file path
-  std::string file_path = bookmark_path + "/" + filename;
+  index->valid = true;
+  return index;
+}
 
-  // Check if file exists
-  if (!fs::exists(file_path) || !fs::is_regular_file(file_path)) {
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+// Identifier bookmarking exactly `path`, or the deepest one containing it
+static const std::string* path_index_lookup(const PathIndex* index, const std::string& path,
+                                            bool containing) {
+  const PathTrieNode* node = &index->root;
+  const std::string* best = node->identifiers.empty() ? nullptr : &*node->identifiers.begin();
+
+  for (const std::string& component : path_components(path)) {
+    auto child = node->children.find(component);
+    if (child == node->children.end()) {
+      return containing ? best : nullptr;
+    }
+    node = child->second.get();
+    if (!node->identifiers.empty()) {
+      best = &*node->identifiers.begin();
+    }
   }
 
-  // Delete file
-  try {
-    fs::remove(file_path);
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
-  } catch (const std::exception& e) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "DELETE_ERROR", e.what(), nullptr));
+  if (!containing) {
+    return node->identifiers.empty() ? nullptr : &*node->identifiers.begin();
   }
+  return best;
 }
 
-// Method: fileExists
-static FlMethodResponse* file_exists(FlValue* args) {
-  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
-  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+// Cap on metadata keys indexed at once; filters on further keys scan instead
+static constexpr size_t kMaxMetadataIndexes = 16;
 
-  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+static void metadata_index_remove(MetadataIndex* index, const std::string& identifier) {
+  auto it = index->indexed.find(identifier);
+  if (it == index->indexed.end()) {
+    return;
   }
 
-  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  auto bucket = index->by_value.find(it->second);
+  if (bucket != index->by_value.end()) {
+    bucket->second.erase(identifier);
+    if (bucket->second.empty()) {
+      index->by_value.erase(bucket);
+    }
   }
+  index->indexed.erase(it);
+}
 
-  const char* identifier = fl_value_get_string(identifier_value);
-  const char* filename = fl_value_get_string(filename_value);
+static void metadata_index_add(MetadataIndex* index, const std::string& key,
+                               const std::string& identifier, const json& bookmark) {
+  metadata_index_remove(index, identifier);
 
-  // Get bookmarked directory
-  std::string bookmark_path;
-  if (!get_bookmarked_path(identifier, bookmark_path)) {
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+  auto metadata = bookmark.find("metadata");
+  if (metadata == bookmark.end() || !metadata->is_object()) {
+    return;
+  }
+  auto value = metadata->find(key);
+  if (value == metadata->end()) {
+    return;
   }
 
-  // Build full file path
-  std::string file_path = bookmark_path + "/" + filename;
+  std::string serialized = value->dump();
+  index->by_value[serialized].insert(identifier);
+  index->indexed[identifier] = std::move(serialized);
+}
 
-  // Check if file exists
-  bool exists = fs::exists(file_path) && fs::is_regular_file(file_path);
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(exists)));
+static void query_index_remove(QueryIndex* index, const std::string& identifier) {
+  auto it = index->created.find(identifier);
+  if (it != index->created.end()) {
+    index->by_created.erase({it->second, identifier});
+    index->created.erase(it);
+  }
+
+  for (auto& [key, metadata_index] : index->metadata) {
+    metadata_index_remove(&metadata_index, identifier);
+  }
 }
 
-// Method: hasWritePermission
-static FlMethodResponse* has_write_permission(FlValue* args) {
-  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+static void query_index_add(QueryIndex* index, const std::string& identifier,
+                            const json& bookmark) {
+  query_index_remove(index, identifier);
 
-  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
-    return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  std::string created_at = bookmark.value("createdAt", "");
+  index->by_created.insert({created_at, identifier});
+  index->created[identifier] = std::move(created_at);
+
+  for (auto& [key, metadata_index] : index->metadata) {
+    metadata_index_add(&metadata_index, key, identifier, bookmark);
   }
+}
 
-  const char* identifier = fl_value_get_string(identifier_value);
+// Bring the query index in line with the resident store, rebuilding if needed.
+// Sorting needs every createdAt, so this materializes a lazy binary snapshot.
+static QueryIndex* store_query_index(DirectoryBookmarksPlugin* self) {
+  const json& bookmarks = store_get(self)["bookmarks"];
+  QueryIndex* index = &self->store->query_index;
+  if (index->valid) {
+    return index;
+  }
 
-  std::string bookmark_path;
-  if (!get_bookmarked_path(identifier, bookmark_path)) {
-    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+  index->by_created.clear();
+  index->created.clear();
+  index->metadata.clear();
+  for (const auto& [id, bookmark] : bookmarks.items()) {
+    query_index_add(index, id, bookmark);
   }
 
-  bool has_permission = (access(bookmark_path.c_str(), W_OK) == 0);
-  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(has_permission)));
+  index->valid = true;
+  return index;
 }
 
-// Method: requestWritePermission
-static FlMethodResponse* request_write_permission(FlValue* args) {
-  // On Linux desktop, we don't need runtime permission dialogs
-  // Just return the current write permission status
-  return has_write_permission(args);
+// Index of metadata `key`, built on first use, or null once the cap is reached.
+//
+// Unlike store_query_index this never refreshes the store, so references
+// into the data taken after store_query_index stay valid; call that first.
+static const MetadataIndex* store_metadata_index(DirectoryBookmarksPlugin* self,
+                                                 const std::string& key) {
+  QueryIndex* index = &self->store->query_index;
+  auto it = index->metadata.find(key);
+  if (it != index->metadata.end()) {
+    return &it->second;
+  }
+  if (index->metadata.size() >= kMaxMetadataIndexes) {
+    return nullptr;
+  }
+
+  MetadataIndex& metadata_index = index->metadata[key];
+  for (const auto& [id, bookmark] : self->store->data["bookmarks"].items()) {
+    metadata_index_add(&metadata_index, key, id, bookmark);
+  }
+  return &metadata_index;
 }
 
-// MethodChannel handler
-static void directory_bookmarks_plugin_handle_method_call(
-    DirectoryBookmarksPlugin* self,
-    FlMethodCall* method_call) {
-  g_autoptr(FlMethodResponse) response = nullptr;
 
-  const gchar* method = fl_method_call_get_name(method_call);
-  FlValue* args = fl_method_call_get_args(method_call);
+// Write the whole store as a snapshot, folding in and clearing the journal
+static bool store_write_snapshot(BookmarkStore* store) {
+  store_materialize(store);
+  if (store->journal_seq > 0) {
+    store->data["journalSeq"] = store->journal_seq;
+  }
+
+  // Write the configured format, then drop the other so exactly one remains
+  const std::string& path = store->binary ? store->bin_path : store->config_path;
+  const std::string& stale = store->binary ? store->config_path : store->bin_path;
+  uint64_t start = monotonic_ns();
+  bool durable = store->durability == kDurabilityDurable;
+  bool saved = store->binary ? save_bookmarks_binary(path, store->data, durable)
+                             : save_bookmarks(path, store->data, durable);
+  uint64_t elapsed = monotonic_ns() - start;
+  latency_record(&store->save_latency, elapsed);
+  BOOKMARKS_PROBE2(store__save, elapsed, saved);
+  if (!saved) {
+    // The in-memory copy no longer matches disk; reload on next access
+    store->loaded = false;
+    return false;
+  }
+  unlink(stale.c_str());
+  store->snapshot_identity = file_identity_read(store->config_path);
+  store->bin_identity = file_identity_read(store->bin_path);
+  store->snapshot_epoch++;
+
+  // Every record is now covered by the snapshot's journalSeq, so a crash
+  // before this truncation only leaves records that replay skips
+  if (store->log_identity.present) {
+    truncate(store->log_path.c_str(), 0);
+    store->log_identity = file_identity_read(store->log_path);
+  }
+  store->log_records = 0;
+
+  return true;
+}
+
+// Drop journal records already covered by a snapshot at `seq`, keeping any
+// appended since. A crash mid-way leaves either journal, and replay skips
+// covered records anyway.
+static void store_trim_journal(BookmarkStore* store, uint64_t seq) {
+  if (store->journal_seq <= seq) {
+    if (store->log_identity.present) {
+      truncate(store->log_path.c_str(), 0);
+    }
+    store->log_records = 0;
+    store->log_identity = file_identity_read(store->log_path);
+    return;
+  }
+
+  std::ifstream in(store->log_path, std::ios::binary);
+  std::string kept;
+  size_t records = 0;
+  std::string line;
+  while (std::getline(in, line) && !in.eof()) {
+    json record = json::parse(line, nullptr, false);
+    if (record.is_discarded() || !record.is_object()) {
+      break;
+    }
+    if (record.value("seq", uint64_t{0}) > seq) {
+      kept += line;
+      kept += '\n';
+      records++;
+    }
+  }
+  in.close();
+
+  std::string temp_path = store->log_path + ".tmp";
+  int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return;
+  }
+  bool ok = write_full(fd, reinterpret_cast<const uint8_t*>(kept.data()), kept.size());
+  if (close(fd) != 0) {
+    ok = false;
+  }
+  if (!ok || rename(temp_path.c_str(), store->log_path.c_str()) != 0) {
+    unlink(temp_path.c_str());
+    return;
+  }
+  store->log_records = records;
+  store->log_identity = file_identity_read(store->log_path);
+}
+
+// Fold the journal into a fresh snapshot.
+//
+// The store lock is held only to copy the data and, at the end, to rename
+// the finished file into place and trim the journal; encoding and writing
+// the snapshot happen unlocked. If anything else wrote a snapshot or
+// reloaded the store meanwhile, the copy is stale and is thrown away; the
+// next append past the limits tries again.
+static void store_compact(DirectoryBookmarksPlugin* self) {
+  BookmarkStore* store = self->store;
+  json data;
+  uint64_t seq;
+  uint64_t epoch;
+  bool binary;
+  bool durable;
+  {
+    std::lock_guard<std::recursive_mutex> lock(store->mutex);
+    StoreWriteGuard guard(self);
+    data = store_get(self);
+    seq = store->journal_seq;
+    epoch = store->snapshot_epoch;
+    binary = store->binary;
+    durable = store->durability == kDurabilityDurable;
+  }
+
+  if (seq > 0) {
+    data["journalSeq"] = seq;
+  }
+  const std::string& path = binary ? store->bin_path : store->config_path;
+  const std::string& stale = binary ? store->config_path : store->bin_path;
+  std::string temp_path = path + ".compact.tmp";
+
+  uint64_t start = monotonic_ns();
+  bool written = snapshot_write_temp(temp_path, data, binary, durable);
+
+  std::lock_guard<std::recursive_mutex> lock(store->mutex);
+  StoreWriteGuard guard(self);
+  store_refresh(self);
+  store->compacting = false;
+
+  bool current = store->snapshot_epoch == epoch && store->binary == binary && store->journal;
+  bool saved = written && current && rename(temp_path.c_str(), path.c_str()) == 0;
+  uint64_t elapsed = monotonic_ns() - start;
+  latency_record(&store->save_latency, elapsed);
+  BOOKMARKS_PROBE2(store__save, elapsed, saved);
+  if (!saved) {
+    unlink(temp_path.c_str());
+    return;
+  }
+
+  if (durable) {
+    directory_sync(AT_FDCWD, fs::path(path).parent_path().c_str());
+  }
+  unlink(stale.c_str());
+  store->snapshot_identity = file_identity_read(store->config_path);
+  store->bin_identity = file_identity_read(store->bin_path);
+  store->snapshot_epoch++;
+  store_trim_journal(store, seq);
+  store->published = store->multi_process;
+}
+
+static bool dispatcher_submit(DirectoryBookmarksPlugin* self, std::string lane,
+                              std::function<void()> run);
+
+// Append records for the changed bookmarks to the journal
+static bool store_append_journal(DirectoryBookmarksPlugin* self,
+                                 const std::set<std::string>& changed) {
+  BookmarkStore* store = self->store;
+  const json& bookmarks = store->data["bookmarks"];
+
+  std::string lines;
+  for (const std::string& identifier : changed) {
+    json record = {{"seq", ++store->journal_seq}, {"id", identifier}};
+    auto it = bookmarks.find(identifier);
+    if (it != bookmarks.end()) {
+      record["op"] = "put";
+      record["bookmark"] = *it;
+    } else {
+      record["op"] = "delete";
+    }
+    lines += record.dump();
+    lines += '\n';
+  }
+
+  uint64_t start = monotonic_ns();
+  int fd = open(store->log_path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    store->loaded = false;
+    return false;
+  }
+
+  bool ok = write_full(fd, reinterpret_cast<const uint8_t*>(lines.data()), lines.size());
+  if (ok && store->durability == kDurabilityDurable) {
+    ok = fdatasync(fd) == 0;
+    // A journal that was just created also needs its directory entry
+    if (ok && !store->log_identity.present) {
+      directory_sync(AT_FDCWD, fs::path(store->log_path).parent_path().c_str());
+    }
+  }
+  if (close(fd) != 0) {
+    ok = false;
+  }
+  uint64_t elapsed = monotonic_ns() - start;
+  latency_record(&store->journal_latency, elapsed);
+  BOOKMARKS_PROBE2(store__journal, elapsed, changed.size());
+  if (!ok) {
+    store->loaded = false;
+    return false;
+  }
+
+  store->log_identity = file_identity_read(store->log_path);
+  store->log_records += changed.size();
+
+  // Fold the journal into the snapshot off the calling thread once it grows
+  if (!store->compacting &&
+      (store->log_records >= store->journal_max_records ||
+       store->log_identity.size >= store->journal_max_bytes)) {
+    // Runs on the worker pool, which dispose drains before the store goes
+    // away; once the pool is gone (the final flush) it runs inline
+    store->compacting = true;
+    if (self->dispatcher == nullptr ||
+        !dispatcher_submit(self, "store:compact", [self]() { store_compact(self); })) {
+      store_compact(self);
+    }
+  }
+
+  return true;
+}
+
+// Persist a set of changed bookmarks in the configured storage mode
+static bool store_persist(DirectoryBookmarksPlugin* self, const std::set<std::string>& changed) {
+  BookmarkStore* store = self->store;
+
+  bool saved = store->journal ? store_append_journal(self, changed)
+                              : store_write_snapshot(store);
+  store->published = store->published || (saved && store->multi_process);
+  return saved;
+}
+
+// Write out every queued change now
+static bool store_flush(DirectoryBookmarksPlugin* self) {
+  BookmarkStore* store = self->store;
+
+  if (store->flush_source != 0) {
+    g_source_remove(store->flush_source);
+    store->flush_source = 0;
+  }
+
+  if (store->pending_changes.empty()) {
+    return true;
+  }
+
+  std::set<std::string> changed;
+  changed.swap(store->pending_changes);
+  return store_persist(self, changed);
+}
+
+static gboolean store_flush_cb(gpointer user_data) {
+  auto* self = static_cast<DirectoryBookmarksPlugin*>(user_data);
+  std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+
+  // A flush on another thread may have removed us while we waited for the lock
+  if (g_source_is_destroyed(g_main_current_source())) {
+    return G_SOURCE_REMOVE;
+  }
+
+  self->store->flush_source = 0;
+  if (!store_flush(self)) {
+    g_warning("directory_bookmarks: deferred bookmark write failed");
+  }
+  return G_SOURCE_REMOVE;
+}
+
+// Persist changed bookmarks now, or queue them for the next group commit.
+//
+// `sync` forces this commit (and anything queued before it) to disk before
+// returning, regardless of the write-behind setting.
+static bool store_commit_changes(DirectoryBookmarksPlugin* self,
+                                 const std::set<std::string>& changed, bool sync) {
+  BookmarkStore* store = self->store;
+  store->pending_changes.insert(changed.begin(), changed.end());
+
+  // Another process could change the files while a change is queued here,
+  // so multi-process mode writes through
+  if (store->write_behind_ms == 0 || sync || store->multi_process) {
+    return store_flush(self);
+  }
+
+  // The window opens with the first queued change and is not extended by
+  // later ones, so a steady stream of updates still reaches disk
+  if (store->flush_source == 0) {
+    store->flush_source = g_timeout_add(store->write_behind_ms, store_flush_cb, self);
+  }
+  return true;
+}
+
+// Persist the resident store after `identifier` was created, changed or removed
+static bool store_commit(DirectoryBookmarksPlugin* self, const std::string& identifier,
+                         bool sync) {
+  BookmarkStore* store = self->store;
+  store_invalidate_value(store, identifier);
+
+  if (store->path_index.valid) {
+    const json& bookmarks = store->data["bookmarks"];
+    auto it = bookmarks.find(identifier);
+    if (it != bookmarks.end()) {
+      path_index_add(&store->path_index, identifier, it->value("path", ""));
+    } else {
+      path_index_remove(&store->path_index, identifier);
+    }
+  }
+
+  if (store->query_index.valid) {
+    const json& bookmarks = store->data["bookmarks"];
+    auto it = bookmarks.find(identifier);
+    if (it != bookmarks.end()) {
+      query_index_add(&store->query_index, identifier, *it);
+    } else {
+      query_index_remove(&store->query_index, identifier);
+    }
+  }
+
+  if (store->data["bookmarks"].find(identifier) == store->data["bookmarks"].end()) {
+    // Don't keep the directory of a deleted bookmark open
+    std::lock_guard<std::mutex> lock(self->dirs->mutex);
+    self->dirs->open.erase(identifier);
+  }
+
+  if (store->batch_depth > 0) {
+    store->batch_changes.insert(identifier);
+    return true;
+  }
+
+  return store_commit_changes(self, {identifier}, sync);
+}
+
+// Whether a mutating call asked for its change to be on disk before returning
+static bool commit_sync_requested(FlValue* args) {
+  FlValue* sync_value = fl_value_lookup_string(args, "sync");
+  return sync_value != nullptr && fl_value_get_type(sync_value) == FL_VALUE_TYPE_BOOL &&
+         fl_value_get_bool(sync_value);
+}
+
+// Method: flush
+static FlMethodResponse* flush(DirectoryBookmarksPlugin* self) {
+  std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+  StoreWriteGuard guard(self);
+
+  if (!store_flush(self)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "WRITE_ERROR", "Failed to write pending bookmark changes", nullptr));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Method: getStats
+//
+// Per-method call counts and latencies since the last reset, the time spent
+// loading and writing the store files, and file payload bytes moved.
+static FlMethodResponse* get_stats(DirectoryBookmarksPlugin* self) {
+  CallStats* stats = self->stats;
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "sinceMicros", fl_value_new_int(stats->since_us));
+  fl_value_set_string_take(result, "bytesRead", fl_value_new_int(stats->bytes_read));
+  fl_value_set_string_take(result, "bytesWritten", fl_value_new_int(stats->bytes_written));
+
+  FlValue* methods = fl_value_new_map();
+  {
+    std::lock_guard<std::mutex> lock(stats->mutex);
+    for (const auto& [name, method] : stats->methods) {
+      FlValue* value = latency_to_value(method.latency);
+      fl_value_set_string_take(value, "errors", fl_value_new_int(method.errors));
+      fl_value_set_take(methods, fl_value_new_string_safe(name), value);
+    }
+  }
+  fl_value_set_string_take(result, "methods", methods);
+
+  FlValue* store = fl_value_new_map();
+  {
+    std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+    fl_value_set_string_take(store, "load", latency_to_value(self->store->load_latency));
+    fl_value_set_string_take(store, "save", latency_to_value(self->store->save_latency));
+    fl_value_set_string_take(store, "journal", latency_to_value(self->store->journal_latency));
+  }
+  fl_value_set_string_take(result, "store", store);
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Method: resetStats
+static FlMethodResponse* reset_stats(DirectoryBookmarksPlugin* self) {
+  CallStats* stats = self->stats;
+  {
+    std::lock_guard<std::mutex> lock(stats->mutex);
+    stats->methods.clear();
+  }
+  stats->bytes_read = 0;
+  stats->bytes_written = 0;
+  stats->since_us = g_get_real_time();
+
+  {
+    std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+    self->store->load_latency = LatencyHistogram();
+    self->store->save_latency = LatencyHistogram();
+    self->store->journal_latency = LatencyHistogram();
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Method: createBookmark
+static FlMethodResponse* create_bookmark(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* path_value = fl_value_lookup_string(args, "path");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (path_value == nullptr || fl_value_get_type(path_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "path must be a string", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  const char* path = fl_value_get_string(path_value);
+
+  // Validate directory exists and is accessible
+  struct stat st;
+  if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "DIRECTORY_NOT_FOUND", "Directory not found or is not accessible", nullptr));
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+  StoreWriteGuard guard(self);
+  json& data = store_get(self);
+
+  // Check if bookmark already exists
+  if (data["bookmarks"].contains(identifier)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "BOOKMARK_ALREADY_EXISTS",
+        ("Bookmark with identifier '" + std::string(identifier) + "' already exists").c_str(),
+        nullptr));
+  }
+
+  // Create bookmark entry
+  json bookmark = {
+    {"id", identifier},
+    {"path", path},
+    {"createdAt", get_iso8601_timestamp()},
+    {"metadata", json::object()}
+  };
+
+  // Handle custom metadata if provided
+  FlValue* metadata_value = fl_value_lookup_string(args, "metadata");
+  if (metadata_value != nullptr && fl_value_get_type(metadata_value) == FL_VALUE_TYPE_MAP) {
+    bookmark["metadata"] = fl_value_to_json(metadata_value);
+  }
+
+  // Add to bookmarks
+  data["bookmarks"][identifier] = std::move(bookmark);
+
+  // Save to storage
+  if (!store_commit(self, identifier, commit_sync_requested(args))) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "WRITE_ERROR", "Failed to save bookmark", nullptr));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(
+      fl_value_new_string(identifier)));
+}
+
+// String field of a stored object, copied straight out of the json (empty if unset)
+static FlValue* json_field_to_fl_string(const json& object, const char* key) {
+  auto it = object.find(key);
+  if (it == object.end() || !it->is_string()) {
+    return fl_value_new_string("");
+  }
+  const std::string& text = it->get_ref<const std::string&>();
+  return fl_value_new_string_sized(text.data(), text.size());
+}
+
+// Fields of the map returned to Dart, as selected by a listBookmarks projection
+enum BookmarkField : unsigned {
+  kFieldIdentifier = 1 << 0,
+  kFieldPath = 1 << 1,
+  kFieldCreatedAt = 1 << 2,
+  kFieldMetadata = 1 << 3,
+  kAllBookmarkFields = kFieldIdentifier | kFieldPath | kFieldCreatedAt | kFieldMetadata,
+};
+
+static bool bookmark_field_parse(const char* name, unsigned* field) {
+  if (strcmp(name, "identifier") == 0) {
+    *field = kFieldIdentifier;
+  } else if (strcmp(name, "path") == 0) {
+    *field = kFieldPath;
+  } else if (strcmp(name, "createdAt") == 0) {
+    *field = kFieldCreatedAt;
+  } else if (strcmp(name, "metadata") == 0) {
+    *field = kFieldMetadata;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Convert a stored bookmark into the map returned to Dart
+static FlValue* bookmark_to_fl_value(const json& bookmark, unsigned fields = kAllBookmarkFields) {
+  FlValue* result = fl_value_new_map();
+  if (fields & kFieldIdentifier) {
+    fl_value_set_string_take(result, "identifier", json_field_to_fl_string(bookmark, "id"));
+  }
+  if (fields & kFieldPath) {
+    fl_value_set_string_take(result, "path", json_field_to_fl_string(bookmark, "path"));
+  }
+  if (fields & kFieldCreatedAt) {
+    fl_value_set_string_take(result, "createdAt", json_field_to_fl_string(bookmark, "createdAt"));
+  }
+
+  if (fields & kFieldMetadata) {
+    auto metadata = bookmark.find("metadata");
+    if (metadata != bookmark.end() && metadata->is_object()) {
+      fl_value_set_string_take(result, "metadata",
+                               json_to_fl_value(*metadata));
+    } else {
+      fl_value_set_string_take(result, "metadata", fl_value_new_map());
+    }
+  }
+
+  return result;
+}
+
+// Whether results may be served from the store's FlValue cache.
+//
+// FlValue reference counts are not atomic, so a value shared between calls
+// must only ever be referenced from one thread. Cached values are handed out
+// while calls run on the main context; in async dispatch mode every call
+// builds its own result instead.
+static bool store_values_cacheable(DirectoryBookmarksPlugin* self) {
+  return !self->dispatcher->async;
+}
+
+// Map for a stored bookmark, from the cache when possible. Returns a new reference.
+static FlValue* store_bookmark_value(DirectoryBookmarksPlugin* self, const std::string& identifier,
+                                     const json& bookmark) {
+  if (!store_values_cacheable(self)) {
+    return bookmark_to_fl_value(bookmark);
+  }
+
+  FlValue*& cached = self->store->bookmark_values[identifier];
+  if (cached == nullptr) {
+    cached = bookmark_to_fl_value(bookmark);
+  }
+  return fl_value_ref(cached);
+}
+
+// Whether `value` is or contains a number. Metadata indexes are keyed by
+// serialized value, which tells 1 from 1.0 although they compare equal, so
+// filters on numbers are answered by bookmark_matches alone.
+static bool json_contains_number(const json& value) {
+  if (value.is_number()) {
+    return true;
+  }
+  if (value.is_structured()) {
+    for (const json& element : value) {
+      if (json_contains_number(element)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Whether every `where` entry equals the bookmark's metadata value
+static bool bookmark_matches(const json& bookmark, const json& where) {
+  auto metadata = bookmark.find("metadata");
+  if (metadata == bookmark.end() || !metadata->is_object()) {
+    return where.empty();
+  }
+
+  for (const auto& [key, value] : where.items()) {
+    auto it = metadata->find(key);
+    if (it == metadata->end() || *it != value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// listBookmarks with query arguments: filter, order, then cut out one page
+static FlMethodResponse* query_bookmarks(DirectoryBookmarksPlugin* self, const json& where,
+                                         bool by_created, bool descending, int64_t offset,
+                                         int64_t limit, unsigned fields) {
+  // This is the only point that may reload the store; everything below
+  // holds references into the data and the indexes
+  QueryIndex* index = store_query_index(self);
+  const json& bookmarks = self->store->data["bookmarks"];
+  g_autoptr(FlValue) result = fl_value_new_list();
+
+  // Called for each match in order; false once the page is full
+  int64_t skipped = 0;
+  auto emit = [&](const std::string& identifier, const json& bookmark) {
+    if (skipped < offset) {
+      skipped++;
+      return true;
+    }
+    if (limit >= 0 && static_cast<int64_t>(fl_value_get_length(result)) >= limit) {
+      return false;
+    }
+    fl_value_append_take(result, fields == kAllBookmarkFields
+                                     ? store_bookmark_value(self, identifier, bookmark)
+                                     : bookmark_to_fl_value(bookmark, fields));
+    return true;
+  };
+
+  if (where.empty()) {
+    // Both orders are already kept sorted, so a page only touches its own entries
+    if (by_created) {
+      auto visit = [&](const std::pair<std::string, std::string>& entry) {
+        return emit(entry.second, bookmarks.at(entry.second));
+      };
+      if (descending) {
+        std::find_if_not(index->by_created.rbegin(), index->by_created.rend(), visit);
+      } else {
+        std::find_if_not(index->by_created.begin(), index->by_created.end(), visit);
+      }
+    } else {
+      const json::object_t& objects = bookmarks.get_ref<const json::object_t&>();
+      auto visit = [&](const json::object_t::value_type& entry) {
+        return emit(entry.first, entry.second);
+      };
+      if (descending) {
+        std::find_if_not(objects.rbegin(), objects.rend(), visit);
+      } else {
+        std::find_if_not(objects.begin(), objects.end(), visit);
+      }
+    }
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
+
+  // Start from the smallest indexed match set; unindexed keys fall back to a scan
+  const std::set<std::string>* candidates = nullptr;
+  bool scan = false;
+  for (const auto& [key, value] : where.items()) {
+    const MetadataIndex* metadata_index =
+        json_contains_number(value) ? nullptr : store_metadata_index(self, key);
+    if (metadata_index == nullptr) {
+      scan = true;
+      continue;
+    }
+    auto bucket = metadata_index->by_value.find(value.dump());
+    if (bucket == metadata_index->by_value.end()) {
+      return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+    if (candidates == nullptr || bucket->second.size() < candidates->size()) {
+      candidates = &bucket->second;
+    }
+  }
+
+  std::vector<const std::string*> matches;
+  if (candidates != nullptr) {
+    for (const std::string& identifier : *candidates) {
+      if (bookmark_matches(bookmarks.at(identifier), where)) {
+        matches.push_back(&identifier);
+      }
+    }
+  } else if (scan) {
+    for (const auto& [id, bookmark] : bookmarks.get_ref<const json::object_t&>()) {
+      if (bookmark_matches(bookmark, where)) {
+        matches.push_back(&id);
+      }
+    }
+  }
+
+  // Matches come out in identifier order
+  if (by_created) {
+    std::sort(matches.begin(), matches.end(), [index](const std::string* a, const std::string* b) {
+      const std::string& created_a = index->created.at(*a);
+      const std::string& created_b = index->created.at(*b);
+      return created_a != created_b ? created_a < created_b : *a < *b;
+    });
+  }
+  if (descending) {
+    std::reverse(matches.begin(), matches.end());
+  }
+
+  for (const std::string* identifier : matches) {
+    if (!emit(*identifier, bookmarks.at(*identifier))) {
+      break;
+    }
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Method: listBookmarks
+//
+// Without arguments, returns every bookmark in identifier order. Optional
+// `where` (metadata key -> value, all must be equal), `sortBy`
+// ("identifier" or "createdAt"), `descending`, `offset`, `limit` and
+// `fields` (any of identifier, path, createdAt, metadata) narrow the
+// result down to the page being displayed.
+static FlMethodResponse* list_bookmarks(DirectoryBookmarksPlugin* self, FlValue* args) {
+  bool query = false;
+  FlValue* where_value = nullptr;
+  FlValue* sort_value = nullptr;
+  FlValue* descending_value = nullptr;
+  FlValue* offset_value = nullptr;
+  FlValue* limit_value = nullptr;
+  FlValue* fields_value = nullptr;
+  if (args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    where_value = fl_value_lookup_string(args, "where");
+    sort_value = fl_value_lookup_string(args, "sortBy");
+    descending_value = fl_value_lookup_string(args, "descending");
+    offset_value = fl_value_lookup_string(args, "offset");
+    limit_value = fl_value_lookup_string(args, "limit");
+    fields_value = fl_value_lookup_string(args, "fields");
+  }
+
+  json where = json::object();
+  if (where_value != nullptr && fl_value_get_type(where_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(where_value) != FL_VALUE_TYPE_MAP) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "where must be a map", nullptr));
+    }
+    where = fl_value_to_json(where_value);
+    query = true;
+  }
+
+  bool by_created = false;
+  if (sort_value != nullptr && fl_value_get_type(sort_value) != FL_VALUE_TYPE_NULL) {
+    const char* sort_by = fl_value_get_type(sort_value) == FL_VALUE_TYPE_STRING
+        ? fl_value_get_string(sort_value) : "";
+    if (strcmp(sort_by, "createdAt") == 0) {
+      by_created = true;
+    } else if (strcmp(sort_by, "identifier") != 0) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "sortBy must be 'identifier' or 'createdAt'", nullptr));
+    }
+    query = true;
+  }
+
+  bool descending = false;
+  if (descending_value != nullptr && fl_value_get_type(descending_value) == FL_VALUE_TYPE_BOOL) {
+    descending = fl_value_get_bool(descending_value);
+    query = query || descending;
+  }
+
+  int64_t offset = 0;
+  if (offset_value != nullptr && fl_value_get_type(offset_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(offset_value) != FL_VALUE_TYPE_INT || fl_value_get_int(offset_value) < 0) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "offset must be a non-negative integer", nullptr));
+    }
+    offset = fl_value_get_int(offset_value);
+    query = true;
+  }
+
+  int64_t limit = -1;
+  if (limit_value != nullptr && fl_value_get_type(limit_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(limit_value) != FL_VALUE_TYPE_INT || fl_value_get_int(limit_value) < 0) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "limit must be a non-negative integer", nullptr));
+    }
+    limit = fl_value_get_int(limit_value);
+    query = true;
+  }
+
+  unsigned fields = kAllBookmarkFields;
+  if (fields_value != nullptr && fl_value_get_type(fields_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(fields_value) != FL_VALUE_TYPE_LIST) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "fields must be a list", nullptr));
+    }
+    fields = 0;
+    for (size_t i = 0; i < fl_value_get_length(fields_value); i++) {
+      FlValue* field_value = fl_value_get_list_value(fields_value, i);
+      unsigned field;
+      if (fl_value_get_type(field_value) != FL_VALUE_TYPE_STRING ||
+          !bookmark_field_parse(fl_value_get_string(field_value), &field)) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "INVALID_ARGUMENT",
+            "fields may only contain 'identifier', 'path', 'createdAt' and 'metadata'", nullptr));
+      }
+      fields |= field;
+    }
+    query = true;
+  }
+
+  BookmarkStore* store = self->store;
+  std::lock_guard<std::recursive_mutex> lock(store->mutex);
+  if (query) {
+    return query_bookmarks(self, where, by_created, descending, offset, limit, fields);
+  }
+
+  const json& bookmarks = store_get(self)["bookmarks"];
+
+  bool cacheable = store_values_cacheable(self);
+  if (cacheable && store->list_value != nullptr) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(store->list_value));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_list();
+  for (const auto& [id, bookmark] : bookmarks.items()) {
+    fl_value_append_take(result, store_bookmark_value(self, id, bookmark));
+  }
+
+  if (cacheable) {
+    store->list_value = fl_value_ref(result);
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Method: getBookmark
+static FlMethodResponse* get_bookmark(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+
+  // Check if bookmark exists
+  const json* found = store_find(self, identifier);
+  if (found == nullptr) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_null()));
+  }
+
+  g_autoptr(FlValue) result = store_bookmark_value(self, identifier, *found);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Shared by findBookmarkByPath and findContainingBookmark
+static FlMethodResponse* find_bookmark_for_path(DirectoryBookmarksPlugin* self, FlValue* args,
+                                                bool containing) {
+  FlValue* path_value = fl_value_lookup_string(args, "path");
+
+  if (path_value == nullptr || fl_value_get_type(path_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "path must be a string", nullptr));
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+  const PathIndex* index = store_path_index(self);
+
+  const std::string* match = path_index_lookup(index, fl_value_get_string(path_value), containing);
+  std::string identifier = match != nullptr ? *match : std::string();
+  const json* bookmark = match != nullptr ? store_find(self, identifier) : nullptr;
+  if (bookmark == nullptr) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_null()));
+  }
+
+  g_autoptr(FlValue) result = store_bookmark_value(self, identifier, *bookmark);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Method: findBookmarkByPath
+static FlMethodResponse* find_bookmark_by_path(DirectoryBookmarksPlugin* self, FlValue* args) {
+  return find_bookmark_for_path(self, args, false);
+}
+
+// Method: findContainingBookmark
+static FlMethodResponse* find_containing_bookmark(DirectoryBookmarksPlugin* self, FlValue* args) {
+  return find_bookmark_for_path(self, args, true);
+}
+
+// Method: bookmarkExists
+static FlMethodResponse* bookmark_exists(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+
+  bool exists = store_find(self, identifier) != nullptr;
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(exists)));
+}
+
+// Method: deleteBookmark
+static FlMethodResponse* delete_bookmark(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+  StoreWriteGuard guard(self);
+  json& data = store_get(self);
+
+  // Check if bookmark exists
+  if (!data["bookmarks"].contains(identifier)) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+  }
+
+  // Remove bookmark
+  data["bookmarks"].erase(identifier);
+
+  // Save to storage
+  if (!store_commit(self, identifier, commit_sync_requested(args))) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Method: updateBookmarkMetadata
+static FlMethodResponse* update_bookmark_metadata(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* metadata_value = fl_value_lookup_string(args, "metadata");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (metadata_value == nullptr || fl_value_get_type(metadata_value) != FL_VALUE_TYPE_MAP) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "metadata must be a map", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+  StoreWriteGuard guard(self);
+  json& data = store_get(self);
+
+  // Check if bookmark exists
+  if (!data["bookmarks"].contains(identifier)) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+  }
+
+  // Update metadata
+  data["bookmarks"][identifier]["metadata"] = fl_value_to_json(metadata_value);
+
+  // Save to storage
+  if (!store_commit(self, identifier, commit_sync_requested(args))) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Apply one patchBookmarkMetadata operation to `metadata`, or explain why not
+static bool metadata_patch_apply(json& metadata, FlValue* operation, std::string* error) {
+  FlValue* op_value = fl_value_get_type(operation) == FL_VALUE_TYPE_MAP
+      ? fl_value_lookup_string(operation, "op") : nullptr;
+  FlValue* key_value = op_value != nullptr ? fl_value_lookup_string(operation, "key") : nullptr;
+  if (op_value == nullptr || fl_value_get_type(op_value) != FL_VALUE_TYPE_STRING ||
+      key_value == nullptr || fl_value_get_type(key_value) != FL_VALUE_TYPE_STRING) {
+    *error = "each operation needs a string op and key";
+    return false;
+  }
+
+  const char* op = fl_value_get_string(op_value);
+  const char* key = fl_value_get_string(key_value);
+  FlValue* value = fl_value_lookup_string(operation, "value");
+
+  if (strcmp(op, "set") == 0) {
+    metadata[key] = fl_value_to_json_value(value);
+    return true;
+  }
+
+  if (strcmp(op, "remove") == 0) {
+    metadata.erase(key);
+    return true;
+  }
+
+  if (strcmp(op, "increment") == 0) {
+    json delta = value != nullptr ? fl_value_to_json_value(value) : json(1);
+    if (!delta.is_number()) {
+      *error = std::string("increment of '") + key + "' needs a numeric value";
+      return false;
+    }
+
+    auto it = metadata.find(key);
+    if (it == metadata.end() || it->is_null()) {
+      metadata[key] = std::move(delta);
+    } else if (!it->is_number()) {
+      *error = std::string("'") + key + "' is not a number";
+      return false;
+    } else if (it->is_number_float() || delta.is_number_float()) {
+      *it = it->get<double>() + delta.get<double>();
+    } else {
+      // Integers stay exact 64-bit values, so a sum that doesn't fit is refused
+      int64_t sum;
+      bool fits = !(it->is_number_unsigned() &&
+                    it->get<uint64_t>() > static_cast<uint64_t>(INT64_MAX)) &&
+                  !(delta.is_number_unsigned() &&
+                    delta.get<uint64_t>() > static_cast<uint64_t>(INT64_MAX));
+      if (!fits || __builtin_add_overflow(it->get<int64_t>(), delta.get<int64_t>(), &sum)) {
+        *error = std::string("increment of '") + key + "' overflows";
+        return false;
+      }
+      *it = sum;
+    }
+    return true;
+  }
+
+  *error = std::string("unknown op '") + op + "', expected set, remove or increment";
+  return false;
+}
+
+// Method: patchBookmarkMetadata
+//
+// Changes individual metadata keys instead of replacing the whole object.
+// `operations` is a list of {op, key, value} with op one of set, remove or
+// increment (by `value`, default 1). The operations apply in order and all
+// or nothing: if any is invalid the metadata is left untouched.
+static FlMethodResponse* patch_bookmark_metadata(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* operations_value = fl_value_lookup_string(args, "operations");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (operations_value == nullptr || fl_value_get_type(operations_value) != FL_VALUE_TYPE_LIST) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "operations must be a list", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+  StoreWriteGuard guard(self);
+  json& data = store_get(self);
+
+  auto bookmark = data["bookmarks"].find(identifier);
+  if (bookmark == data["bookmarks"].end()) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+  }
+
+  json metadata = bookmark->value("metadata", json::object());
+  if (!metadata.is_object()) {
+    metadata = json::object();
+  }
+
+  for (size_t i = 0; i < fl_value_get_length(operations_value); i++) {
+    std::string error;
+    if (!metadata_patch_apply(metadata, fl_value_get_list_value(operations_value, i), &error)) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", error.c_str(), nullptr));
+    }
+  }
+
+  (*bookmark)["metadata"] = std::move(metadata);
+
+  if (!store_commit(self, identifier, commit_sync_requested(args))) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Result of one directory probe, filled in by its thread
+struct DirProbe {
+  std::string path;
+  std::mutex mutex;
+  std::condition_variable done_cv;
+  bool done = false;
+  bool exists = false;
+  bool writable = false;
+  uint64_t device = 0;
+};
+
+// What validateBookmarks last found for one bookmark
+struct DirValidation {
+  std::string path;
+  bool exists = false;
+  bool writable = false;
+  bool timed_out = false;
+  uint64_t device = 0;
+  uint64_t checked_ns = 0;
+};
+
+static constexpr guint kDefaultValidationTtlMs = 30000;
+static constexpr int64_t kDefaultValidationTimeoutMs = 2000;
+
+// Validation results by identifier, reused by file operations for `ttl_ms`.
+//
+// A dead network mount can block statx uninterruptibly for minutes, so each
+// directory is probed on its own detached thread and the sweep stops
+// waiting at its timeout. A probe still running stays in `probing` (by
+// path) and is waited on again by the next sweep instead of piling up
+// another blocked thread.
+struct Validations {
+  std::mutex mutex;
+  std::unordered_map<std::string, DirValidation> results;
+  std::unordered_map<std::string, std::shared_ptr<DirProbe>> probing;
+  guint ttl_ms = kDefaultValidationTtlMs;
+};
+
+// Cached validation of `identifier` at `path`, if one is recent enough
+static bool validation_lookup(DirectoryBookmarksPlugin* self, const std::string& identifier,
+                              const std::string& path, DirValidation* out) {
+  Validations* validations = self->validations;
+  std::lock_guard<std::mutex> lock(validations->mutex);
+
+  auto it = validations->results.find(identifier);
+  if (it == validations->results.end() || it->second.path != path ||
+      monotonic_ns() - it->second.checked_ns > uint64_t{validations->ttl_ms} * 1000000) {
+    return false;
+  }
+
+  *out = it->second;
+  return true;
+}
+
+// Helper: Get bookmarked directory path by identifier
+static bool get_bookmarked_path(DirectoryBookmarksPlugin* self, const char* identifier,
+                                std::string& out_path) {
+  {
+    std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+
+    const json* bookmark = store_find(self, identifier);
+    if (bookmark == nullptr) {
+      return false;
+    }
+
+    out_path = bookmark->value("path", "");
+  }
+
+  DirValidation cached;
+  if (validation_lookup(self, identifier, out_path, &cached)) {
+    return cached.exists;
+  }
+
+  // Validate directory still exists
+  struct stat st;
+  if (stat(out_path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+    return false;
+  }
+
+  return true;
+}
+
+// Helper: Get the directory handle of a bookmark, opening it on first use.
+// Returns null if the bookmark does not exist or its directory is gone.
+static std::shared_ptr<BookmarkDir> bookmark_dir_get(DirectoryBookmarksPlugin* self,
+                                                     const char* identifier) {
+  std::string path;
+  {
+    std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+
+    const json* bookmark = store_find(self, identifier);
+    if (bookmark == nullptr) {
+      return nullptr;
+    }
+
+    path = bookmark->value("path", "");
+  }
+
+  // Fail fast on a directory a recent sweep found missing or unresponsive
+  DirValidation cached;
+  if (validation_lookup(self, identifier, path, &cached) && !cached.exists) {
+    return nullptr;
+  }
+
+  BookmarkDirs* dirs = self->dirs;
+  {
+    std::lock_guard<std::mutex> lock(dirs->mutex);
+    auto it = dirs->open.find(identifier);
+    if (it != dirs->open.end()) {
+      // Our fd keeps a removed directory's inode alive; it then has no links
+      struct stat st;
+      if (it->second->path == path && fstat(it->second->fd, &st) == 0 && st.st_nlink > 0) {
+        return it->second;
+      }
+      dirs->open.erase(it);
+    }
+  }
+
+  auto dir = std::make_shared<BookmarkDir>();
+  dir->path = path;
+  dir->fd = open(path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+  if (dir->fd < 0) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(dirs->mutex);
+  dirs->open[identifier] = dir;
+  return dir;
+}
+
+static FlMethodResponse* bookmark_not_found_error(const char* identifier) {
+  return FL_METHOD_RESPONSE(fl_method_error_response_new(
+      "BOOKMARK_NOT_FOUND",
+      ("Bookmark with identifier '" + std::string(identifier) + "' not found").c_str(),
+      nullptr));
+}
+
+// Register a stream so cancelStream can find it, failing if the id is taken
+static bool streams_add(DirectoryBookmarksPlugin* self,
+                        const std::shared_ptr<EventStream>& stream) {
+  std::lock_guard<std::mutex> lock(self->streams->mutex);
+  return self->streams->active.emplace(stream->id, stream).second;
+}
+
+static void streams_remove(DirectoryBookmarksPlugin* self, int64_t id) {
+  std::lock_guard<std::mutex> lock(self->streams->mutex);
+  self->streams->active.erase(id);
+}
+
+static void streams_cancel_all(DirectoryBookmarksPlugin* self) {
+  std::vector<std::shared_ptr<EventStream>> cancelled;
+  {
+    std::lock_guard<std::mutex> lock(self->streams->mutex);
+    for (auto& [id, stream] : self->streams->active) {
+      if (!stream->cancelled.exchange(true)) {
+        cancelled.push_back(stream);
+      }
+    }
+  }
+
+  for (auto& stream : cancelled) {
+    stream->on_cancel();
+  }
+}
+
+// Build an event map tagged with the stream it belongs to
+static FlValue* stream_event_new(const EventStream& stream, const char* type) {
+  FlValue* event = fl_value_new_map();
+  fl_value_set_string_take(event, "streamId", fl_value_new_int(stream.id));
+  fl_value_set_string_take(event, "type", fl_value_new_string(type));
+  return event;
+}
+
+// An event built on a worker thread waiting to be sent on the main context
+struct PostedEvent {
+  DirectoryBookmarksPlugin* self;
+  FlValue* event;
+  std::function<void()> on_sent;
+};
+
+static gboolean posted_event_send_cb(gpointer user_data) {
+  auto* posted = static_cast<PostedEvent*>(user_data);
+  DirectoryBookmarksPlugin* self = posted->self;
+
+  if (self->events != nullptr && self->events_listening) {
+    fl_event_channel_send(self->events, posted->event, nullptr, nullptr);
+  }
+
+  if (posted->on_sent) {
+    posted->on_sent();
+  }
+
+  fl_value_unref(posted->event);
+  g_object_unref(self);
+  delete posted;
+
+  return G_SOURCE_REMOVE;
+}
+
+// Send an event from any thread, taking ownership of `event`.
+// `on_sent` runs on the main context once the event has been handed to Flutter.
+static void events_post(DirectoryBookmarksPlugin* self, FlValue* event,
+                        std::function<void()> on_sent = nullptr) {
+  auto* posted = new PostedEvent();
+  posted->self = DIRECTORY_BOOKMARKS_PLUGIN(g_object_ref(self));
+  posted->event = event;
+  posted->on_sent = std::move(on_sent);
+  g_main_context_invoke_full(nullptr, G_PRIORITY_DEFAULT, posted_event_send_cb,
+                             posted, nullptr);
+}
+
+// Read up to `length` bytes at `offset`, retrying short reads.
+// Returns the byte count (short only at end of file) or -1 on error.
+static ssize_t pread_full(int fd, uint8_t* buffer, size_t length, off_t offset) {
+  size_t total = 0;
+  while (total < length) {
+    ssize_t n = pread(fd, buffer + total, length - total, offset + total);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (n == 0) {
+      break;
+    }
+    total += n;
+  }
+  return static_cast<ssize_t>(total);
+}
+
+// Open a regular file inside a bookmark for reading.
+// Returns the fd, -1 with `not_found` set if the file does not exist, or -1
+// with `error` set if it exists but cannot be opened.
+static int open_bookmarked_file(int dir_fd, const char* filename, bool* not_found,
+                                std::string* error) {
+  *not_found = false;
+
+  int fd = openat(dir_fd, filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT || errno == ENOTDIR) {
+      *not_found = true;
+    } else {
+      *error = strerror(errno);
+    }
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    *not_found = true;
+    return -1;
+  }
+
+  return fd;
+}
+
+// Transparent compression for saveFile/readFile. Files are written as
+// standard gzip members through GIO's zlib converters, which the plugin
+// already links via GTK, so they stay readable with `gzip -d`.
+enum FileCompression : uint8_t {
+  kCompressionNone = 0,
+  kCompressionGzip = 1,
+};
+
+// Output is produced in pieces of this size
+static constexpr size_t kCompressionChunkSize = 256 << 10;
+
+static bool file_compression_parse(FlValue* value, FileCompression* compression) {
+  if (value == nullptr || fl_value_get_type(value) == FL_VALUE_TYPE_NULL) {
+    *compression = kCompressionNone;
+    return true;
+  }
+  if (fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return false;
+  }
+
+  const char* name = fl_value_get_string(value);
+  if (strcmp(name, "none") == 0) {
+    *compression = kCompressionNone;
+  } else if (strcmp(name, "gzip") == 0) {
+    *compression = kCompressionGzip;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// An absent or null mode picks up the default set through configure
+static bool durability_parse(DirectoryBookmarksPlugin* self, FlValue* value,
+                             Durability* durability) {
+  if (value == nullptr || fl_value_get_type(value) == FL_VALUE_TYPE_NULL) {
+    *durability = static_cast<Durability>(self->store->durability.load());
+    return true;
+  }
+  if (fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return false;
+  }
+
+  const char* name = fl_value_get_string(value);
+  if (strcmp(name, "none") == 0) {
+    *durability = kDurabilityNone;
+  } else if (strcmp(name, "atomic") == 0) {
+    *durability = kDurabilityAtomic;
+  } else if (strcmp(name, "durable") == 0) {
+    *durability = kDurabilityDurable;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static FlMethodResponse* durability_error() {
+  return FL_METHOD_RESPONSE(fl_method_error_response_new(
+      "INVALID_ARGUMENT", "durability must be 'none', 'atomic' or 'durable'", nullptr));
+}
+
+// zlib levels are 1 (fastest) to 9 (smallest); -1 picks zlib's default
+static bool compression_level_parse(FlValue* value, int* level) {
+  *level = -1;
+  if (value == nullptr || fl_value_get_type(value) == FL_VALUE_TYPE_NULL) {
+    return true;
+  }
+  if (fl_value_get_type(value) != FL_VALUE_TYPE_INT ||
+      fl_value_get_int(value) < 1 || fl_value_get_int(value) > 9) {
+    return false;
+  }
+  *level = fl_value_get_int(value);
+  return true;
+}
+
+// Feed `length` bytes through `converter`, handing each piece of output to
+// `sink`. Pass `finish` with the last input to flush the stream.
+// Returns false on a conversion error with `error` set, or with `error`
+// left empty when `sink` returned false.
+static bool converter_run(GConverter* converter, const uint8_t* data, size_t length, bool finish,
+                          const std::function<bool(const uint8_t*, size_t)>& sink,
+                          std::string* error) {
+  std::vector<uint8_t> out(kCompressionChunkSize);
+  GConverterFlags flags = finish ? G_CONVERTER_INPUT_AT_END : G_CONVERTER_NO_FLAGS;
+
+  for (;;) {
+    gsize bytes_read = 0;
+    gsize bytes_written = 0;
+    g_autoptr(GError) convert_error = nullptr;
+    GConverterResult result = g_converter_convert(converter, data, length, out.data(), out.size(),
+                                                  flags, &bytes_read, &bytes_written,
+                                                  &convert_error);
+    if (result == G_CONVERTER_ERROR) {
+      // The converter wants more input than this call has
+      if (!finish && g_error_matches(convert_error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT)) {
+        return true;
+      }
+      *error = convert_error->message;
+      return false;
+    }
+
+    data += bytes_read;
+    length -= bytes_read;
+    if (bytes_written > 0 && !sink(out.data(), bytes_written)) {
+      return false;
+    }
+
+    if (result == G_CONVERTER_FINISHED) {
+      return true;
+    }
+    // A full output buffer may mean more is pending inside the converter
+    if (!finish && length == 0 && bytes_written < out.size()) {
+      return true;
+    }
+  }
+}
+
+// Compress `data` into the open file `fd`
+static bool write_compressed(int fd, const uint8_t* data, size_t length, int level,
+                             std::string* error) {
+  g_autoptr(GZlibCompressor) compressor =
+      g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP, level);
+
+  int write_errno = 0;
+  bool ok = converter_run(G_CONVERTER(compressor), data, length, true,
+      [fd, &write_errno](const uint8_t* out, size_t n) {
+        if (!write_full(fd, out, n)) {
+          write_errno = errno;
+          return false;
+        }
+        return true;
+      }, error);
+
+  if (!ok && write_errno != 0) {
+    *error = strerror(write_errno);
+  }
+  return ok;
+}
+
+// Decompress all of the open file `fd`, appending the result to `out`
+static bool read_decompressed(int fd, GByteArray* out, std::string* error) {
+  g_autoptr(GZlibDecompressor) decompressor =
+      g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  auto append = [out](const uint8_t* data, size_t n) {
+    g_byte_array_append(out, data, n);
+    return true;
+  };
+
+  std::vector<uint8_t> buffer(kCompressionChunkSize);
+  for (off_t offset = 0;;) {
+    ssize_t n = pread_full(fd, buffer.data(), buffer.size(), offset);
+    if (n < 0) {
+      *error = strerror(errno);
+      return false;
+    }
+    offset += n;
+
+    bool finish = static_cast<size_t>(n) < buffer.size();
+    if (!converter_run(G_CONVERTER(decompressor), buffer.data(), n, finish, append, error)) {
+      return false;
+    }
+    if (finish) {
+      return true;
+    }
+  }
+}
+
+// A file written out of place and published under its final name on commit.
+//
+// The data goes into an anonymous O_TMPFILE inode where the filesystem
+// supports it, otherwise into a hidden sibling, so readers of the target
+// only ever see the old contents or the complete new ones.
+struct AtomicFile {
+  int fd = -1;
+  int dir_fd = -1;        // Directory holding the target, O_PATH
+  std::string name;       // Target name within `dir_fd`
+  std::string temp_name;  // Empty while the data lives in an O_TMPFILE
+};
+
+// Build a hidden, unique sibling name for `name`
+static std::string atomic_temp_name(const std::string& name) {
+  static std::atomic<uint64_t> counter{0};
+  return "." + name + "." + std::to_string(getpid()) + "." + std::to_string(counter++) + ".tmp";
+}
+
+static void atomic_file_abort(AtomicFile* file) {
+  if (file->fd >= 0) {
+    close(file->fd);
+    file->fd = -1;
+  }
+  if (!file->temp_name.empty()) {
+    unlinkat(file->dir_fd, file->temp_name.c_str(), 0);
+    file->temp_name.clear();
+  }
+  if (file->dir_fd >= 0) {
+    close(file->dir_fd);
+    file->dir_fd = -1;
+  }
+}
+
+// Start writing `filename`, which may contain directories, below `base_fd`
+static bool atomic_file_open(AtomicFile* file, int base_fd, const std::string& filename,
+                             std::string* error) {
+  fs::path relative(filename);
+  std::string parent = relative.parent_path().string();
+  file->name = relative.filename().string();
+  file->temp_name.clear();
+
+  file->dir_fd = openat(base_fd, parent.empty() ? "." : parent.c_str(),
+                        O_PATH | O_DIRECTORY | O_CLOEXEC);
+  if (file->dir_fd < 0) {
+    *error = strerror(errno);
+    return false;
+  }
+
+  file->fd = openat(file->dir_fd, ".", O_TMPFILE | O_WRONLY | O_CLOEXEC, 0666);
+  if (file->fd >= 0) {
+    return true;
+  }
+
+  // O_TMPFILE is not supported everywhere (older kernels, FUSE, NFS)
+  file->temp_name = atomic_temp_name(file->name);
+  file->fd = openat(file->dir_fd, file->temp_name.c_str(),
+                    O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0666);
+  if (file->fd < 0) {
+    *error = strerror(errno);
+    file->temp_name.clear();
+    atomic_file_abort(file);
+    return false;
+  }
+
+  return true;
+}
+
+// Publish the written data under the target name, replacing any existing file.
+// A durable commit flushes the data first and the directory entry after, so
+// the new contents are on disk before they become visible.
+static bool atomic_file_commit(AtomicFile* file, std::string* error, bool durable = false) {
+  if (durable && fdatasync(file->fd) != 0) {
+    *error = strerror(errno);
+    atomic_file_abort(file);
+    return false;
+  }
+
+  if (file->temp_name.empty()) {
+    // Give the anonymous inode a hidden name first: linkat() refuses to
+    // replace an existing target, rename() does so atomically
+    std::string proc_path = "/proc/self/fd/" + std::to_string(file->fd);
+    std::string temp_name = atomic_temp_name(file->name);
+    if (linkat(AT_FDCWD, proc_path.c_str(), file->dir_fd, temp_name.c_str(),
+               AT_SYMLINK_FOLLOW) != 0) {
+      *error = strerror(errno);
+      atomic_file_abort(file);
+      return false;
+    }
+    file->temp_name = temp_name;
+  }
+
+  if (close(file->fd) != 0) {
+    file->fd = -1;
+    *error = strerror(errno);
+    atomic_file_abort(file);
+    return false;
+  }
+  file->fd = -1;
+
+  if (renameat(file->dir_fd, file->temp_name.c_str(), file->dir_fd, file->name.c_str()) != 0) {
+    *error = strerror(errno);
+    atomic_file_abort(file);
+    return false;
+  }
+
+  file->temp_name.clear();
+  bool ok = !durable || directory_sync(file->dir_fd, ".");
+  if (!ok) {
+    *error = strerror(errno);
+  }
+  close(file->dir_fd);
+  file->dir_fd = -1;
+  return ok;
+}
+
+// Replace `filename` below `dir_fd` with `data`, written in place or out of
+// place as `durability` asks. `cannot_open` is set when the file could not be
+// created at all, which is almost always a permissions problem.
+static bool file_write(int dir_fd, const char* filename, const uint8_t* data, size_t length,
+                       FileCompression compression, int level, Durability durability,
+                       bool* cannot_open, std::string* error) {
+  AtomicFile file;
+  int fd;
+  if (durability == kDurabilityNone) {
+    fd = openat(dir_fd, filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+      *error = strerror(errno);
+    }
+  } else {
+    fd = atomic_file_open(&file, dir_fd, filename, error) ? file.fd : -1;
+  }
+  if (fd < 0) {
+    *cannot_open = true;
+    return false;
+  }
+
+  bool ok;
+  if (compression == kCompressionGzip) {
+    ok = write_compressed(fd, data, length, level, error);
+  } else {
+    ok = write_full(fd, data, length);
+    if (!ok) {
+      *error = strerror(errno);
+    }
+  }
+
+  if (durability == kDurabilityNone) {
+    if (close(fd) != 0 && ok) {
+      ok = false;
+      *error = strerror(errno);
+    }
+  } else if (ok) {
+    ok = atomic_file_commit(&file, error, durability == kDurabilityDurable);
+  } else {
+    atomic_file_abort(&file);
+  }
+  return ok;
+}
+
+// Method: saveFile
+static FlMethodResponse* save_file(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+  FlValue* data_value = fl_value_lookup_string(args, "data");
+  FlValue* compression_value = fl_value_lookup_string(args, "compression");
+  FlValue* level_value = fl_value_lookup_string(args, "compressionLevel");
+  FlValue* durability_value = fl_value_lookup_string(args, "durability");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  }
+
+  if (data_value == nullptr || fl_value_get_type(data_value) != FL_VALUE_TYPE_UINT8_LIST) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "data must be a Uint8List", nullptr));
+  }
+
+  FileCompression compression;
+  if (!file_compression_parse(compression_value, &compression)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "compression must be 'none' or 'gzip'", nullptr));
+  }
+
+  int level;
+  if (!compression_level_parse(level_value, &level)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "compressionLevel must be between 1 and 9", nullptr));
+  }
+
+  Durability durability;
+  if (!durability_parse(self, durability_value, &durability)) {
+    return durability_error();
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  const char* filename = fl_value_get_string(filename_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  // Write file; a directory without write permission fails the open
+  const uint8_t* data = fl_value_get_uint8_list(data_value);
+  size_t length = fl_value_get_length(data_value);
+  bool cannot_open = false;
+  std::string error;
+  bool ok = file_write(dir->fd, filename, data, length, compression, level, durability,
+                       &cannot_open, &error);
+  if (cannot_open) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "PERMISSION_DENIED", ("Cannot write file: " + error).c_str(), nullptr));
+  }
+
+  if (!ok) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "WRITE_ERROR", error.c_str(), nullptr));
+  }
+
+  stats_count_bytes(self, 0, length);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// An upload started by beginWrite and fed by appendChunk
+struct WriteSession {
+  std::mutex mutex;
+  std::string identifier;
+  AtomicFile file;
+  bool durable = false;
+  int64_t written = 0;
+  uint64_t last_used_ns = 0;  // Under `mutex`
+};
+
+struct WriteSessions {
+  std::mutex mutex;
+  int64_t next_id = 1;
+  std::unordered_map<int64_t, std::shared_ptr<WriteSession>> open;
+};
+
+// Each open session holds a descriptor, so a client that forgets to commit
+// or abort must not be able to pile them up: sessions untouched for this
+// long are discarded, and beyond the cap beginWrite is refused.
+static constexpr uint64_t kWriteSessionIdleNs = 300ull * 1000000000;
+static constexpr size_t kMaxWriteSessions = 64;
+
+// Discard idle sessions; the caller holds `sessions->mutex`. A session busy
+// in another call is in use by definition and skipped.
+static void write_sessions_reap(WriteSessions* sessions) {
+  uint64_t now = monotonic_ns();
+  for (auto it = sessions->open.begin(); it != sessions->open.end();) {
+    WriteSession* session = it->second.get();
+    std::unique_lock<std::mutex> session_lock(session->mutex, std::try_to_lock);
+    if (session_lock.owns_lock() && now - session->last_used_ns > kWriteSessionIdleNs) {
+      atomic_file_abort(&session->file);
+      it = sessions->open.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// Look up a write session from the `session` argument
+static std::shared_ptr<WriteSession> write_session_lookup(DirectoryBookmarksPlugin* self,
+                                                          FlValue* args, bool remove,
+                                                          FlMethodResponse** error) {
+  FlValue* session_value = fl_value_lookup_string(args, "session");
+
+  if (session_value == nullptr || fl_value_get_type(session_value) != FL_VALUE_TYPE_INT) {
+    *error = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "session must be an integer", nullptr));
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(self->write_sessions->mutex);
+  write_sessions_reap(self->write_sessions);
+  auto it = self->write_sessions->open.find(fl_value_get_int(session_value));
+  if (it == self->write_sessions->open.end()) {
+    *error = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "SESSION_NOT_FOUND", "Write session not found or already finished", nullptr));
+    return nullptr;
+  }
+
+  std::shared_ptr<WriteSession> session = it->second;
+  if (remove) {
+    self->write_sessions->open.erase(it);
+  }
+  return session;
+}
+
+// Method: beginWrite
+static FlMethodResponse* begin_write(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+  FlValue* expected_size_value = fl_value_lookup_string(args, "expectedSize");
+  FlValue* durability_value = fl_value_lookup_string(args, "durability");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  }
+
+  // Sessions always write out of place, so only the sync step is optional
+  Durability durability;
+  if (!durability_parse(self, durability_value, &durability)) {
+    return durability_error();
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  const char* filename = fl_value_get_string(filename_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(self->write_sessions->mutex);
+    write_sessions_reap(self->write_sessions);
+    if (self->write_sessions->open.size() >= kMaxWriteSessions) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "TOO_MANY_SESSIONS", "Too many open write sessions; commit or abort some first",
+          nullptr));
+    }
+  }
+
+  auto session = std::make_shared<WriteSession>();
+  session->identifier = identifier;
+  session->durable = durability == kDurabilityDurable;
+  session->last_used_ns = monotonic_ns();
+
+  std::string error;
+  if (!atomic_file_open(&session->file, dir->fd, filename, &error)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "PERMISSION_DENIED", ("Cannot write file: " + error).c_str(), nullptr));
+  }
+
+  // Reserve space up front when the final size is known; a filesystem
+  // without fallocate support simply allocates as we go
+  if (expected_size_value != nullptr &&
+      fl_value_get_type(expected_size_value) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(expected_size_value) > 0) {
+    fallocate(session->file.fd, FALLOC_FL_KEEP_SIZE, 0, fl_value_get_int(expected_size_value));
+  }
+
+  int64_t id;
+  {
+    std::lock_guard<std::mutex> lock(self->write_sessions->mutex);
+    id = self->write_sessions->next_id++;
+    self->write_sessions->open.emplace(id, session);
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_int(id)));
+}
+
+// Method: appendChunk
+static FlMethodResponse* append_chunk(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* data_value = fl_value_lookup_string(args, "data");
+
+  if (data_value == nullptr || fl_value_get_type(data_value) != FL_VALUE_TYPE_UINT8_LIST) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "data must be a Uint8List", nullptr));
+  }
+
+  FlMethodResponse* error = nullptr;
+  std::shared_ptr<WriteSession> session = write_session_lookup(self, args, false, &error);
+  if (session == nullptr) {
+    return error;
+  }
+
+  std::lock_guard<std::mutex> lock(session->mutex);
+  if (session->file.fd < 0) {
+    // Finished or discarded while this call was waiting for the session
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "SESSION_NOT_FOUND", "write session is closed", nullptr));
+  }
+
+  size_t length = fl_value_get_length(data_value);
+  if (!write_full(session->file.fd, fl_value_get_uint8_list(data_value), length)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "WRITE_ERROR", strerror(errno), nullptr));
+  }
+
+  session->written += length;
+  session->last_used_ns = monotonic_ns();
+  stats_count_bytes(self, 0, length);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_int(session->written)));
+}
+
+// Method: commitWrite
+static FlMethodResponse* commit_write(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlMethodResponse* error_response = nullptr;
+  std::shared_ptr<WriteSession> session = write_session_lookup(self, args, true, &error_response);
+  if (session == nullptr) {
+    return error_response;
+  }
+
+  std::lock_guard<std::mutex> lock(session->mutex);
+  if (session->file.fd < 0) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "SESSION_NOT_FOUND", "write session is closed", nullptr));
+  }
+
+  std::string error;
+  if (!atomic_file_commit(&session->file, &error, session->durable)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "WRITE_ERROR", error.c_str(), nullptr));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Method: abortWrite
+static FlMethodResponse* abort_write(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* session_value = fl_value_lookup_string(args, "session");
+
+  if (session_value == nullptr || fl_value_get_type(session_value) != FL_VALUE_TYPE_INT) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "session must be an integer", nullptr));
+  }
+
+  // Aborting a finished or unknown session is not an error
+  g_autoptr(FlMethodResponse) error = nullptr;
+  std::shared_ptr<WriteSession> session = write_session_lookup(self, args, true, &error);
+  if (session == nullptr) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+  }
+
+  std::lock_guard<std::mutex> lock(session->mutex);
+  atomic_file_abort(&session->file);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Method: readFile
+static FlMethodResponse* read_file(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+  FlValue* compression_value = fl_value_lookup_string(args, "compression");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  }
+
+  FileCompression compression;
+  if (!file_compression_parse(compression_value, &compression)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "compression must be 'none' or 'gzip'", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  const char* filename = fl_value_get_string(filename_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  // Missing files and non-regular entries read as null
+  bool not_found = false;
+  std::string error;
+  int fd = open_bookmarked_file(dir->fd, filename, &not_found, &error);
+  if (fd < 0) {
+    if (not_found) {
+      return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_null()));
+    }
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "PERMISSION_DENIED", ("Cannot read file: " + error).c_str(), nullptr));
+  }
+
+  if (compression == kCompressionGzip) {
+    g_autoptr(GByteArray) contents = g_byte_array_new();
+    bool ok = read_decompressed(fd, contents, &error);
+    close(fd);
+
+    if (!ok) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "READ_ERROR", error.c_str(), nullptr));
+    }
+
+    stats_count_bytes(self, contents->len, 0);
+    g_autoptr(FlValue) result = fl_value_new_uint8_list(contents->data, contents->len);
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
+
+  struct stat st;
+  fstat(fd, &st);
+
+  std::vector<uint8_t> buffer(st.st_size);
+  ssize_t n = pread_full(fd, buffer.data(), buffer.size(), 0);
+  int saved_errno = errno;
+  close(fd);
+
+  if (n < 0) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "READ_ERROR", strerror(saved_errno), nullptr));
+  }
+
+  stats_count_bytes(self, n, 0);
+  g_autoptr(FlValue) result = fl_value_new_uint8_list(buffer.data(), n);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Method: readFileRange
+static FlMethodResponse* read_file_range(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+  FlValue* offset_value = fl_value_lookup_string(args, "offset");
+  FlValue* length_value = fl_value_lookup_string(args, "length");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  }
+
+  if (offset_value == nullptr || fl_value_get_type(offset_value) != FL_VALUE_TYPE_INT ||
+      fl_value_get_int(offset_value) < 0) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "offset must be a non-negative integer", nullptr));
+  }
+
+  if (length_value == nullptr || fl_value_get_type(length_value) != FL_VALUE_TYPE_INT ||
+      fl_value_get_int(length_value) < 0) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "length must be a non-negative integer", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  const char* filename = fl_value_get_string(filename_value);
+  off_t offset = fl_value_get_int(offset_value);
+  size_t length = fl_value_get_int(length_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  bool not_found = false;
+  std::string error;
+  int fd = open_bookmarked_file(dir->fd, filename, &not_found, &error);
+  if (fd < 0) {
+    if (not_found) {
+      return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_null()));
+    }
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "PERMISSION_DENIED", ("Cannot read file: " + error).c_str(), nullptr));
+  }
+
+  // Never allocate past the end of the file, whatever length was asked for
+  struct stat st;
+  fstat(fd, &st);
+  size_t available = offset < st.st_size ? static_cast<size_t>(st.st_size - offset) : 0;
+  length = std::min(length, available);
+
+  posix_fadvise(fd, offset, length, POSIX_FADV_SEQUENTIAL);
+
+  std::vector<uint8_t> buffer(length);
+  ssize_t n = pread_full(fd, buffer.data(), length, offset);
+  int saved_errno = errno;
+  close(fd);
+
+  if (n < 0) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "READ_ERROR", strerror(saved_errno), nullptr));
+  }
+
+  stats_count_bytes(self, n, 0);
+  g_autoptr(FlValue) result = fl_value_new_uint8_list(buffer.data(), n);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Minimal io_uring ring driven through the raw syscalls, used to batch the
+// open/stat/read/close steps of multi-file calls
+struct IoRing {
+  int fd = -1;
+  unsigned entries = 0;
+  void* sq_ring = MAP_FAILED;
+  size_t sq_ring_size = 0;
+  void* cq_ring = MAP_FAILED;
+  size_t cq_ring_size = 0;
+  struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+  size_t sqes_size = 0;
+
+  unsigned* sq_tail = nullptr;
+  unsigned* sq_mask = nullptr;
+  unsigned* sq_array = nullptr;
+  unsigned* cq_head = nullptr;
+  unsigned* cq_tail = nullptr;
+  unsigned* cq_mask = nullptr;
+  struct io_uring_cqe* cqes = nullptr;
+};
+
+// Largest ring set up for one call; bigger batches are run in rounds
+static constexpr unsigned kMaxIoRingEntries = 256;
+
+// Files above this size are read with pread(), since one ring read
+// completes with an int byte count
+static constexpr off_t kMaxIoRingRead = 1 << 30;
+
+// Up to this many files per fallback thread
+static constexpr size_t kFilesPerThread = 32;
+
+static void io_ring_free(IoRing* ring) {
+  if (ring->sqes != MAP_FAILED) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+  if (ring->sq_ring != MAP_FAILED) {
+    munmap(ring->sq_ring, ring->sq_ring_size);
+  }
+  if (ring->fd >= 0) {
+    close(ring->fd);
+  }
+  *ring = IoRing();
+}
+
+// Whether the kernel's io_uring supports every opcode the multi-file calls
+// use (they arrived in 5.6). io_uring can also be disabled by sysctl or a
+// seccomp filter; either way the caller falls back to a thread pool.
+static bool io_ring_supported(int ring_fd) {
+  size_t size = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+  std::vector<uint8_t> buffer(size);
+  auto* probe = reinterpret_cast<struct io_uring_probe*>(buffer.data());
+  if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe,
+              IORING_OP_LAST) < 0) {
+    return false;
+  }
+
+  for (int op : {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE,
+                 IORING_OP_CLOSE}) {
+    if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool io_ring_init(IoRing* ring, unsigned entries) {
+  // Remember a missing or disabled io_uring instead of probing on every call
+  static std::atomic<int> available{-1};
+  if (available.load() == 0) {
+    return false;
+  }
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+  if (ring->fd < 0) {
+    if (errno == ENOSYS || errno == EPERM) {
+      available = 0;
+    }
+    return false;
+  }
+
+  if (available.load() < 0) {
+    available = io_ring_supported(ring->fd) ? 1 : 0;
+  }
+  if (available.load() == 0) {
+    io_ring_free(ring);
+    return false;
+  }
+
+  ring->entries = params.sq_entries;
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    ring->sq_ring_size = ring->cq_ring_size = std::max(ring->sq_ring_size, ring->cq_ring_size);
+  }
+
+  ring->sq_ring = mmap(nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_ring = single_mmap ? ring->sq_ring
+                              : mmap(nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = static_cast<struct io_uring_sqe*>(
+      mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+           ring->fd, IORING_OFF_SQES));
+  if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+    io_ring_free(ring);
+    return false;
+  }
+
+  auto* sq = static_cast<uint8_t*>(ring->sq_ring);
+  auto* cq = static_cast<uint8_t*>(ring->cq_ring);
+  ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  ring->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  ring->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  ring->cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+  return true;
+}
+
+// Consecutive EAGAIN/EBUSY results from io_uring_enter, with nothing
+// reaped in between, after which the error is treated as persistent
+static constexpr int kMaxIoRingRetries = 64;
+
+// Submit one operation per index in `indexes` (at most `entries` of them),
+// filled in by `prepare`, and wait until all have completed, handing each
+// result to `complete`. Returns false only if nothing could be submitted.
+// If submitting fails partway, the entries the kernel never took are
+// completed with the submit error and only the accepted ones are waited for.
+static bool io_ring_run(IoRing* ring, const std::vector<size_t>& indexes,
+                        const std::function<void(size_t, struct io_uring_sqe*)>& prepare,
+                        const std::function<void(size_t, int)>& complete) {
+  if (indexes.empty()) {
+    return true;
+  }
+
+  unsigned tail = *ring->sq_tail;
+  for (size_t index : indexes) {
+    unsigned slot = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[slot];
+    memset(sqe, 0, sizeof(*sqe));
+    prepare(index, sqe);
+    sqe->user_data = index;
+    ring->sq_array[slot] = slot;
+    tail++;
+  }
+  __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+  size_t count = indexes.size();
+  size_t accepted = 0;
+  size_t completed = 0;
+  bool submitting = true;
+  int retries = 0;
+  while (completed < accepted || (submitting && accepted < count)) {
+    unsigned to_submit = submitting ? count - accepted : 0;
+    int submitted = syscall(__NR_io_uring_enter, ring->fd, to_submit, 1,
+                            IORING_ENTER_GETEVENTS, nullptr, 0);
+    int error = submitted < 0 ? errno : 0;
+    if (submitted > 0) {
+      accepted += std::min<size_t>(submitted, to_submit);
+    }
+
+    // Reap on every pass: EAGAIN and EBUSY ask for completions to be
+    // consumed before entering again
+    unsigned head = *ring->cq_head;
+    unsigned cq_tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    bool reaped = head != cq_tail;
+    for (; head != cq_tail; head++) {
+      const struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+      complete(cqe->user_data, cqe->res);
+      completed++;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    if (error == 0 || reaped) {
+      retries = 0;
+    }
+    if (error == 0 || error == EINTR ||
+        ((error == EAGAIN || error == EBUSY) && (reaped || ++retries < kMaxIoRingRetries))) {
+      continue;
+    }
+
+    if (submitting) {
+      // Give up on submitting; the kernel never saw the remaining entries,
+      // so they can be taken back off the queue
+      submitting = false;
+      __atomic_store_n(ring->sq_tail, tail - (count - accepted), __ATOMIC_RELEASE);
+      if (accepted == 0) {
+        return false;
+      }
+      for (size_t i = accepted; i < count; i++) {
+        complete(indexes[i], -error);
+      }
+      continue;
+    }
+
+    // Operations in flight still reference the caller's buffers, so keep
+    // waiting for them, blocked on the ring rather than spinning
+    struct pollfd pfd = {ring->fd, POLLIN, 0};
+    poll(&pfd, 1, -1);
+  }
+
+  return true;
+}
+
+// One file of a readFiles or saveFiles call
+struct FileJob {
+  std::string name;
+  int fd = -1;
+  int error = 0;         // errno of the step that failed
+  bool missing = false;  // Reads: no regular file by that name
+  std::vector<uint8_t> data;
+
+  // Writes: the bytes to store
+  const uint8_t* source = nullptr;
+  size_t length = 0;
+};
+
+// Read or write jobs [begin, end) one at a time with plain syscalls
+static void file_jobs_run_sync(int dir_fd, std::vector<FileJob>* jobs, size_t begin, size_t end,
+                               bool write) {
+  for (size_t i = begin; i < end; i++) {
+    FileJob& job = (*jobs)[i];
+
+    if (write) {
+      int fd = openat(dir_fd, job.name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+      if (fd < 0) {
+        job.error = errno;
+        continue;
+      }
+      if (!write_full(fd, job.source, job.length)) {
+        job.error = errno;
+      }
+      if (close(fd) != 0 && job.error == 0) {
+        job.error = errno;
+      }
+      continue;
+    }
+
+    std::string error;
+    int fd = open_bookmarked_file(dir_fd, job.name.c_str(), &job.missing, &error);
+    if (fd < 0) {
+      job.error = job.missing ? 0 : errno;
+      continue;
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    job.data.resize(st.st_size);
+    ssize_t n = pread_full(fd, job.data.data(), job.data.size(), 0);
+    if (n < 0) {
+      job.error = errno;
+    } else {
+      job.data.resize(n);
+    }
+    close(fd);
+  }
+}
+
+// Spread jobs over a few threads when io_uring is not available
+static void file_jobs_run_threaded(int dir_fd, std::vector<FileJob>* jobs, bool write) {
+  size_t count = jobs->size();
+  size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), 8);
+  threads = std::min(threads, (count + kFilesPerThread - 1) / kFilesPerThread);
+
+  if (threads <= 1) {
+    file_jobs_run_sync(dir_fd, jobs, 0, count, write);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  size_t slice = (count + threads - 1) / threads;
+  for (size_t begin = 0; begin < count; begin += slice) {
+    workers.emplace_back(file_jobs_run_sync, dir_fd, jobs, begin, std::min(count, begin + slice),
+                         write);
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+// Read or write the whole of an opened job's file with plain syscalls
+static void file_job_transfer_sync(FileJob* job, bool write) {
+  if (write) {
+    if (!write_full(job->fd, job->source, job->length)) {
+      job->error = errno;
+    }
+    return;
+  }
+
+  ssize_t n = pread_full(job->fd, job->data.data(), job->data.size(), 0);
+  if (n < 0) {
+    job->error = errno;
+  } else {
+    job->data.resize(n);
+  }
+}
+
+// Run jobs [begin, end) through the ring as a few batched rounds:
+// open everything, stat (reads only), transfer, close
+static bool file_jobs_run_ring(IoRing* ring, int dir_fd, std::vector<FileJob>* jobs,
+                               size_t begin, size_t end, bool write) {
+  std::vector<FileJob>& all = *jobs;
+  std::vector<size_t> pending;
+  for (size_t i = begin; i < end; i++) {
+    pending.push_back(i);
+  }
+
+  // Open
+  int open_flags = write ? O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC : O_RDONLY | O_CLOEXEC;
+  bool ok = io_ring_run(ring, pending,
+      [&](size_t i, struct io_uring_sqe* sqe) {
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = dir_fd;
+        sqe->addr = reinterpret_cast<uintptr_t>(all[i].name.c_str());
+        sqe->open_flags = open_flags;
+        sqe->len = 0666;
+      },
+      [&](size_t i, int res) {
+        if (res >= 0) {
+          all[i].fd = res;
+        } else if (!write && (res == -ENOENT || res == -ENOTDIR)) {
+          all[i].missing = true;
+        } else {
+          all[i].error = -res;
+        }
+      });
+  if (!ok) {
+    return false;
+  }
+
+  auto opened = [&]() {
+    std::vector<size_t> indexes;
+    for (size_t i = begin; i < end; i++) {
+      if (all[i].fd >= 0 && all[i].error == 0) {
+        indexes.push_back(i);
+      }
+    }
+    return indexes;
+  };
+
+  if (!write) {
+    // Size the buffers, skipping anything that is not a regular file
+    std::vector<struct statx> stats(end - begin);
+    std::vector<size_t> to_stat = opened();
+    ok = io_ring_run(ring, to_stat,
+        [&](size_t i, struct io_uring_sqe* sqe) {
+          sqe->opcode = IORING_OP_STATX;
+          sqe->fd = all[i].fd;
+          sqe->addr = reinterpret_cast<uintptr_t>("");
+          sqe->statx_flags = AT_EMPTY_PATH;
+          sqe->len = STATX_TYPE | STATX_SIZE;
+          sqe->off = reinterpret_cast<uintptr_t>(&stats[i - begin]);
+        },
+        [&](size_t i, int res) {
+          const struct statx& stx = stats[i - begin];
+          if (res < 0) {
+            all[i].error = -res;
+          } else if (!S_ISREG(stx.stx_mode)) {
+            all[i].missing = true;
+          } else {
+            all[i].data.resize(stx.stx_size);
+          }
+        });
+    for (size_t i : ok ? std::vector<size_t>() : to_stat) {
+      struct stat st;
+      if (fstat(all[i].fd, &st) != 0) {
+        all[i].error = errno;
+      } else if (!S_ISREG(st.st_mode)) {
+        all[i].missing = true;
+      } else {
+        all[i].data.resize(st.st_size);
+      }
+    }
+  }
+
+  std::vector<size_t> transfers;
+  for (size_t i : opened()) {
+    if (all[i].missing) {
+      continue;
+    }
+    size_t length = write ? all[i].length : all[i].data.size();
+    if (length > static_cast<size_t>(kMaxIoRingRead)) {
+      // Too large for one ring operation
+      file_job_transfer_sync(&all[i], write);
+    } else if (length > 0) {
+      transfers.push_back(i);
+    }
+  }
+
+  ok = io_ring_run(ring, transfers,
+      [&](size_t i, struct io_uring_sqe* sqe) {
+        sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe->fd = all[i].fd;
+        sqe->addr = write ? reinterpret_cast<uintptr_t>(all[i].source)
+                          : reinterpret_cast<uintptr_t>(all[i].data.data());
+        sqe->len = write ? all[i].length : all[i].data.size();
+        sqe->off = 0;
+      },
+      [&](size_t i, int res) {
+        FileJob& job = all[i];
+        if (res < 0) {
+          job.error = -res;
+        } else if (write && static_cast<size_t>(res) < job.length) {
+          // Finish a short write synchronously
+          if (!write_full(job.fd, job.source + res, job.length - res)) {
+            job.error = errno;
+          }
+        } else if (!write) {
+          // A short read means the file shrank in the meantime
+          job.data.resize(res);
+        }
+      });
+  for (size_t i : ok ? std::vector<size_t>() : transfers) {
+    file_job_transfer_sync(&all[i], write);
+  }
+
+  // Close
+  std::vector<size_t> to_close;
+  for (size_t i = begin; i < end; i++) {
+    if (all[i].fd >= 0) {
+      to_close.push_back(i);
+    }
+  }
+  io_ring_run(ring, to_close,
+      [&](size_t i, struct io_uring_sqe* sqe) {
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = all[i].fd;
+      },
+      [&](size_t i, int res) {
+        if (res < 0 && write && all[i].error == 0) {
+          all[i].error = -res;
+        }
+        all[i].fd = -1;
+      });
+  for (size_t i : to_close) {
+    if (all[i].fd >= 0 && close(all[i].fd) != 0 && write && all[i].error == 0) {
+      all[i].error = errno;
+    }
+    all[i].fd = -1;
+  }
+
+  if (!write) {
+    for (size_t i = begin; i < end; i++) {
+      if (all[i].missing) {
+        all[i].data.clear();
+      }
+    }
+  }
+
+  return true;
+}
+
+// Read or write every job relative to `dir_fd`, batched through io_uring
+// where the kernel supports it
+static void file_jobs_run(int dir_fd, std::vector<FileJob>* jobs, bool write) {
+  size_t count = jobs->size();
+  IoRing ring;
+  if (count == 0 || !io_ring_init(&ring, std::min<size_t>(count, kMaxIoRingEntries))) {
+    file_jobs_run_threaded(dir_fd, jobs, write);
+    return;
+  }
+
+  for (size_t begin = 0; begin < count; begin += ring.entries) {
+    size_t end = std::min<size_t>(count, begin + ring.entries);
+    if (!file_jobs_run_ring(&ring, dir_fd, jobs, begin, end, write)) {
+      // The ring stopped accepting work; no job past `begin` has started
+      std::vector<FileJob> rest(std::make_move_iterator(jobs->begin() + begin),
+                                std::make_move_iterator(jobs->end()));
+      file_jobs_run_threaded(dir_fd, &rest, write);
+      std::move(rest.begin(), rest.end(), jobs->begin() + begin);
+      break;
+    }
+  }
+
+  io_ring_free(&ring);
+}
+
+// Files held open at once by file_jobs_write_atomic, bounding its descriptors
+static constexpr size_t kAtomicBatchFiles = 256;
+
+// Write every job out of place, publishing each file once its data is
+// complete. Durable batches flush the data with one syncfs() per filesystem
+// instead of an fdatasync() per file, then each directory once.
+static void file_jobs_write_atomic(int dir_fd, std::vector<FileJob>* jobs, bool durable) {
+  for (size_t begin = 0; begin < jobs->size(); begin += kAtomicBatchFiles) {
+    size_t end = std::min(jobs->size(), begin + kAtomicBatchFiles);
+    std::vector<AtomicFile> files(end - begin);
+    std::map<dev_t, int> filesystems;
+    bool synced = durable;
+
+    for (size_t i = begin; i < end; i++) {
+      FileJob& job = (*jobs)[i];
+      AtomicFile& file = files[i - begin];
+      std::string error;
+      if (!atomic_file_open(&file, dir_fd, job.name, &error)) {
+        job.error = errno != 0 ? errno : EIO;
+        continue;
+      }
+      if (!write_full(file.fd, job.source, job.length)) {
+        job.error = errno;
+        atomic_file_abort(&file);
+        continue;
+      }
+
+      struct stat st;
+      if (durable && fstat(file.fd, &st) == 0) {
+        filesystems.emplace(st.st_dev, file.fd);
+      } else {
+        synced = false;
+      }
+    }
+
+    for (const auto& [dev, fd] : filesystems) {
+      synced = synced && syncfs(fd) == 0;
+    }
+
+    // Without a working syncfs() each commit flushes its own file
+    std::map<std::string, std::vector<size_t>> parents;
+    for (size_t i = begin; i < end; i++) {
+      FileJob& job = (*jobs)[i];
+      if (job.error != 0) {
+        continue;
+      }
+      std::string error;
+      if (!atomic_file_commit(&files[i - begin], &error, durable && !synced)) {
+        job.error = errno != 0 ? errno : EIO;
+        continue;
+      }
+      if (synced) {
+        parents[fs::path(job.name).parent_path().string()].push_back(i);
+      }
+    }
+
+    for (const auto& [parent, members] : parents) {
+      if (!directory_sync(dir_fd, parent.empty() ? "." : parent.c_str())) {
+        int error = errno;
+        for (size_t i : members) {
+          (*jobs)[i].error = error;
+        }
+      }
+    }
+  }
+}
+
+// Method: readFiles
+static FlMethodResponse* read_files(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* names_value = fl_value_lookup_string(args, "fileNames");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (names_value == nullptr || fl_value_get_type(names_value) != FL_VALUE_TYPE_LIST) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "fileNames must be a list of strings", nullptr));
+  }
+
+  std::vector<FileJob> jobs(fl_value_get_length(names_value));
+  for (size_t i = 0; i < jobs.size(); i++) {
+    FlValue* name_value = fl_value_get_list_value(names_value, i);
+    if (fl_value_get_type(name_value) != FL_VALUE_TYPE_STRING) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "fileNames must be a list of strings", nullptr));
+    }
+    jobs[i].name = fl_value_get_string(name_value);
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  file_jobs_run(dir->fd, &jobs, false);
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  for (FileJob& job : jobs) {
+    if (job.error != 0) {
+      // Reads have no side effects, so one unreadable file fails the call
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          job.error == EACCES || job.error == EPERM ? "PERMISSION_DENIED" : "READ_ERROR",
+          ("Cannot read file '" + job.name + "': " + strerror(job.error)).c_str(), nullptr));
+    }
+    stats_count_bytes(self, job.data.size(), 0);
+    fl_value_set_take(result, fl_value_new_string_safe(job.name),
+                      job.missing ? fl_value_new_null()
+                                  : fl_value_new_uint8_list(job.data.data(), job.data.size()));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Method: saveFiles
+static FlMethodResponse* save_files(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* files_value = fl_value_lookup_string(args, "files");
+  FlValue* durability_value = fl_value_lookup_string(args, "durability");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (files_value == nullptr || fl_value_get_type(files_value) != FL_VALUE_TYPE_MAP) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "files must be a map of file names to Uint8List", nullptr));
+  }
+
+  Durability durability;
+  if (!durability_parse(self, durability_value, &durability)) {
+    return durability_error();
+  }
+
+  std::vector<FileJob> jobs(fl_value_get_length(files_value));
+  for (size_t i = 0; i < jobs.size(); i++) {
+    FlValue* name_value = fl_value_get_map_key(files_value, i);
+    FlValue* data_value = fl_value_get_map_value(files_value, i);
+    if (fl_value_get_type(name_value) != FL_VALUE_TYPE_STRING ||
+        fl_value_get_type(data_value) != FL_VALUE_TYPE_UINT8_LIST) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "files must be a map of file names to Uint8List", nullptr));
+    }
+    jobs[i].name = fl_value_get_string(name_value);
+    jobs[i].source = fl_value_get_uint8_list(data_value);
+    jobs[i].length = fl_value_get_length(data_value);
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  if (durability == kDurabilityNone) {
+    file_jobs_run(dir->fd, &jobs, true);
+  } else {
+    file_jobs_write_atomic(dir->fd, &jobs, durability == kDurabilityDurable);
+  }
+
+  // Files written before a failure stay written, so report each one
+  g_autoptr(FlValue) result = fl_value_new_map();
+  for (const FileJob& job : jobs) {
+    fl_value_set_take(result, fl_value_new_string_safe(job.name),
+                      fl_value_new_bool(job.error == 0));
+    if (job.error == 0) {
+      stats_count_bytes(self, 0, job.length);
+    }
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// A chunked file read delivered as "chunk" events followed by "done"
+struct ReadStream : EventStream {
+  int fd = -1;
+  off_t offset = 0;
+  off_t end = 0;
+  size_t chunk_size = 0;
+
+  // Set for compressed files, whose `offset` and `end` then count
+  // decompressed bytes
+  GConverter* decompressor = nullptr;
+
+  // At most one chunk is queued for the main context at a time, which keeps
+  // native memory bounded by the chunk size however slow the consumer is
+  std::mutex mutex;
+  std::condition_variable sent_cond;
+  bool chunk_in_flight = false;
+
+  ~ReadStream() override {
+    if (fd >= 0) {
+      close(fd);
+    }
+    if (decompressor != nullptr) {
+      g_object_unref(decompressor);
+    }
+  }
+};
+
+static constexpr size_t kDefaultStreamChunkSize = 1 << 20;
+static constexpr size_t kMinStreamChunkSize = 4 << 10;
+static constexpr size_t kMaxStreamChunkSize = 64 << 20;
+
+// Post one chunk at the stream's offset and wait until it has been sent
+static void read_stream_send(DirectoryBookmarksPlugin* self,
+                             const std::shared_ptr<ReadStream>& stream, const uint8_t* data,
+                             size_t length) {
+  FlValue* event = stream_event_new(*stream, "chunk");
+  fl_value_set_string_take(event, "offset", fl_value_new_int(stream->offset));
+  fl_value_set_string_take(event, "data", fl_value_new_uint8_list(data, length));
+  stream->offset += length;
+  stats_count_bytes(self, length, 0);
+
+  {
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    stream->chunk_in_flight = true;
+  }
+  events_post(self, event, [stream]() {
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    stream->chunk_in_flight = false;
+    stream->sent_cond.notify_one();
+  });
+
+  std::unique_lock<std::mutex> lock(stream->mutex);
+  stream->sent_cond.wait(lock, [&stream]() {
+    return !stream->chunk_in_flight;
+  });
+}
+
+// Stream the decompressed contents of a compressed file. Output before the
+// requested offset is decoded and dropped, since gzip cannot seek.
+static bool read_stream_decompress(DirectoryBookmarksPlugin* self,
+                                   const std::shared_ptr<ReadStream>& stream,
+                                   std::string* error) {
+  posix_fadvise(stream->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  const off_t from = stream->offset;
+  off_t produced = 0;
+  std::vector<uint8_t> pending;
+
+  auto sink = [&](const uint8_t* data, size_t length) {
+    off_t begin = std::max(produced, from);
+    off_t end = std::min<off_t>(produced + length, stream->end);
+    if (begin < end) {
+      pending.insert(pending.end(), data + (begin - produced), data + (end - produced));
+    }
+    produced += length;
+
+    while (pending.size() >= stream->chunk_size && !stream->cancelled) {
+      read_stream_send(self, stream, pending.data(), stream->chunk_size);
+      pending.erase(pending.begin(), pending.begin() + stream->chunk_size);
+    }
+    return !stream->cancelled && produced < stream->end;
+  };
+
+  std::vector<uint8_t> input(kCompressionChunkSize);
+  for (off_t position = 0;;) {
+    ssize_t n = pread_full(stream->fd, input.data(), input.size(), position);
+    if (n < 0) {
+      *error = strerror(errno);
+      return false;
+    }
+    position += n;
+
+    bool finish = static_cast<size_t>(n) < input.size();
+    if (!converter_run(stream->decompressor, input.data(), n, finish, sink, error)) {
+      if (!error->empty()) {
+        return false;
+      }
+      break;
+    }
+    if (finish) {
+      break;
+    }
+  }
+
+  if (!pending.empty() && !stream->cancelled) {
+    read_stream_send(self, stream, pending.data(), pending.size());
+  }
+  return true;
+}
+
+// Stream the bytes of [offset, end) as stored.
+// Returns the final event, or null once cancelled.
+static FlValue* read_stream_copy(DirectoryBookmarksPlugin* self,
+                                 const std::shared_ptr<ReadStream>& stream) {
+  posix_fadvise(stream->fd, stream->offset, stream->end - stream->offset,
+                POSIX_FADV_SEQUENTIAL);
+
+  std::vector<uint8_t> buffer(stream->chunk_size);
+
+  while (!stream->cancelled) {
+    size_t wanted = std::min<off_t>(stream->chunk_size, stream->end - stream->offset);
+    if (wanted == 0) {
+      return stream_event_new(*stream, "done");
+    }
+
+    ssize_t n = pread_full(stream->fd, buffer.data(), wanted, stream->offset);
+    if (n < 0) {
+      FlValue* event = stream_event_new(*stream, "error");
+      fl_value_set_string_take(event, "message", fl_value_new_string(strerror(errno)));
+      return event;
+    }
+    if (n == 0) {
+      // File shrank underneath us
+      return stream_event_new(*stream, "done");
+    }
+
+    read_stream_send(self, stream, buffer.data(), n);
+  }
+
+  return nullptr;
+}
+
+static void read_stream_run(DirectoryBookmarksPlugin* self, std::shared_ptr<ReadStream> stream) {
+  FlValue* last_event = nullptr;
+
+  if (stream->decompressor != nullptr) {
+    std::string error;
+    if (!read_stream_decompress(self, stream, &error)) {
+      last_event = stream_event_new(*stream, "error");
+      fl_value_set_string_take(last_event, "message", fl_value_new_string_safe(error));
+    } else if (!stream->cancelled) {
+      last_event = stream_event_new(*stream, "done");
+    }
+  } else {
+    last_event = read_stream_copy(self, stream);
+  }
+
+  if (last_event != nullptr) {
+    events_post(self, last_event);
+  }
+
+  streams_remove(self, stream->id);
+  object_unref_on_main(self);
+}
+
+// Method: startReadStream
+static FlMethodResponse* start_read_stream(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+  FlValue* stream_id_value = fl_value_lookup_string(args, "streamId");
+  FlValue* chunk_size_value = fl_value_lookup_string(args, "chunkSize");
+  FlValue* offset_value = fl_value_lookup_string(args, "offset");
+  FlValue* length_value = fl_value_lookup_string(args, "length");
+  FlValue* compression_value = fl_value_lookup_string(args, "compression");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  }
+
+  if (stream_id_value == nullptr || fl_value_get_type(stream_id_value) != FL_VALUE_TYPE_INT) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "streamId must be an integer", nullptr));
+  }
+
+  FileCompression compression;
+  if (!file_compression_parse(compression_value, &compression)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "compression must be 'none' or 'gzip'", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  const char* filename = fl_value_get_string(filename_value);
+
+  auto stream = std::make_shared<ReadStream>();
+  stream->id = fl_value_get_int(stream_id_value);
+  stream->chunk_size = kDefaultStreamChunkSize;
+
+  if (chunk_size_value != nullptr && fl_value_get_type(chunk_size_value) == FL_VALUE_TYPE_INT) {
+    stream->chunk_size = std::clamp<size_t>(fl_value_get_int(chunk_size_value),
+                                            kMinStreamChunkSize, kMaxStreamChunkSize);
+  }
+
+  if (offset_value != nullptr && fl_value_get_type(offset_value) == FL_VALUE_TYPE_INT) {
+    stream->offset = std::max<int64_t>(0, fl_value_get_int(offset_value));
+  }
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  bool not_found = false;
+  std::string error;
+  stream->fd = open_bookmarked_file(dir->fd, filename, &not_found, &error);
+  if (stream->fd < 0) {
+    if (not_found) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "FILE_NOT_FOUND", ("File '" + std::string(filename) + "' not found").c_str(),
+          nullptr));
+    }
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "PERMISSION_DENIED", ("Cannot read file: " + error).c_str(), nullptr));
+  }
+
+  // The decompressed size is only known at the end of the stream
+  struct stat st;
+  fstat(stream->fd, &st);
+  off_t size = st.st_size;
+  if (compression == kCompressionGzip) {
+    stream->decompressor = G_CONVERTER(g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+    size = std::numeric_limits<off_t>::max();
+  }
+
+  stream->end = size;
+  if (length_value != nullptr && fl_value_get_type(length_value) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(length_value) >= 0) {
+    stream->end = std::min<off_t>(size, stream->offset + fl_value_get_int(length_value));
+  }
+  stream->offset = std::min(stream->offset, stream->end);
+
+  if (!streams_add(self, stream)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "streamId is already in use", nullptr));
+  }
+
+  g_object_ref(self);
+  std::thread(read_stream_run, self, stream).detach();
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Method: cancelStream
+static FlMethodResponse* cancel_stream(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* stream_id_value = fl_value_lookup_string(args, "streamId");
+
+  if (stream_id_value == nullptr || fl_value_get_type(stream_id_value) != FL_VALUE_TYPE_INT) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "streamId must be an integer", nullptr));
+  }
+
+  std::shared_ptr<EventStream> stream;
+  {
+    std::lock_guard<std::mutex> lock(self->streams->mutex);
+    auto it = self->streams->active.find(fl_value_get_int(stream_id_value));
+    if (it == self->streams->active.end()) {
+      return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+    }
+    stream = it->second;
+  }
+
+  if (!stream->cancelled.exchange(true)) {
+    stream->on_cancel();
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Layout of the records returned by getdents64(2)
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+// Whether a directory entry counts as a file for listFiles: regular files,
+// including symlinks to them, that are not hidden. Only entries whose type
+// the filesystem did not report (or symlinks) cost an fstatat().
+static bool dirent_is_listed_file(int dir_fd, const LinuxDirent64* entry) {
+  if (entry->d_name[0] == '.') {
+    return false;
+  }
+
+  if (entry->d_type == DT_REG) {
+    return true;
+  }
+  if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK) {
+    return false;
+  }
+
+  struct stat st;
+  return fstatat(dir_fd, entry->d_name, &st, 0) == 0 && S_ISREG(st.st_mode);
+}
+
+// Page cursors are "<directory inode>:<getdents offset>" in hex. The offset
+// is the filesystem's own position cookie, so resuming is a single lseek()
+// and stays correct when entries are added or removed between pages.
+static std::string list_cursor_encode(ino_t dir_ino, int64_t offset) {
+  char buffer[40];
+  snprintf(buffer, sizeof(buffer), "%llx:%llx", static_cast<unsigned long long>(dir_ino),
+           static_cast<unsigned long long>(offset));
+  return buffer;
+}
+
+static bool list_cursor_decode(const char* cursor, ino_t* dir_ino, int64_t* offset) {
+  unsigned long long ino_part;
+  unsigned long long offset_part;
+  int consumed = 0;
+  if (sscanf(cursor, "%llx:%llx%n", &ino_part, &offset_part, &consumed) != 2 ||
+      cursor[consumed] != '\0') {
+    return false;
+  }
+
+  *dir_ino = static_cast<ino_t>(ino_part);
+  *offset = static_cast<int64_t>(offset_part);
+  return true;
+}
+
+// Open a bookmarked directory for a paged listing, positioned at `cursor`
+// (or the start). Returns an error response on failure.
+static FlMethodResponse* listing_open(const BookmarkDir& dir, FlValue* cursor_value,
+                                      int* out_fd, struct stat* out_st) {
+  int dir_fd = openat(dir.fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir_fd < 0 || fstat(dir_fd, out_st) != 0) {
+    int error = errno;
+    if (dir_fd >= 0) {
+      close(dir_fd);
+    }
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "READ_ERROR", strerror(error), nullptr));
+  }
+
+  if (cursor_value != nullptr && fl_value_get_type(cursor_value) == FL_VALUE_TYPE_STRING) {
+    ino_t cursor_ino;
+    int64_t offset;
+    if (!list_cursor_decode(fl_value_get_string(cursor_value), &cursor_ino, &offset) ||
+        cursor_ino != out_st->st_ino) {
+      close(dir_fd);
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "cursor does not belong to this directory", nullptr));
+    }
+    if (lseek(dir_fd, offset, SEEK_SET) < 0) {
+      int error = errno;
+      close(dir_fd);
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "READ_ERROR", strerror(error), nullptr));
+    }
+  }
+
+  *out_fd = dir_fd;
+  return nullptr;
+}
+
+// Read entries from the current position of `dir_fd`, handing each to `visit`
+// until it has accepted `limit` of them. `*more` is cleared once the end of
+// the directory is reached and `*resume` is the offset to continue from.
+// Returns false with errno set if reading fails.
+static bool dir_read_entries(int dir_fd, int64_t limit,
+                             const std::function<bool(const LinuxDirent64*)>& visit,
+                             bool* more, int64_t* resume) {
+  alignas(LinuxDirent64) char buffer[32 * 1024];
+  int64_t count = 0;
+  *more = true;
+
+  while (count < limit) {
+    long length = syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer));
+    if (length < 0) {
+      return false;
+    }
+    if (length == 0) {
+      *more = false;
+      break;
+    }
+
+    for (long pos = 0; pos < length && count < limit;) {
+      auto* entry = reinterpret_cast<LinuxDirent64*>(buffer + pos);
+      if (visit(entry)) {
+        count++;
+      }
+      // d_off is the position just past this entry
+      *resume = entry->d_off;
+      pos += entry->d_reclen;
+    }
+  }
+
+  return true;
+}
+
+// Validate the optional cursor and limit arguments shared by paged listings
+static FlMethodResponse* listing_parse_args(FlValue* args, FlValue** out_cursor,
+                                            int64_t* out_limit) {
+  FlValue* cursor_value = fl_value_lookup_string(args, "cursor");
+  FlValue* limit_value = fl_value_lookup_string(args, "limit");
+
+  if (cursor_value != nullptr && fl_value_get_type(cursor_value) != FL_VALUE_TYPE_NULL &&
+      fl_value_get_type(cursor_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "cursor must be a string", nullptr));
+  }
+  *out_cursor = cursor_value;
+
+  if (limit_value != nullptr && fl_value_get_type(limit_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(limit_value) != FL_VALUE_TYPE_INT || fl_value_get_int(limit_value) < 1) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "limit must be a positive integer", nullptr));
+    }
+    *out_limit = fl_value_get_int(limit_value);
+  }
+
+  return nullptr;
+}
+
+// Method: listFiles
+static FlMethodResponse* list_files(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  int dir_fd;
+  struct stat dir_st;
+  if (FlMethodResponse* error = listing_open(*dir, nullptr, &dir_fd, &dir_st)) {
+    return error;
+  }
+
+  // List regular files, skipping hidden ones
+  g_autoptr(FlValue) result = fl_value_new_list();
+  bool more;
+  int64_t resume;
+  bool ok = dir_read_entries(dir_fd, std::numeric_limits<int64_t>::max(),
+      [&](const LinuxDirent64* entry) {
+        if (!dirent_is_listed_file(dir_fd, entry)) {
+          return false;
+        }
+        fl_value_append_take(result, fl_value_new_string_safe(entry->d_name));
+        return true;
+      },
+      &more, &resume);
+  int saved_errno = errno;
+  close(dir_fd);
+
+  if (!ok) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "READ_ERROR", strerror(saved_errno), nullptr));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Method: listFilesPaged
+static FlMethodResponse* list_files_paged(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  FlValue* cursor_value = nullptr;
+  int64_t limit = 1000;
+  if (FlMethodResponse* error = listing_parse_args(args, &cursor_value, &limit)) {
+    return error;
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  int dir_fd;
+  struct stat dir_st;
+  if (FlMethodResponse* error = listing_open(*dir, cursor_value, &dir_fd, &dir_st)) {
+    return error;
+  }
+
+  g_autoptr(FlValue) files = fl_value_new_list();
+  bool more;
+  int64_t resume_offset = 0;
+  bool ok = dir_read_entries(dir_fd, limit, [&](const LinuxDirent64* entry) {
+    if (!dirent_is_listed_file(dir_fd, entry)) {
+      return false;
+    }
+    fl_value_append_take(files, fl_value_new_string_safe(entry->d_name));
+    return true;
+  }, &more, &resume_offset);
+  int error = errno;
+  close(dir_fd);
+
+  if (!ok) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "READ_ERROR", strerror(error), nullptr));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string(result, "files", files);
+  fl_value_set_string_take(result, "cursor",
+                           more ? fl_value_new_string(
+                                      list_cursor_encode(dir_st.st_ino, resume_offset).c_str())
+                                : fl_value_new_null());
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Entry types reported by listFilesDetailed
+enum DetailedEntryType : uint8_t {
+  kEntryUnknown = 0,
+  kEntryFile = 1,
+  kEntryDirectory = 2,
+  kEntryLink = 3,
+  kEntryOther = 4,
+};
+
+// Directories with more entries than this are stat'ed from several threads
+static const size_t kParallelStatThreshold = 2048;
+
+// Fill in size, mtime, mode and type of entries [begin, end) with statx.
+//
+// Only the fields we return are requested, and AT_STATX_DONT_SYNC keeps
+// network filesystems from revalidating each one. Symlinks are followed like
+// listFiles does; a dangling one is reported as a link.
+static void stat_entries(int dir_fd, const std::vector<std::string>& names, size_t begin,
+                         size_t end, int64_t* sizes, int64_t* mtimes, int32_t* modes,
+                         uint8_t* types) {
+  const unsigned int mask = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME;
+
+  for (size_t i = begin; i < end; i++) {
+    struct statx stx;
+    if (statx(dir_fd, names[i].c_str(), AT_STATX_DONT_SYNC, mask, &stx) != 0 &&
+        statx(dir_fd, names[i].c_str(), AT_STATX_DONT_SYNC | AT_SYMLINK_NOFOLLOW, mask,
+              &stx) != 0) {
+      sizes[i] = 0;
+      mtimes[i] = 0;
+      modes[i] = 0;
+      types[i] = kEntryUnknown;
+      continue;
+    }
+
+    sizes[i] = static_cast<int64_t>(stx.stx_size);
+    mtimes[i] = stx.stx_mtime.tv_sec * 1000000LL + stx.stx_mtime.tv_nsec / 1000;
+    modes[i] = stx.stx_mode & 07777;
+    types[i] = S_ISREG(stx.stx_mode)   ? kEntryFile
+               : S_ISDIR(stx.stx_mode) ? kEntryDirectory
+               : S_ISLNK(stx.stx_mode) ? kEntryLink
+                                       : kEntryOther;
+  }
+}
+
+// Method: listFilesDetailed
+static FlMethodResponse* list_files_detailed(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* hidden_value = fl_value_lookup_string(args, "includeHidden");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  FlValue* cursor_value = nullptr;
+  int64_t limit = std::numeric_limits<int64_t>::max();
+  if (FlMethodResponse* error = listing_parse_args(args, &cursor_value, &limit)) {
+    return error;
+  }
+
+  bool include_hidden = hidden_value != nullptr &&
+                        fl_value_get_type(hidden_value) == FL_VALUE_TYPE_BOOL &&
+                        fl_value_get_bool(hidden_value);
+  const char* identifier = fl_value_get_string(identifier_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  int dir_fd;
+  struct stat dir_st;
+  if (FlMethodResponse* error = listing_open(*dir, cursor_value, &dir_fd, &dir_st)) {
+    return error;
+  }
+
+  std::vector<std::string> names;
+  bool more;
+  int64_t resume_offset = 0;
+  bool ok = dir_read_entries(dir_fd, limit, [&](const LinuxDirent64* entry) {
+    const char* name = entry->d_name;
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 ||
+        (name[0] == '.' && !include_hidden)) {
+      return false;
+    }
+    names.emplace_back(name);
+    return true;
+  }, &more, &resume_offset);
+
+  if (!ok) {
+    int error = errno;
+    close(dir_fd);
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "READ_ERROR", strerror(error), nullptr));
+  }
+
+  size_t count = names.size();
+  std::vector<int64_t> sizes(count);
+  std::vector<int64_t> mtimes(count);
+  std::vector<int32_t> modes(count);
+  std::vector<uint8_t> types(count);
+
+  size_t threads = 1;
+  if (count > kParallelStatThreshold) {
+    threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), 8);
+    threads = std::min(threads, count / (kParallelStatThreshold / 2));
+  }
+
+  if (threads <= 1) {
+    stat_entries(dir_fd, names, 0, count, sizes.data(), mtimes.data(), modes.data(),
+                 types.data());
+  } else {
+    std::vector<std::thread> workers;
+    size_t slice = (count + threads - 1) / threads;
+    for (size_t begin = 0; begin < count; begin += slice) {
+      size_t end = std::min(count, begin + slice);
+      workers.emplace_back(stat_entries, dir_fd, std::cref(names), begin, end, sizes.data(),
+                           mtimes.data(), modes.data(), types.data());
+    }
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+  }
+  close(dir_fd);
+
+  g_autoptr(FlValue) name_list = fl_value_new_list();
+  for (const std::string& name : names) {
+    fl_value_append_take(name_list, fl_value_new_string_safe(name));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string(result, "names", name_list);
+  fl_value_set_string_take(result, "sizes", fl_value_new_int64_list(sizes.data(), count));
+  fl_value_set_string_take(result, "modifiedMicros", fl_value_new_int64_list(mtimes.data(), count));
+  fl_value_set_string_take(result, "modes", fl_value_new_int32_list(modes.data(), count));
+  fl_value_set_string_take(result, "types", fl_value_new_uint8_list(types.data(), count));
+  fl_value_set_string_take(result, "cursor",
+                           more ? fl_value_new_string(
+                                      list_cursor_encode(dir_st.st_ino, resume_offset).c_str())
+                                : fl_value_new_null());
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Match `path` against a glob: `*` and `?` stay within one path component,
+// `[...]` is a character class (`!` or `^` negates) and `**` spans
+// components, so `**/` also matches no directory at all.
+static bool glob_match(const char* pattern, const char* path) {
+  while (*pattern != '\0') {
+    if (pattern[0] == '*' && pattern[1] == '*') {
+      const char* rest = pattern + 2;
+      if (*rest == '/') {
+        rest++;
+        for (const char* s = path;;) {
+          if (glob_match(rest, s)) {
+            return true;
+          }
+          s = strchr(s, '/');
+          if (s == nullptr) {
+            return false;
+          }
+          s++;
+        }
+      }
+      for (const char* s = path;; s++) {
+        if (glob_match(rest, s)) {
+          return true;
+        }
+        if (*s == '\0') {
+          return false;
+        }
+      }
+    }
+
+    if (*pattern == '*') {
+      for (const char* s = path;; s++) {
+        if (glob_match(pattern + 1, s)) {
+          return true;
+        }
+        if (*s == '\0' || *s == '/') {
+          return false;
+        }
+      }
+    }
+
+    if (*path == '\0') {
+      return false;
+    }
+
+    if (*pattern == '?') {
+      if (*path == '/') {
+        return false;
+      }
+      pattern++;
+      path++;
+      continue;
+    }
+
+    if (*pattern == '[') {
+      const char* p = pattern + 1;
+      bool negate = *p == '!' || *p == '^';
+      if (negate) {
+        p++;
+      }
+
+      bool matched = false;
+      bool first = true;
+      unsigned char c = *path;
+      while (*p != '\0' && (*p != ']' || first)) {
+        unsigned char low = *p;
+        unsigned char high = low;
+        if (p[1] == '-' && p[2] != '\0' && p[2] != ']') {
+          high = p[2];
+          p += 3;
+        } else {
+          p++;
+        }
+        matched = matched || (c >= low && c <= high);
+        first = false;
+      }
+
+      // An unterminated class is just a literal '['
+      if (*p == ']') {
+        if (matched == negate || c == '/') {
+          return false;
+        }
+        pattern = p + 1;
+        path++;
+        continue;
+      }
+    }
+
+    if (*pattern == '\\' && pattern[1] != '\0') {
+      pattern++;
+    }
+    if (*pattern != *path) {
+      return false;
+    }
+    pattern++;
+    path++;
+  }
+
+  return *path == '\0';
+}
+
+// A directory waiting to be read, relative to the walk root
+struct WalkDir {
+  std::string relative;
+  int depth = 0;
+};
+
+// One worker's share of the walk. Workers pop their own queue from the back
+// (depth first, good locality) and steal from the front of others' (the
+// oldest, usually largest, subtrees) when they run dry.
+struct WalkQueue {
+  std::mutex mutex;
+  std::deque<WalkDir> dirs;
+};
+
+struct WalkStream : EventStream {
+  std::string root;
+  std::string pattern;
+  bool match_path = false;
+  int max_depth = -1;
+  bool include_hidden = false;
+  bool follow_links = false;
+  size_t batch_size = 0;
+
+  std::vector<std::unique_ptr<WalkQueue>> queues;
+  // Directories queued or being read; the walk is over when it drops to 0
+  std::atomic<size_t> pending{0};
+  std::atomic<int64_t> matched{0};
+  std::atomic<int64_t> skipped{0};
+
+  // Every directory entered, by device and inode, so symlink or bind mount
+  // cycles are only ever walked once
+  std::mutex visited_mutex;
+  std::set<std::pair<dev_t, ino_t>> visited;
+
+  // Bound on batches queued for the main context, for backpressure
+  std::mutex mutex;
+  std::condition_variable sent_cond;
+  int batches_in_flight = 0;
+};
+
+static constexpr size_t kDefaultWalkBatchSize = 512;
+static constexpr int kMaxWalkBatchesInFlight = 4;
+
+static void walk_push(WalkStream* stream, size_t worker, WalkDir dir) {
+  stream->pending++;
+  WalkQueue* queue = stream->queues[worker].get();
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  queue->dirs.push_back(std::move(dir));
+}
+
+static bool walk_take(WalkStream* stream, size_t worker, WalkDir& out) {
+  {
+    WalkQueue* own = stream->queues[worker].get();
+    std::lock_guard<std::mutex> lock(own->mutex);
+    if (!own->dirs.empty()) {
+      out = std::move(own->dirs.back());
+      own->dirs.pop_back();
+      return true;
+    }
+  }
+
+  for (size_t i = 1; i < stream->queues.size(); i++) {
+    WalkQueue* victim = stream->queues[(worker + i) % stream->queues.size()].get();
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    if (!victim->dirs.empty()) {
+      out = std::move(victim->dirs.front());
+      victim->dirs.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Hand a batch of matches to the main context, waiting while too many are queued
+static void walk_send_batch(DirectoryBookmarksPlugin* self, const std::shared_ptr<WalkStream>& stream,
+                            std::vector<std::string>& paths) {
+  if (paths.empty()) {
+    return;
+  }
+
+  FlValue* event = stream_event_new(*stream, "batch");
+  g_autoptr(FlValue) list = fl_value_new_list();
+  for (const std::string& path : paths) {
+    fl_value_append_take(list, fl_value_new_string_safe(path));
+  }
+  fl_value_set_string(event, "paths", list);
+  paths.clear();
+
+  {
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    stream->sent_cond.wait(lock, [&stream]() {
+      return stream->batches_in_flight < kMaxWalkBatchesInFlight;
+    });
+    stream->batches_in_flight++;
+  }
+
+  events_post(self, event, [stream]() {
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    stream->batches_in_flight--;
+    stream->sent_cond.notify_all();
+  });
+}
+
+// Read one directory, queueing its subdirectories and collecting matches
+static void walk_directory(WalkStream* stream, size_t worker, const WalkDir& dir,
+                           std::vector<std::string>& matches) {
+  std::string path = dir.relative.empty() ? stream->root : stream->root + "/" + dir.relative;
+  int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | (stream->follow_links ? 0 : O_NOFOLLOW);
+  int dir_fd = open(path.c_str(), flags);
+  struct stat dir_st;
+  if (dir_fd < 0 || fstat(dir_fd, &dir_st) != 0) {
+    if (dir_fd >= 0) {
+      close(dir_fd);
+    }
+    stream->skipped++;
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(stream->visited_mutex);
+    if (!stream->visited.emplace(dir_st.st_dev, dir_st.st_ino).second) {
+      close(dir_fd);
+      return;
+    }
+  }
+
+  bool more;
+  int64_t resume;
+  bool ok = dir_read_entries(dir_fd, std::numeric_limits<int64_t>::max(),
+                             [&](const LinuxDirent64* entry) {
+    const char* name = entry->d_name;
+    if (stream->cancelled || strcmp(name, ".") == 0 || strcmp(name, "..") == 0 ||
+        (name[0] == '.' && !stream->include_hidden)) {
+      return false;
+    }
+
+    unsigned char type = entry->d_type;
+    struct stat st;
+    if (type == DT_UNKNOWN) {
+      if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return false;
+      }
+      type = S_ISDIR(st.st_mode) ? DT_DIR
+             : S_ISREG(st.st_mode) ? DT_REG
+             : S_ISLNK(st.st_mode) ? DT_LNK
+                                   : DT_UNKNOWN;
+    }
+    if (type == DT_LNK) {
+      // Links to files are reported; links to directories only followed on request
+      if (fstatat(dir_fd, name, &st, 0) != 0) {
+        return false;
+      }
+      type = S_ISREG(st.st_mode) ? DT_REG
+             : S_ISDIR(st.st_mode) && stream->follow_links ? DT_DIR
+                                                          : DT_UNKNOWN;
+    }
+
+    std::string relative = dir.relative.empty() ? name : dir.relative + "/" + name;
+    if (type == DT_DIR) {
+      if (stream->max_depth < 0 || dir.depth < stream->max_depth) {
+        walk_push(stream, worker, {std::move(relative), dir.depth + 1});
+      }
+    } else if (type == DT_REG) {
+      if (stream->pattern.empty() ||
+          glob_match(stream->pattern.c_str(), stream->match_path ? relative.c_str() : name)) {
+        matches.push_back(std::move(relative));
+      }
+    }
+    return false;
+  }, &more, &resume);
+  close(dir_fd);
+
+  if (!ok) {
+    stream->skipped++;
+  }
+}
+
+static void walk_worker(DirectoryBookmarksPlugin* self, std::shared_ptr<WalkStream> stream,
+                        size_t worker) {
+  std::vector<std::string> matches;
+  WalkDir dir;
+
+  while (!stream->cancelled) {
+    if (!walk_take(stream.get(), worker, dir)) {
+      if (stream->pending == 0) {
+        break;
+      }
+      // Someone is still reading a directory that may yield more work
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+
+    size_t before = matches.size();
+    walk_directory(stream.get(), worker, dir, matches);
+    stream->matched += matches.size() - before;
+    stream->pending--;
+
+    if (matches.size() >= stream->batch_size) {
+      walk_send_batch(self, stream, matches);
+    }
+  }
+
+  if (!stream->cancelled) {
+    walk_send_batch(self, stream, matches);
+  }
+}
+
+static void walk_stream_run(DirectoryBookmarksPlugin* self, std::shared_ptr<WalkStream> stream) {
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < stream->queues.size(); i++) {
+    workers.emplace_back(walk_worker, self, stream, i);
+  }
+  walk_worker(self, stream, 0);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  FlValue* event = stream_event_new(*stream, "done");
+  fl_value_set_string_take(event, "matched", fl_value_new_int(stream->matched));
+  fl_value_set_string_take(event, "skipped", fl_value_new_int(stream->skipped));
+  events_post(self, event);
+
+  streams_remove(self, stream->id);
+  object_unref_on_main(self);
+}
+
+// Method: startWalk
+static FlMethodResponse* start_walk(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* stream_id_value = fl_value_lookup_string(args, "streamId");
+  FlValue* pattern_value = fl_value_lookup_string(args, "pattern");
+  FlValue* max_depth_value = fl_value_lookup_string(args, "maxDepth");
+  FlValue* hidden_value = fl_value_lookup_string(args, "includeHidden");
+  FlValue* follow_value = fl_value_lookup_string(args, "followLinks");
+  FlValue* batch_size_value = fl_value_lookup_string(args, "batchSize");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (stream_id_value == nullptr || fl_value_get_type(stream_id_value) != FL_VALUE_TYPE_INT) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "streamId must be an integer", nullptr));
+  }
+
+  if (pattern_value != nullptr && fl_value_get_type(pattern_value) != FL_VALUE_TYPE_NULL &&
+      fl_value_get_type(pattern_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "pattern must be a string", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+
+  auto stream = std::make_shared<WalkStream>();
+  stream->id = fl_value_get_int(stream_id_value);
+  stream->batch_size = kDefaultWalkBatchSize;
+
+  if (pattern_value != nullptr && fl_value_get_type(pattern_value) == FL_VALUE_TYPE_STRING) {
+    stream->pattern = fl_value_get_string(pattern_value);
+    // Patterns naming directories match the relative path, others the file name
+    stream->match_path = stream->pattern.find('/') != std::string::npos;
+  }
+  if (max_depth_value != nullptr && fl_value_get_type(max_depth_value) == FL_VALUE_TYPE_INT) {
+    stream->max_depth = std::max<int64_t>(0, fl_value_get_int(max_depth_value));
+  }
+  stream->include_hidden = hidden_value != nullptr &&
+                           fl_value_get_type(hidden_value) == FL_VALUE_TYPE_BOOL &&
+                           fl_value_get_bool(hidden_value);
+  stream->follow_links = follow_value != nullptr &&
+                         fl_value_get_type(follow_value) == FL_VALUE_TYPE_BOOL &&
+                         fl_value_get_bool(follow_value);
+  if (batch_size_value != nullptr && fl_value_get_type(batch_size_value) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(batch_size_value) > 0) {
+    stream->batch_size = fl_value_get_int(batch_size_value);
+  }
+
+  // Get bookmarked directory
+  if (!get_bookmarked_path(self, identifier, stream->root)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "BOOKMARK_NOT_FOUND",
+        ("Bookmark with identifier '" + std::string(identifier) + "' not found").c_str(),
+        nullptr));
+  }
+
+  size_t threads = CLAMP(std::thread::hardware_concurrency(), 2u, 8u);
+  for (size_t i = 0; i < threads; i++) {
+    stream->queues.push_back(std::make_unique<WalkQueue>());
+  }
+  walk_push(stream.get(), 0, {"", 0});
+
+  if (!streams_add(self, stream)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "streamId is already in use", nullptr));
+  }
+
+  g_object_ref(self);
+  std::thread(walk_stream_run, self, stream).detach();
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Substring query for searchFiles. Case-insensitive queries are folded to
+// ASCII lower case; other bytes, including all of UTF-8 beyond ASCII, must
+// match exactly.
+struct SearchQuery {
+  std::string bytes;
+  bool fold = false;
+  // Both spellings of the first and last byte, for the vector filter
+  uint8_t first[2] = {0, 0};
+  uint8_t last[2] = {0, 0};
+};
+
+static uint8_t ascii_lower(uint8_t c) {
+  return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+static uint8_t ascii_upper(uint8_t c) {
+  return c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c;
+}
+
+static SearchQuery search_query_new(const std::string& text, bool fold) {
+  SearchQuery query;
+  query.bytes = text;
+  query.fold = fold;
+  if (fold) {
+    for (char& c : query.bytes) {
+      c = ascii_lower(c);
+    }
+  }
+
+  uint8_t first = query.bytes.front();
+  uint8_t last = query.bytes.back();
+  query.first[0] = first;
+  query.first[1] = fold ? ascii_upper(first) : first;
+  query.last[0] = last;
+  query.last[1] = fold ? ascii_upper(last) : last;
+  return query;
+}
+
+// Whether the query occurs at `data`, which has at least its length available
+static bool search_verify(const SearchQuery& query, const uint8_t* data) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(query.bytes.data());
+  size_t length = query.bytes.size();
+  if (!query.fold) {
+    return memcmp(data, bytes, length) == 0;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (ascii_lower(data[i]) != bytes[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static size_t search_find_portable(const SearchQuery& query, const uint8_t* data, size_t length,
+                                   size_t from) {
+  size_t n = query.bytes.size();
+  for (size_t i = from; i + n <= length; i++) {
+    if ((data[i] == query.first[0] || data[i] == query.first[1]) && search_verify(query, data + i)) {
+      return i;
+    }
+  }
+  return std::string::npos;
+}
+
+// The vector searches compare a block of candidate positions against the
+// query's first and last byte at once and only verify positions where both
+// agree, which rejects nearly all of them without a byte-by-byte loop. What
+// is left past the last full block goes to the portable loop.
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+static size_t search_find_avx2(const SearchQuery& query, const uint8_t* data, size_t length,
+                               size_t from) {
+  size_t n = query.bytes.size();
+  const __m256i first0 = _mm256_set1_epi8(static_cast<char>(query.first[0]));
+  const __m256i first1 = _mm256_set1_epi8(static_cast<char>(query.first[1]));
+  const __m256i last0 = _mm256_set1_epi8(static_cast<char>(query.last[0]));
+  const __m256i last1 = _mm256_set1_epi8(static_cast<char>(query.last[1]));
+
+  size_t i = from;
+  for (; i + n - 1 + 32 <= length; i += 32) {
+    __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + n - 1));
+    __m256i hits = _mm256_and_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(head, first0), _mm256_cmpeq_epi8(head, first1)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(tail, last0), _mm256_cmpeq_epi8(tail, last1)));
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+    while (mask != 0) {
+      size_t candidate = i + __builtin_ctz(mask);
+      if (search_verify(query, data + candidate)) {
+        return candidate;
+      }
+      mask &= mask - 1;
+    }
+  }
+
+  return search_find_portable(query, data, length, i);
+}
+
+static size_t search_find_sse2(const SearchQuery& query, const uint8_t* data, size_t length,
+                               size_t from) {
+  size_t n = query.bytes.size();
+  const __m128i first0 = _mm_set1_epi8(static_cast<char>(query.first[0]));
+  const __m128i first1 = _mm_set1_epi8(static_cast<char>(query.first[1]));
+  const __m128i last0 = _mm_set1_epi8(static_cast<char>(query.last[0]));
+  const __m128i last1 = _mm_set1_epi8(static_cast<char>(query.last[1]));
+
+  size_t i = from;
+  for (; i + n - 1 + 16 <= length; i += 16) {
+    __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + n - 1));
+    __m128i hits = _mm_and_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(head, first0), _mm_cmpeq_epi8(head, first1)),
+        _mm_or_si128(_mm_cmpeq_epi8(tail, last0), _mm_cmpeq_epi8(tail, last1)));
+    uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+    while (mask != 0) {
+      size_t candidate = i + __builtin_ctz(mask);
+      if (search_verify(query, data + candidate)) {
+        return candidate;
+      }
+      mask &= mask - 1;
+    }
+  }
+
+  return search_find_portable(query, data, length, i);
+}
+#elif defined(__aarch64__)
+static size_t search_find_neon(const SearchQuery& query, const uint8_t* data, size_t length,
+                               size_t from) {
+  size_t n = query.bytes.size();
+  const uint8x16_t first0 = vdupq_n_u8(query.first[0]);
+  const uint8x16_t first1 = vdupq_n_u8(query.first[1]);
+  const uint8x16_t last0 = vdupq_n_u8(query.last[0]);
+  const uint8x16_t last1 = vdupq_n_u8(query.last[1]);
+
+  size_t i = from;
+  for (; i + n - 1 + 16 <= length; i += 16) {
+    uint8x16_t head = vld1q_u8(data + i);
+    uint8x16_t tail = vld1q_u8(data + i + n - 1);
+    uint8x16_t hits = vandq_u8(vorrq_u8(vceqq_u8(head, first0), vceqq_u8(head, first1)),
+                               vorrq_u8(vceqq_u8(tail, last0), vceqq_u8(tail, last1)));
+    // Narrow to four bits per lane, there is no byte movemask on NEON
+    uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+    while (mask != 0) {
+      size_t candidate = i + (__builtin_ctzll(mask) >> 2);
+      if (search_verify(query, data + candidate)) {
+        return candidate;
+      }
+      mask &= ~(0xfULL << (__builtin_ctzll(mask) & ~3));
+    }
+  }
+
+  return search_find_portable(query, data, length, i);
+}
+#endif
+
+// First occurrence of the query in data[from, length), or npos
+static size_t search_find(const SearchQuery& query, const uint8_t* data, size_t length,
+                          size_t from) {
+#if defined(__x86_64__)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2 ? search_find_avx2(query, data, length, from)
+                  : search_find_sse2(query, data, length, from);
+#elif defined(__aarch64__)
+  return search_find_neon(query, data, length, from);
+#else
+  return search_find_portable(query, data, length, from);
+#endif
+}
+
+// Replace bytes that are not part of a well-formed UTF-8 sequence, so a
+// snippet cut mid-character or taken from a non-UTF-8 file still encodes
+static void utf8_sanitize(std::string& text) {
+  size_t i = 0;
+  while (i < text.size()) {
+    uint8_t c = text[i];
+    size_t length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xe ? 3 : (c >> 3) == 0x1e ? 4 : 0;
+    bool valid = length > 0 && i + length <= text.size();
+    for (size_t j = 1; valid && j < length; j++) {
+      valid = (static_cast<uint8_t>(text[i + j]) >> 6) == 0x2;
+    }
+    if (!valid) {
+      text[i] = '?';
+      length = 1;
+    }
+    i += length;
+  }
+}
+
+// One occurrence found by searchFiles
+struct SearchMatch {
+  std::string path;
+  int64_t offset = 0;
+  int64_t line = 0;
+  std::string snippet;
+};
+
+struct SearchStream : EventStream {
+  // Everything is opened relative to the bookmark's fd, never by path
+  std::shared_ptr<BookmarkDir> dir;
+  SearchQuery query;
+  bool recursive = false;
+  bool include_hidden = false;
+  int64_t max_results = 0;  // 0 for no limit
+  size_t batch_size = 0;
+
+  // Files listed but not yet searched, filled by the lister while the
+  // workers drain it
+  std::mutex files_mutex;
+  std::condition_variable files_cond;
+  std::deque<std::string> files;
+  bool listed = false;
+
+  std::atomic<int64_t> matched{0};
+  std::atomic<int64_t> searched{0};
+  std::atomic<int64_t> skipped{0};
+  // Set once max_results matches have been claimed
+  std::atomic<bool> full{false};
+
+  // Bound on batches queued for the main context, for backpressure
+  std::mutex mutex;
+  std::condition_variable sent_cond;
+  int batches_in_flight = 0;
+
+  bool stopped() const { return cancelled || full; }
+};
+
+static constexpr size_t kDefaultSearchBatchSize = 256;
+static constexpr int kMaxSearchBatchesInFlight = 4;
+static constexpr size_t kMaxSearchFilesQueued = 4096;
+static constexpr size_t kSearchChunkSize = 1 << 20;
+// Most context kept on each side of a match in its snippet
+static constexpr size_t kSearchSnippetContext = 80;
+// Files with a NUL byte in their first block are treated as binary and skipped
+static constexpr size_t kSearchBinaryProbe = 8192;
+
+// Hand a batch of matches to the main context, waiting while too many are queued
+static void search_send_batch(DirectoryBookmarksPlugin* self,
+                              const std::shared_ptr<SearchStream>& stream,
+                              std::vector<SearchMatch>& matches) {
+  if (matches.empty()) {
+    return;
+  }
+
+  // Parallel arrays, one slot per match, like listFilesDetailed
+  std::vector<int64_t> offsets;
+  std::vector<int64_t> lines;
+  g_autoptr(FlValue) paths = fl_value_new_list();
+  g_autoptr(FlValue) snippets = fl_value_new_list();
+  for (const SearchMatch& match : matches) {
+    fl_value_append_take(paths, fl_value_new_string_safe(match.path));
+    fl_value_append_take(snippets, fl_value_new_string_safe(match.snippet));
+    offsets.push_back(match.offset);
+    lines.push_back(match.line);
+  }
+
+  FlValue* event = stream_event_new(*stream, "batch");
+  fl_value_set_string(event, "paths", paths);
+  fl_value_set_string_take(event, "offsets", fl_value_new_int64_list(offsets.data(), offsets.size()));
+  fl_value_set_string_take(event, "lines", fl_value_new_int64_list(lines.data(), lines.size()));
+  fl_value_set_string(event, "snippets", snippets);
+  matches.clear();
+
+  {
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    stream->sent_cond.wait(lock, [&stream]() {
+      return stream->batches_in_flight < kMaxSearchBatchesInFlight;
+    });
+    stream->batches_in_flight++;
+  }
+
+  events_post(self, event, [stream]() {
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    stream->batches_in_flight--;
+    stream->sent_cond.notify_all();
+  });
+}
+
+// Claim a result slot, or stop the search once max_results is reached
+static bool search_claim(SearchStream* stream) {
+  if (stream->max_results == 0) {
+    stream->matched++;
+    return true;
+  }
+  if (stream->matched.fetch_add(1) < stream->max_results) {
+    if (stream->matched >= stream->max_results) {
+      stream->full = true;
+    }
+    return true;
+  }
+  stream->matched--;
+  stream->full = true;
+  return false;
+}
+
+// Search one file in chunks, collecting its matches.
+//
+// Files are read with pread rather than mapped: a file truncated while it
+// is mapped raises SIGBUS, which would take the whole app down for what is
+// just a stale search result. Each chunk keeps enough of the previous one
+// that matches and their snippets spanning the boundary are still found.
+static void search_file(SearchStream* stream, const std::string& relative,
+                        std::vector<uint8_t>& buffer, std::vector<SearchMatch>& matches) {
+  int fd = openat(stream->dir->fd, relative.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    stream->skipped++;
+    return;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  const SearchQuery& query = stream->query;
+  size_t n = query.bytes.size();
+  size_t keep_after = n - 1 + kSearchSnippetContext;
+  buffer.resize(kSearchChunkSize + keep_after + kSearchSnippetContext);
+
+  const uint8_t* data = buffer.data();
+  size_t length = 0;     // bytes in the buffer
+  off_t base = 0;        // file offset of buffer[0]
+  size_t scan = 0;       // next buffer position a match may start at
+  size_t line_pos = 0;   // buffer position `line` is counted up to
+  int64_t line = 1;
+  bool eof = false;
+  bool first = true;
+
+  while (!eof && !stream->stopped()) {
+    ssize_t got = pread_full(fd, buffer.data() + length, buffer.size() - length,
+                             base + static_cast<off_t>(length));
+    if (got < 0) {
+      stream->skipped++;
+      break;
+    }
+    eof = static_cast<size_t>(got) < buffer.size() - length;
+    length += got;
+
+    if (first) {
+      first = false;
+      if (memchr(data, 0, std::min(length, kSearchBinaryProbe)) != nullptr) {
+        stream->skipped++;
+        break;
+      }
+      stream->searched++;
+    }
+
+    // Matches starting before `limit` have their whole snippet in the buffer
+    size_t limit = eof ? length : length > keep_after ? length - keep_after : 0;
+    while (scan < limit && !stream->stopped()) {
+      size_t found = search_find(query, data, std::min(length, limit + n - 1), scan);
+      if (found == std::string::npos || found >= limit) {
+        break;
+      }
+
+      for (const uint8_t* p = data + line_pos;
+           (p = static_cast<const uint8_t*>(memchr(p, '\n', data + found - p))) != nullptr; p++) {
+        line++;
+      }
+      line_pos = found;
+
+      if (!search_claim(stream)) {
+        break;
+      }
+
+      // The match's line, clipped to kSearchSnippetContext on either side
+      size_t start = found > kSearchSnippetContext ? found - kSearchSnippetContext : 0;
+      for (size_t i = found; i > start; i--) {
+        if (data[i - 1] == '\n') {
+          start = i;
+          break;
+        }
+      }
+      size_t end = std::min(length, found + n + kSearchSnippetContext);
+      const void* newline = memchr(data + found + n, '\n', end - (found + n));
+      if (newline != nullptr) {
+        end = static_cast<const uint8_t*>(newline) - data;
+      }
+      if (end > found + n && data[end - 1] == '\r') {
+        end--;
+      }
+
+      SearchMatch match;
+      match.path = relative;
+      match.offset = base + static_cast<off_t>(found);
+      match.line = line;
+      match.snippet.assign(reinterpret_cast<const char*>(data + start), end - start);
+      utf8_sanitize(match.snippet);
+      matches.push_back(std::move(match));
+
+      scan = found + n;
+    }
+    if (eof) {
+      break;
+    }
+
+    // Slide the window, keeping the context later matches may need
+    scan = std::max(scan, limit);
+    for (const uint8_t* p = data + line_pos;
+         (p = static_cast<const uint8_t*>(memchr(p, '\n', data + scan - p))) != nullptr; p++) {
+      line++;
+    }
+    line_pos = scan;
+    size_t keep = scan > kSearchSnippetContext ? scan - kSearchSnippetContext : 0;
+    memmove(buffer.data(), data + keep, length - keep);
+    length -= keep;
+    base += keep;
+    scan -= keep;
+    line_pos -= keep;
+  }
+
+  close(fd);
+}
+
+// List the files to search, depth first, handing them to the workers as it goes
+static void search_list(SearchStream* stream) {
+  std::vector<std::string> pending = {""};
+  std::set<std::pair<dev_t, ino_t>> visited;
+
+  while (!pending.empty() && !stream->stopped()) {
+    std::string relative = std::move(pending.back());
+    pending.pop_back();
+
+    // The bookmark's own fd already resolved it; nothing below it is followed
+    int dir_fd = openat(stream->dir->fd, relative.empty() ? "." : relative.c_str(),
+                        O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+    struct stat dir_st;
+    if (dir_fd < 0 || fstat(dir_fd, &dir_st) != 0 ||
+        !visited.emplace(dir_st.st_dev, dir_st.st_ino).second) {
+      if (dir_fd >= 0) {
+        close(dir_fd);
+      }
+      continue;
+    }
+
+    std::vector<std::string> files;
+    bool more;
+    int64_t resume;
+    dir_read_entries(dir_fd, std::numeric_limits<int64_t>::max(),
+                     [&](const LinuxDirent64* entry) {
+      const char* name = entry->d_name;
+      if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 ||
+          (name[0] == '.' && !stream->include_hidden)) {
+        return false;
+      }
+
+      // Links are never followed, to files or directories
+      unsigned char type = entry->d_type;
+      struct stat st;
+      if (type == DT_UNKNOWN) {
+        if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+          return false;
+        }
+        type = S_ISREG(st.st_mode) ? DT_REG : S_ISDIR(st.st_mode) ? DT_DIR : DT_UNKNOWN;
+      }
+
+      std::string child = relative.empty() ? name : relative + "/" + name;
+      if (type == DT_DIR && stream->recursive) {
+        pending.push_back(std::move(child));
+      } else if (type == DT_REG) {
+        files.push_back(std::move(child));
+      }
+      return false;
+    }, &more, &resume);
+    close(dir_fd);
+
+    for (std::string& file : files) {
+      std::unique_lock<std::mutex> lock(stream->files_mutex);
+      while (!stream->files_cond.wait_for(lock, std::chrono::milliseconds(50), [stream]() {
+        return stream->files.size() < kMaxSearchFilesQueued || stream->stopped();
+      })) {
+      }
+      if (stream->stopped()) {
+        break;
+      }
+      stream->files.push_back(std::move(file));
+      stream->files_cond.notify_all();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(stream->files_mutex);
+  stream->listed = true;
+  stream->files_cond.notify_all();
+}
+
+static void search_worker(DirectoryBookmarksPlugin* self, std::shared_ptr<SearchStream> stream) {
+  std::vector<uint8_t> buffer;
+  std::vector<SearchMatch> matches;
+
+  while (!stream->stopped()) {
+    std::string file;
+    {
+      std::unique_lock<std::mutex> lock(stream->files_mutex);
+      // Waits are bounded so a cancelled or full search is noticed without a wakeup
+      stream->files_cond.wait_for(lock, std::chrono::milliseconds(50), [&stream]() {
+        return !stream->files.empty() || stream->listed || stream->stopped();
+      });
+      if (stream->files.empty()) {
+        if (stream->listed) {
+          break;
+        }
+        continue;
+      }
+      file = std::move(stream->files.front());
+      stream->files.pop_front();
+      stream->files_cond.notify_all();
+    }
+
+    search_file(stream.get(), file, buffer, matches);
+    if (matches.size() >= stream->batch_size) {
+      search_send_batch(self, stream, matches);
+    }
+  }
+
+  if (!stream->cancelled) {
+    search_send_batch(self, stream, matches);
+  }
+}
+
+static void search_stream_run(DirectoryBookmarksPlugin* self, std::shared_ptr<SearchStream> stream) {
+  std::vector<std::thread> workers;
+  size_t threads = CLAMP(std::thread::hardware_concurrency(), 2u, 8u);
+  for (size_t i = 0; i < threads; i++) {
+    workers.emplace_back(search_worker, self, stream);
+  }
+  search_list(stream.get());
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  FlValue* event = stream_event_new(*stream, "done");
+  fl_value_set_string_take(event, "matched", fl_value_new_int(stream->matched));
+  fl_value_set_string_take(event, "searched", fl_value_new_int(stream->searched));
+  fl_value_set_string_take(event, "skipped", fl_value_new_int(stream->skipped));
+  fl_value_set_string_take(event, "truncated", fl_value_new_bool(stream->full));
+  events_post(self, event);
+
+  streams_remove(self, stream->id);
+  object_unref_on_main(self);
+}
+
+// Method: startSearch
+static FlMethodResponse* start_search(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* stream_id_value = fl_value_lookup_string(args, "streamId");
+  FlValue* query_value = fl_value_lookup_string(args, "query");
+  FlValue* recursive_value = fl_value_lookup_string(args, "recursive");
+  FlValue* max_results_value = fl_value_lookup_string(args, "maxResults");
+  FlValue* case_value = fl_value_lookup_string(args, "caseInsensitive");
+  FlValue* hidden_value = fl_value_lookup_string(args, "includeHidden");
+  FlValue* batch_size_value = fl_value_lookup_string(args, "batchSize");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (stream_id_value == nullptr || fl_value_get_type(stream_id_value) != FL_VALUE_TYPE_INT) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "streamId must be an integer", nullptr));
+  }
+
+  if (query_value == nullptr || fl_value_get_type(query_value) != FL_VALUE_TYPE_STRING ||
+      fl_value_get_string(query_value)[0] == '\0') {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "query must be a non-empty string", nullptr));
+  }
+
+  if (max_results_value != nullptr && fl_value_get_type(max_results_value) != FL_VALUE_TYPE_NULL &&
+      (fl_value_get_type(max_results_value) != FL_VALUE_TYPE_INT ||
+       fl_value_get_int(max_results_value) <= 0)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "maxResults must be a positive integer", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  bool fold = case_value != nullptr && fl_value_get_type(case_value) == FL_VALUE_TYPE_BOOL &&
+              fl_value_get_bool(case_value);
+
+  auto stream = std::make_shared<SearchStream>();
+  stream->id = fl_value_get_int(stream_id_value);
+  stream->query = search_query_new(fl_value_get_string(query_value), fold);
+  stream->batch_size = kDefaultSearchBatchSize;
+  stream->recursive = recursive_value != nullptr &&
+                      fl_value_get_type(recursive_value) == FL_VALUE_TYPE_BOOL &&
+                      fl_value_get_bool(recursive_value);
+  stream->include_hidden = hidden_value != nullptr &&
+                           fl_value_get_type(hidden_value) == FL_VALUE_TYPE_BOOL &&
+                           fl_value_get_bool(hidden_value);
+  if (max_results_value != nullptr && fl_value_get_type(max_results_value) == FL_VALUE_TYPE_INT) {
+    stream->max_results = fl_value_get_int(max_results_value);
+  }
+  if (batch_size_value != nullptr && fl_value_get_type(batch_size_value) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(batch_size_value) > 0) {
+    stream->batch_size = fl_value_get_int(batch_size_value);
+  }
+
+  stream->dir = bookmark_dir_get(self, identifier);
+  if (stream->dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  if (!streams_add(self, stream)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "streamId is already in use", nullptr));
+  }
+
+  g_object_ref(self);
+  std::thread(search_stream_run, self, stream).detach();
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// One directory's own entries as last read by getBookmarkUsage. Adding,
+// removing or renaming an entry changes the directory's mtime, so an entry
+// whose directory still has the same identity and mtime is reused as is.
+struct UsageDir {
+  dev_t dev = 0;
+  ino_t ino = 0;
+  int64_t mtime_ns = 0;
+
+  int64_t bytes = 0;
+  int64_t allocated = 0;
+  int64_t files = 0;
+  std::vector<std::string> subdirs;
+  // Largest files directly in the directory, biggest first
+  std::vector<std::pair<int64_t, std::string>> largest;
+
+  // Read while an inotify watch covered the directory. Until an event for
+  // it arrives or the watch set changes (`epoch`), it is trusted without
+  // even a stat, which also covers files grown in place.
+  bool watched = false;
+  uint64_t epoch = 0;
+};
+
+// By absolute path, so nested bookmarks share their common directories
+struct UsageCache {
+  std::mutex mutex;
+  std::map<std::string, UsageDir> dirs;
+  // Bumped by every invalidation, so a read racing an event is not trusted
+  uint64_t changes = 0;
+};
+
+// An inotify event arrived for the directory at `path`. Its entry is read
+// again next time: a file written in place leaves the directory mtime alone.
+static void usage_invalidate(UsageCache* usage, const std::string& path) {
+  std::lock_guard<std::mutex> lock(usage->mutex);
+  usage->changes++;
+  auto it = usage->dirs.find(path);
+  if (it != usage->dirs.end()) {
+    it->second.watched = false;
+    it->second.mtime_ns = -1;
+  }
+}
+
+// Coalesced state of one path within a watch window
+enum WatchChange : uint8_t {
+  kWatchCreated = 1,
+  kWatchModified = 2,
+  kWatchDeleted = 3,
+};
+
+// Events are gathered for this long before being delivered, so a burst of
+// writes to one file arrives as a single change
+static constexpr guint kWatchCoalesceMs = 100;
+
+struct WatchStream : EventStream {
+  DirectoryBookmarksPlugin* self = nullptr;
+  std::string root;
+  bool recursive = false;
+
+  // Guarded by the watcher mutex
+  std::map<std::string, WatchChange> changes;
+  std::vector<std::pair<std::string, std::string>> moves;
+  bool overflowed = false;
+  bool root_gone = false;
+
+  void on_cancel() override;
+};
+
+// A watched directory as seen by one stream
+struct WatchTarget {
+  WatchStream* stream;
+  std::string relative;
+};
+
+// Single inotify instance shared by every watchBookmark stream, serviced on
+// the GLib main loop. Two streams watching the same directory share its watch
+// descriptor, so each descriptor maps to all of its targets.
+struct Watcher {
+  std::mutex mutex;
+  int fd = -1;
+  guint fd_source = 0;
+  guint flush_source = 0;
+  std::unordered_map<int, std::vector<WatchTarget>> targets;
+  std::unordered_map<int64_t, std::shared_ptr<WatchStream>> streams;
+  // Bumped whenever watched directories go away or move, which voids the
+  // usage cache's trust in them
+  uint64_t epoch = 0;
+};
+
+static constexpr uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE |
+                                       IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF |
+                                       IN_MOVE_SELF | IN_ONLYDIR;
+
+static std::string watch_join(const std::string& relative, const char* name) {
+  return relative.empty() ? std::string(name) : relative + "/" + name;
+}
+
+static bool watch_has_prefix(const std::string& path, const std::string& prefix) {
+  return path == prefix ||
+         (path.size() > prefix.size() && path.compare(0, prefix.size(), prefix) == 0 &&
+          path[prefix.size()] == '/');
+}
+
+// Merge a new change for `path` into what the window already holds
+static void watch_record(WatchStream* stream, const std::string& path, WatchChange change) {
+  auto it = stream->changes.find(path);
+  if (it == stream->changes.end()) {
+    stream->changes.emplace(path, change);
+    return;
+  }
+
+  WatchChange previous = it->second;
+  if (change == kWatchDeleted) {
+    if (previous == kWatchCreated) {
+      // Came and went within the window
+      stream->changes.erase(it);
+    } else {
+      it->second = kWatchDeleted;
+    }
+  } else if (previous == kWatchDeleted) {
+    // Replaced within the window
+    it->second = kWatchModified;
+  }
+}
+
+static bool watcher_add_dir(Watcher* watcher, WatchStream* stream, const std::string& relative) {
+  std::string path = relative.empty() ? stream->root : stream->root + "/" + relative;
+  int wd = inotify_add_watch(watcher->fd, path.c_str(), kWatchMask);
+  if (wd < 0) {
+    return false;
+  }
+
+  std::vector<WatchTarget>& targets = watcher->targets[wd];
+  for (const WatchTarget& target : targets) {
+    if (target.stream == stream) {
+      return true;
+    }
+  }
+  targets.push_back({stream, relative});
+  return true;
+}
+
+// Watch `relative` and, for recursive streams, every directory below it.
+// With `report_existing` the entries found are reported as created, since
+// they may have appeared before the new watches existed.
+// Returns false if `relative` itself could not be watched.
+static bool watcher_add_tree(Watcher* watcher, WatchStream* stream, const std::string& relative,
+                             bool report_existing) {
+  if (!watcher_add_dir(watcher, stream, relative)) {
+    return false;
+  }
+  if (!stream->recursive) {
+    return true;
+  }
+
+  std::string base = relative.empty() ? stream->root : stream->root + "/" + relative;
+  std::error_code ec;
+  fs::recursive_directory_iterator it(base, fs::directory_options::skip_permission_denied, ec);
+  for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    std::string child = watch_join(relative, it->path().lexically_relative(base).c_str());
+    if (report_existing) {
+      watch_record(stream, child, kWatchCreated);
+    }
+    if (it->is_directory(ec) && !it->is_symlink(ec)) {
+      watcher_add_dir(watcher, stream, child);
+    }
+  }
+  return true;
+}
+
+// Drop the targets of `stream` at or below `relative` (all of them if null),
+// removing watch descriptors no other stream uses
+static void watcher_drop_targets(Watcher* watcher, WatchStream* stream, const std::string* relative) {
+  for (auto it = watcher->targets.begin(); it != watcher->targets.end();) {
+    std::vector<WatchTarget>& targets = it->second;
+    targets.erase(std::remove_if(targets.begin(), targets.end(), [&](const WatchTarget& target) {
+      return target.stream == stream &&
+             (relative == nullptr || watch_has_prefix(target.relative, *relative));
+    }), targets.end());
+
+    if (targets.empty()) {
+      inotify_rm_watch(watcher->fd, it->first);
+      it = watcher->targets.erase(it);
+      watcher->epoch++;
+    } else {
+      ++it;
+    }
+  }
+}
+
+static void watcher_remove_stream(Watcher* watcher, int64_t id) {
+  auto it = watcher->streams.find(id);
+  if (it == watcher->streams.end()) {
+    return;
+  }
+
+  watcher_drop_targets(watcher, it->second.get(), nullptr);
+  watcher->streams.erase(it);
+}
+
+void WatchStream::on_cancel() {
+  Watcher* watcher = self->watcher;
+  {
+    std::lock_guard<std::mutex> lock(watcher->mutex);
+    watcher_remove_stream(watcher, id);
+  }
+  streams_remove(self, id);
+}
+
+// Deliver everything gathered during the window, one event per stream
+static gboolean watcher_flush_cb(gpointer user_data) {
+  DirectoryBookmarksPlugin* self = DIRECTORY_BOOKMARKS_PLUGIN(user_data);
+  Watcher* watcher = self->watcher;
+  std::vector<int64_t> finished;
+
+  {
+    std::lock_guard<std::mutex> lock(watcher->mutex);
+    watcher->flush_source = 0;
+
+    for (auto& [id, stream] : watcher->streams) {
+      if (stream->changes.empty() && stream->moves.empty() && !stream->overflowed) {
+        if (stream->root_gone) {
+          finished.push_back(id);
+        }
+        continue;
+      }
+
+      g_autoptr(FlValue) list = fl_value_new_list();
+      auto append = [&list](const char* type, const std::string& path, const std::string* from) {
+        g_autoptr(FlValue) change = fl_value_new_map();
+        fl_value_set_string_take(change, "type", fl_value_new_string(type));
+        fl_value_set_string_take(change, "path", fl_value_new_string_safe(path));
+        if (from != nullptr) {
+          fl_value_set_string_take(change, "from", fl_value_new_string_safe(*from));
+        }
+        fl_value_append(list, change);
+      };
+
+      if (stream->overflowed) {
+        // Events were lost; the listener has to rescan
+        append("overflow", "", nullptr);
+      }
+      for (const auto& [from, to] : stream->moves) {
+        append("moved", to, &from);
+      }
+      for (const auto& [path, change] : stream->changes) {
+        append(change == kWatchCreated   ? "created"
+               : change == kWatchDeleted ? "deleted"
+                                         : "modified",
+               path, nullptr);
+      }
+      stream->changes.clear();
+      stream->moves.clear();
+      stream->overflowed = false;
+
+      FlValue* event = stream_event_new(*stream, "changes");
+      fl_value_set_string(event, "changes", list);
+      events_post(self, event);
+
+      if (stream->root_gone) {
+        finished.push_back(id);
+      }
+    }
+
+    for (int64_t id : finished) {
+      auto it = watcher->streams.find(id);
+      events_post(self, stream_event_new(*it->second, "done"));
+      watcher_remove_stream(watcher, id);
+    }
+  }
+
+  for (int64_t id : finished) {
+    streams_remove(self, id);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void watcher_schedule_flush(DirectoryBookmarksPlugin* self) {
+  Watcher* watcher = self->watcher;
+  if (watcher->flush_source == 0) {
+    watcher->flush_source = g_timeout_add(kWatchCoalesceMs, watcher_flush_cb, self);
+  }
+}
+
+// Rewrite the paths below a directory moved within a recursive watch
+static void watcher_rename_targets(Watcher* watcher, WatchStream* stream, const std::string& from,
+                                   const std::string& to) {
+  watcher->epoch++;
+  for (auto& [wd, targets] : watcher->targets) {
+    for (WatchTarget& target : targets) {
+      if (target.stream == stream && watch_has_prefix(target.relative, from)) {
+        target.relative = to + target.relative.substr(from.size());
+      }
+    }
+  }
+
+  // Changes already gathered below the directory follow it too
+  std::map<std::string, WatchChange> changes;
+  for (auto& [path, change] : stream->changes) {
+    changes.emplace(watch_has_prefix(path, from) ? to + path.substr(from.size()) : path, change);
+  }
+  stream->changes.swap(changes);
+}
+
+static gboolean watcher_fd_cb(gint fd, GIOCondition condition, gpointer user_data) {
+  DirectoryBookmarksPlugin* self = DIRECTORY_BOOKMARKS_PLUGIN(user_data);
+  Watcher* watcher = self->watcher;
+  std::lock_guard<std::mutex> lock(watcher->mutex);
+
+  // IN_MOVED_FROM halves waiting for the IN_MOVED_TO with the same cookie
+  struct MoveFrom {
+    WatchStream* stream;
+    std::string path;
+    bool is_dir;
+  };
+  std::unordered_map<uint32_t, std::vector<MoveFrom>> move_from;
+  bool any = false;
+
+  alignas(struct inotify_event) char buffer[16 * 1024];
+  for (;;) {
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      break;
+    }
+
+    for (char* ptr = buffer; ptr < buffer + length;) {
+      auto* event = reinterpret_cast<struct inotify_event*>(ptr);
+      ptr += sizeof(struct inotify_event) + event->len;
+      any = true;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        for (auto& [id, stream] : watcher->streams) {
+          stream->overflowed = true;
+        }
+        watcher->epoch++;
+        continue;
+      }
+
+      auto found = watcher->targets.find(event->wd);
+      if (found == watcher->targets.end()) {
+        continue;
+      }
+
+      if (event->mask & IN_IGNORED) {
+        // The directory is gone; its descriptor is dead
+        watcher->targets.erase(found);
+        watcher->epoch++;
+        continue;
+      }
+
+      // Copy, since adding watches below may rehash the map
+      std::vector<WatchTarget> targets = found->second;
+      bool is_dir = event->mask & IN_ISDIR;
+
+      for (const WatchTarget& target : targets) {
+        WatchStream* stream = target.stream;
+        usage_invalidate(self->usage, target.relative.empty()
+                                          ? stream->root
+                                          : stream->root + "/" + target.relative);
+
+        if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+          if (target.relative.empty()) {
+            stream->root_gone = true;
+          }
+          continue;
+        }
+        if (event->len == 0) {
+          continue;
+        }
+
+        std::string path = watch_join(target.relative, event->name);
+        if (event->mask & IN_CREATE) {
+          watch_record(stream, path, kWatchCreated);
+          if (is_dir && stream->recursive) {
+            watcher_add_tree(watcher, stream, path, true);
+          }
+        } else if (event->mask & IN_DELETE) {
+          watch_record(stream, path, kWatchDeleted);
+        } else if (event->mask & (IN_MODIFY | IN_CLOSE_WRITE)) {
+          watch_record(stream, path, kWatchModified);
+        } else if (event->mask & IN_MOVED_FROM) {
+          move_from[event->cookie].push_back({stream, path, is_dir});
+        } else if (event->mask & IN_MOVED_TO) {
+          bool matched = false;
+          auto pending = move_from.find(event->cookie);
+          if (pending != move_from.end()) {
+            for (MoveFrom& from : pending->second) {
+              if (from.stream == stream && !from.path.empty()) {
+                stream->moves.emplace_back(from.path, path);
+                if (is_dir && stream->recursive) {
+                  watcher_rename_targets(watcher, stream, from.path, path);
+                }
+                from.path.clear();
+                matched = true;
+              }
+            }
+          }
+          if (!matched) {
+            // Moved in from outside the watched tree
+            watch_record(stream, path, kWatchCreated);
+            if (is_dir && stream->recursive) {
+              watcher_add_tree(watcher, stream, path, true);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Anything moved out of the watched tree is gone as far as we can tell
+  for (auto& [cookie, halves] : move_from) {
+    for (MoveFrom& from : halves) {
+      if (from.path.empty()) {
+        continue;
+      }
+      watch_record(from.stream, from.path, kWatchDeleted);
+      if (from.is_dir && from.stream->recursive) {
+        watcher_drop_targets(watcher, from.stream, &from.path);
+      }
+    }
+  }
+
+  if (any) {
+    watcher_schedule_flush(self);
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+// Method: startWatch
+static FlMethodResponse* start_watch(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* stream_id_value = fl_value_lookup_string(args, "streamId");
+  FlValue* recursive_value = fl_value_lookup_string(args, "recursive");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (stream_id_value == nullptr || fl_value_get_type(stream_id_value) != FL_VALUE_TYPE_INT) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "streamId must be an integer", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+
+  auto stream = std::make_shared<WatchStream>();
+  stream->id = fl_value_get_int(stream_id_value);
+  stream->self = self;
+  stream->recursive = recursive_value != nullptr &&
+                      fl_value_get_type(recursive_value) == FL_VALUE_TYPE_BOOL &&
+                      fl_value_get_bool(recursive_value);
+
+  // Get bookmarked directory
+  if (!get_bookmarked_path(self, identifier, stream->root)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "BOOKMARK_NOT_FOUND",
+        ("Bookmark with identifier '" + std::string(identifier) + "' not found").c_str(),
+        nullptr));
+  }
+
+  if (!streams_add(self, stream)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "streamId is already in use", nullptr));
+  }
+
+  Watcher* watcher = self->watcher;
+  std::lock_guard<std::mutex> lock(watcher->mutex);
+
+  if (watcher->fd < 0) {
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->fd < 0) {
+      int error = errno;
+      streams_remove(self, stream->id);
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "READ_ERROR", strerror(error), nullptr));
+    }
+    watcher->fd_source = g_unix_fd_add(watcher->fd, G_IO_IN, watcher_fd_cb, self);
+  }
+
+  if (!watcher_add_tree(watcher, stream.get(), "", false)) {
+    int error = errno;
+    streams_remove(self, stream->id);
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        error == EACCES ? "PERMISSION_DENIED" : "DIRECTORY_NOT_FOUND", strerror(error), nullptr));
+  }
+  watcher->streams.emplace(stream->id, stream);
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+static constexpr size_t kDefaultUsageLargest = 10;
+// Also how many names each cached directory keeps, which bounds the cache
+static constexpr size_t kMaxUsageLargest = 32;
+
+struct UsageWalk {
+  UsageCache* cache = nullptr;
+  std::string root;
+  size_t largest_count = 0;
+  bool refresh = false;
+
+  // Directories under an inotify watch when the walk started, and the
+  // watcher epoch they belong to
+  std::set<std::string> watched;
+  uint64_t epoch = 0;
+
+  // Directories waiting to be read, relative to the root
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::vector<std::string> pending;
+  size_t busy = 0;
+  std::set<std::pair<dev_t, ino_t>> visited;
+
+  // Totals, merged in by each worker when it finishes
+  int64_t bytes = 0;
+  int64_t allocated = 0;
+  int64_t files = 0;
+  int64_t directories = 0;
+  int64_t skipped = 0;
+  int64_t cached = 0;
+  std::vector<std::pair<int64_t, std::string>> largest;
+  int root_error = 0;
+};
+
+// Keep the `count` biggest of `files`, biggest first
+static void usage_trim_largest(std::vector<std::pair<int64_t, std::string>>& files, size_t count) {
+  auto bigger = [](const std::pair<int64_t, std::string>& a,
+                   const std::pair<int64_t, std::string>& b) { return a.first > b.first; };
+  if (files.size() > count) {
+    std::nth_element(files.begin(), files.begin() + count, files.end(), bigger);
+    files.resize(count);
+  }
+  std::sort(files.begin(), files.end(), bigger);
+}
+
+// Drop cached entries at or below `path`
+static void usage_forget(UsageCache* cache, const std::string& path) {
+  cache->dirs.erase(path);
+  std::string prefix = path + "/";
+  auto it = cache->dirs.lower_bound(prefix);
+  while (it != cache->dirs.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+    it = cache->dirs.erase(it);
+  }
+}
+
+// Read every entry of an open directory into `out`, with one statx each
+static bool usage_read_dir(int dir_fd, UsageDir& out) {
+  out.bytes = 0;
+  out.allocated = 0;
+  out.files = 0;
+  out.subdirs.clear();
+  out.largest.clear();
+
+  bool more;
+  int64_t resume;
+  bool ok = dir_read_entries(dir_fd, std::numeric_limits<int64_t>::max(),
+                             [&](const LinuxDirent64* entry) {
+    const char* name = entry->d_name;
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || entry->d_type == DT_LNK) {
+      return false;
+    }
+    if (entry->d_type == DT_DIR) {
+      out.subdirs.push_back(name);
+      return false;
+    }
+
+    // Symlinks are neither counted nor followed
+    struct statx stx;
+    if (statx(dir_fd, name, AT_STATX_DONT_SYNC | AT_SYMLINK_NOFOLLOW,
+              STATX_TYPE | STATX_SIZE | STATX_BLOCKS, &stx) != 0) {
+      return false;
+    }
+    if (S_ISDIR(stx.stx_mode)) {
+      out.subdirs.push_back(name);
+    } else if (S_ISREG(stx.stx_mode)) {
+      out.bytes += stx.stx_size;
+      out.allocated += stx.stx_blocks * 512;
+      out.files++;
+      out.largest.emplace_back(stx.stx_size, name);
+      if (out.largest.size() >= 2 * kMaxUsageLargest) {
+        usage_trim_largest(out.largest, kMaxUsageLargest);
+      }
+    }
+    return false;
+  }, &more, &resume);
+  usage_trim_largest(out.largest, kMaxUsageLargest);
+  return ok;
+}
+
+// The usage of one directory, from the cache when it is still valid.
+// Returns 0, or the errno if the directory could not be read.
+static int usage_dir_get(UsageWalk* walk, const std::string& relative, UsageDir& out,
+                         bool* from_cache) {
+  std::string path = relative.empty() ? walk->root : walk->root + "/" + relative;
+  UsageCache* cache = walk->cache;
+
+  bool have_cached = false;
+  uint64_t changes;
+  {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    auto it = cache->dirs.find(path);
+    if (it != cache->dirs.end() && !walk->refresh) {
+      if (it->second.watched && it->second.epoch == walk->epoch) {
+        out = it->second;
+        *from_cache = true;
+        return 0;
+      }
+      out = it->second;
+      have_cached = true;
+    }
+    changes = cache->changes;
+  }
+
+  // The bookmark itself may be a link, nothing below it is followed
+  int dir_fd = open(path.c_str(),
+                    O_RDONLY | O_DIRECTORY | O_CLOEXEC | (relative.empty() ? 0 : O_NOFOLLOW));
+  struct statx stx;
+  if (dir_fd < 0 || statx(dir_fd, "", AT_EMPTY_PATH | AT_STATX_DONT_SYNC,
+                          STATX_INO | STATX_MTIME, &stx) != 0) {
+    int error = errno;
+    if (dir_fd >= 0) {
+      close(dir_fd);
+    }
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    usage_forget(cache, path);
+    return error;
+  }
+
+  dev_t dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+  int64_t mtime_ns = stx.stx_mtime.tv_sec * 1000000000LL + stx.stx_mtime.tv_nsec;
+  bool reused = have_cached && out.dev == dev && out.ino == stx.stx_ino &&
+                out.mtime_ns == mtime_ns;
+  *from_cache = reused;
+
+  std::vector<std::string> previous;
+  if (!reused) {
+    if (have_cached) {
+      previous = std::move(out.subdirs);
+    }
+    out.dev = dev;
+    out.ino = stx.stx_ino;
+    out.mtime_ns = mtime_ns;
+    if (!usage_read_dir(dir_fd, out)) {
+      int error = errno;
+      close(dir_fd);
+      return error;
+    }
+  }
+  close(dir_fd);
+
+  out.watched = walk->watched.count(path) > 0;
+  out.epoch = walk->epoch;
+
+  std::lock_guard<std::mutex> lock(cache->mutex);
+  if (cache->changes != changes) {
+    // Something changed while we read; read again next time
+    out.watched = false;
+    out.mtime_ns = -1;
+  }
+  for (const std::string& name : previous) {
+    if (std::find(out.subdirs.begin(), out.subdirs.end(), name) == out.subdirs.end()) {
+      usage_forget(cache, path + "/" + name);
+    }
+  }
+  cache->dirs[path] = out;
+  return 0;
+}
+
+static void usage_worker(UsageWalk* walk) {
+  int64_t bytes = 0;
+  int64_t allocated = 0;
+  int64_t files = 0;
+  int64_t directories = 0;
+  int64_t skipped = 0;
+  int64_t cached = 0;
+  std::vector<std::pair<int64_t, std::string>> largest;
+
+  for (;;) {
+    std::string relative;
+    {
+      std::unique_lock<std::mutex> lock(walk->mutex);
+      walk->cond.wait(lock, [walk]() { return !walk->pending.empty() || walk->busy == 0; });
+      if (walk->pending.empty()) {
+        break;
+      }
+      relative = std::move(walk->pending.back());
+      walk->pending.pop_back();
+      walk->busy++;
+    }
+
+    UsageDir dir;
+    bool from_cache = false;
+    int error = usage_dir_get(walk, relative, dir, &from_cache);
+
+    bool counted = false;
+    {
+      std::lock_guard<std::mutex> lock(walk->mutex);
+      walk->busy--;
+      if (error != 0) {
+        if (relative.empty()) {
+          walk->root_error = error;
+        }
+        skipped++;
+      } else if (walk->visited.emplace(dir.dev, dir.ino).second) {
+        // Bind mounts can show one directory twice; it only counts once
+        counted = true;
+        for (const std::string& name : dir.subdirs) {
+          walk->pending.push_back(relative.empty() ? name : relative + "/" + name);
+        }
+      }
+    }
+    walk->cond.notify_all();
+
+    if (counted) {
+      directories += !relative.empty();
+      cached += from_cache;
+      bytes += dir.bytes;
+      allocated += dir.allocated;
+      files += dir.files;
+      size_t take = std::min(dir.largest.size(), walk->largest_count);
+      for (size_t i = 0; i < take; i++) {
+        const std::string& name = dir.largest[i].second;
+        largest.emplace_back(dir.largest[i].first,
+                             relative.empty() ? name : relative + "/" + name);
+      }
+      if (largest.size() > 2 * walk->largest_count) {
+        usage_trim_largest(largest, walk->largest_count);
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(walk->mutex);
+  walk->bytes += bytes;
+  walk->allocated += allocated;
+  walk->files += files;
+  walk->directories += directories;
+  walk->skipped += skipped;
+  walk->cached += cached;
+  walk->largest.insert(walk->largest.end(), std::make_move_iterator(largest.begin()),
+                       std::make_move_iterator(largest.end()));
+}
+
+// Method: getBookmarkUsage
+//
+// Totals are apparent sizes and allocated blocks of the regular files below
+// the bookmark; symlinks are neither counted nor followed.
+static FlMethodResponse* get_bookmark_usage(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* largest_value = fl_value_lookup_string(args, "largest");
+  FlValue* refresh_value = fl_value_lookup_string(args, "refresh");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (largest_value != nullptr && fl_value_get_type(largest_value) != FL_VALUE_TYPE_NULL &&
+      (fl_value_get_type(largest_value) != FL_VALUE_TYPE_INT ||
+       fl_value_get_int(largest_value) < 0 ||
+       fl_value_get_int(largest_value) > static_cast<int64_t>(kMaxUsageLargest))) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT",
+        ("largest must be an integer from 0 to " + std::to_string(kMaxUsageLargest)).c_str(),
+        nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+
+  UsageWalk walk;
+  walk.cache = self->usage;
+  walk.largest_count = kDefaultUsageLargest;
+  if (largest_value != nullptr && fl_value_get_type(largest_value) == FL_VALUE_TYPE_INT) {
+    walk.largest_count = fl_value_get_int(largest_value);
+  }
+  walk.refresh = refresh_value != nullptr && fl_value_get_type(refresh_value) == FL_VALUE_TYPE_BOOL &&
+                 fl_value_get_bool(refresh_value);
+
+  if (!get_bookmarked_path(self, identifier, walk.root)) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  {
+    Watcher* watcher = self->watcher;
+    std::lock_guard<std::mutex> lock(watcher->mutex);
+    walk.epoch = watcher->epoch;
+    for (const auto& [wd, targets] : watcher->targets) {
+      for (const WatchTarget& target : targets) {
+        walk.watched.insert(target.relative.empty() ? target.stream->root
+                                                    : target.stream->root + "/" + target.relative);
+      }
+    }
+  }
+
+  walk.pending.push_back("");
+  std::vector<std::thread> workers;
+  size_t threads = CLAMP(std::thread::hardware_concurrency(), 2u, 8u);
+  for (size_t i = 1; i < threads; i++) {
+    workers.emplace_back(usage_worker, &walk);
+  }
+  usage_worker(&walk);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  if (walk.root_error != 0) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        walk.root_error == EACCES ? "PERMISSION_DENIED" : "DIRECTORY_NOT_FOUND",
+        strerror(walk.root_error), nullptr));
+  }
+
+  usage_trim_largest(walk.largest, walk.largest_count);
+  g_autoptr(FlValue) largest = fl_value_new_list();
+  for (const auto& [size, path] : walk.largest) {
+    g_autoptr(FlValue) file = fl_value_new_map();
+    fl_value_set_string_take(file, "path", fl_value_new_string_safe(path));
+    fl_value_set_string_take(file, "size", fl_value_new_int(size));
+    fl_value_append(largest, file);
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "totalBytes", fl_value_new_int(walk.bytes));
+  fl_value_set_string_take(result, "allocatedBytes", fl_value_new_int(walk.allocated));
+  fl_value_set_string_take(result, "fileCount", fl_value_new_int(walk.files));
+  fl_value_set_string_take(result, "directoryCount", fl_value_new_int(walk.directories));
+  fl_value_set_string(result, "largestFiles", largest);
+  // Directories that could not be read, and directories answered from the cache
+  fl_value_set_string_take(result, "skipped", fl_value_new_int(walk.skipped));
+  fl_value_set_string_take(result, "cached", fl_value_new_int(walk.cached));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Method: deleteFile
+static FlMethodResponse* delete_file(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  const char* filename = fl_value_get_string(filename_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  // Check if file exists
+  struct stat st;
+  if (fstatat(dir->fd, filename, &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+  }
+
+  // Delete file
+  if (unlinkat(dir->fd, filename, 0) != 0) {
+    if (errno == ENOENT) {
+      return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(false)));
+    }
+    if (errno == EACCES || errno == EPERM || errno == EROFS) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "PERMISSION_DENIED", "No write permission for bookmarked directory", nullptr));
+    }
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "DELETE_ERROR", strerror(errno), nullptr));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Copy `size` bytes of `in_fd` to `out_fd` without passing them through user
+// space: a reflink where the filesystem can share extents (btrfs, XFS),
+// otherwise copy_file_range, otherwise sendfile
+static bool copy_file_contents(int in_fd, int out_fd, off_t size) {
+  if (ioctl(out_fd, FICLONE, in_fd) == 0) {
+    return true;
+  }
+
+  off_t copied = 0;
+  bool copy_range = true;
+  while (copied < size) {
+    ssize_t n;
+    if (copy_range) {
+      loff_t in_offset = copied;
+      loff_t out_offset = copied;
+      n = copy_file_range(in_fd, &in_offset, out_fd, &out_offset, size - copied, 0);
+      if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL ||
+                    errno == EOPNOTSUPP)) {
+        // Older kernels only copy within one filesystem
+        copy_range = false;
+        if (lseek(out_fd, copied, SEEK_SET) < 0) {
+          return false;
+        }
+        continue;
+      }
+    } else {
+      off_t in_offset = copied;
+      n = sendfile(out_fd, in_fd, &in_offset, size - copied);
+    }
+
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (n == 0) {
+      // The source shrank while we were copying
+      break;
+    }
+    copied += n;
+  }
+
+  return true;
+}
+
+static FlMethodResponse* file_move_error(int error) {
+  if (error == EACCES || error == EPERM || error == EROFS) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "PERMISSION_DENIED", "No write permission for bookmarked directory", nullptr));
+  }
+  return FL_METHOD_RESPONSE(fl_method_error_response_new(
+      "WRITE_ERROR", strerror(error), nullptr));
+}
+
+// Shared by copyFile and moveFile: `identifier`/`fileName` name the source,
+// `targetIdentifier`/`targetFileName` the destination
+static FlMethodResponse* copy_or_move_file(DirectoryBookmarksPlugin* self, FlValue* args,
+                                           bool move) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+  FlValue* target_identifier_value = fl_value_lookup_string(args, "targetIdentifier");
+  FlValue* target_filename_value = fl_value_lookup_string(args, "targetFileName");
+  FlValue* overwrite_value = fl_value_lookup_string(args, "overwrite");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  }
+
+  if (target_identifier_value == nullptr ||
+      fl_value_get_type(target_identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "targetIdentifier must be a string", nullptr));
+  }
+
+  if (target_filename_value == nullptr ||
+      fl_value_get_type(target_filename_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "targetFileName must be a string", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  const char* filename = fl_value_get_string(filename_value);
+  const char* target_identifier = fl_value_get_string(target_identifier_value);
+  const char* target_filename = fl_value_get_string(target_filename_value);
+  bool overwrite = overwrite_value == nullptr ||
+                   fl_value_get_type(overwrite_value) != FL_VALUE_TYPE_BOOL ||
+                   fl_value_get_bool(overwrite_value);
+
+  // Get bookmarked directories
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+  std::shared_ptr<BookmarkDir> target_dir = bookmark_dir_get(self, target_identifier);
+  if (target_dir == nullptr) {
+    return bookmark_not_found_error(target_identifier);
+  }
+
+  struct stat st;
+  if (fstatat(dir->fd, filename, &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "FILE_NOT_FOUND", ("File '" + std::string(filename) + "' not found").c_str(), nullptr));
+  }
+
+  auto exists_error = [&]() {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "FILE_EXISTS", ("File '" + std::string(target_filename) + "' already exists").c_str(),
+        nullptr));
+  };
+
+  if (move) {
+    // Within one filesystem a move is just a rename, whatever the size
+    int result = renameat2(dir->fd, filename, target_dir->fd, target_filename,
+                           overwrite ? 0 : RENAME_NOREPLACE);
+    if (result != 0 && errno == EINVAL && !overwrite) {
+      // The filesystem does not support RENAME_NOREPLACE
+      struct stat target_st;
+      if (fstatat(target_dir->fd, target_filename, &target_st, AT_SYMLINK_NOFOLLOW) == 0) {
+        return exists_error();
+      }
+      result = renameat(dir->fd, filename, target_dir->fd, target_filename);
+    }
+
+    if (result == 0) {
+      return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+    }
+    if (errno == EEXIST) {
+      return exists_error();
+    }
+    if (errno != EXDEV) {
+      return file_move_error(errno);
+    }
+    // Across filesystems: copy, then remove the source
+  }
+
+  struct stat target_st;
+  if (!overwrite && fstatat(target_dir->fd, target_filename, &target_st, AT_SYMLINK_NOFOLLOW) == 0) {
+    return exists_error();
+  }
+
+  bool not_found = false;
+  std::string error;
+  int fd = open_bookmarked_file(dir->fd, filename, &not_found, &error);
+  if (fd < 0) {
+    if (not_found) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "FILE_NOT_FOUND", ("File '" + std::string(filename) + "' not found").c_str(),
+          nullptr));
+    }
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "PERMISSION_DENIED", ("Cannot read file: " + error).c_str(), nullptr));
+  }
+  fstat(fd, &st);
+
+  // The copy is published under the target name only once complete
+  AtomicFile file;
+  if (!atomic_file_open(&file, target_dir->fd, target_filename, &error)) {
+    close(fd);
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "PERMISSION_DENIED", ("Cannot write file: " + error).c_str(), nullptr));
+  }
+
+  if (!copy_file_contents(fd, file.fd, st.st_size)) {
+    int saved_errno = errno;
+    close(fd);
+    atomic_file_abort(&file);
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "WRITE_ERROR", strerror(saved_errno), nullptr));
+  }
+  close(fd);
+
+  if (!atomic_file_commit(&file, &error)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "WRITE_ERROR", error.c_str(), nullptr));
+  }
+
+  if (move && unlinkat(dir->fd, filename, 0) != 0 && errno != ENOENT) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "WRITE_ERROR",
+        ("File was copied but the source could not be removed: " +
+         std::string(strerror(errno))).c_str(),
+        nullptr));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+// Method: copyFile
+static FlMethodResponse* copy_file(DirectoryBookmarksPlugin* self, FlValue* args) {
+  return copy_or_move_file(self, args, false);
+}
+
+// Method: moveFile
+static FlMethodResponse* move_file(DirectoryBookmarksPlugin* self, FlValue* args) {
+  return copy_or_move_file(self, args, true);
+}
+
+// Streaming SHA-256. Blocks go through the SHA extensions where the CPU has
+// them, which is several times faster than the portable rounds.
+struct Sha256 {
+  uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                       0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  uint8_t buffer[64];
+  size_t buffered = 0;
+  uint64_t total = 0;
+};
+
+alignas(16) static const uint32_t kSha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+    0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+    0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+    0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+    0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+    0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+    0xc67178f2};
+
+static inline uint32_t rotr32(uint32_t x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+static void sha256_blocks_portable(uint32_t state[8], const uint8_t* data, size_t blocks) {
+  for (; blocks > 0; blocks--, data += 64) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+      w[i] = static_cast<uint32_t>(data[i * 4]) << 24 | static_cast<uint32_t>(data[i * 4 + 1]) << 16 |
+             static_cast<uint32_t>(data[i * 4 + 2]) << 8 | data[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+      uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+      uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) +
+                    kSha256K[i] + w[i];
+      uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+#if defined(__x86_64__)
+// Four rounds per step on the SHA-NI unit. The state is kept as the ABEF
+// and CDGH halves sha256rnds2 works on.
+__attribute__((target("sha,sse4.1")))
+static void sha256_blocks_shani(uint32_t state[8], const uint8_t* data, size_t blocks) {
+  const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i*>(&state[0])), 0xB1);
+  __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i*>(&state[4])), 0x1B);
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+  for (; blocks > 0; blocks--, data += 64) {
+    __m128i abef = state0;
+    __m128i cdgh = state1;
+    __m128i w[16];
+
+    for (int i = 0; i < 16; i++) {
+      if (i < 4) {
+        w[i] = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), byte_swap);
+      } else {
+        __m128i partial = _mm_add_epi32(_mm_sha256msg1_epu32(w[i - 4], w[i - 3]),
+                                        _mm_alignr_epi8(w[i - 1], w[i - 2], 4));
+        w[i] = _mm_sha256msg2_epu32(partial, w[i - 1]);
+      }
+
+      __m128i message = _mm_add_epi32(
+          w[i], _mm_load_si128(reinterpret_cast<const __m128i*>(&kSha256K[i * 4])));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0E));
+    }
+
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B);
+  state1 = _mm_shuffle_epi32(state1, 0xB1);
+  state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+  state1 = _mm_alignr_epi8(state1, tmp, 8);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+#endif
+
+static void sha256_blocks(uint32_t state[8], const uint8_t* data, size_t blocks) {
+#if defined(__x86_64__)
+  static const bool has_sha = __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+  if (has_sha) {
+    sha256_blocks_shani(state, data, blocks);
+    return;
+  }
+#endif
+  sha256_blocks_portable(state, data, blocks);
+}
+
+static void sha256_update(Sha256* ctx, const uint8_t* data, size_t length) {
+  ctx->total += length;
+
+  if (ctx->buffered > 0) {
+    size_t take = std::min(length, sizeof(ctx->buffer) - ctx->buffered);
+    memcpy(ctx->buffer + ctx->buffered, data, take);
+    ctx->buffered += take;
+    data += take;
+    length -= take;
+    if (ctx->buffered < sizeof(ctx->buffer)) {
+      return;
+    }
+    sha256_blocks(ctx->state, ctx->buffer, 1);
+    ctx->buffered = 0;
+  }
+
+  sha256_blocks(ctx->state, data, length / 64);
+  data += length & ~static_cast<size_t>(63);
+  length &= 63;
+
+  memcpy(ctx->buffer, data, length);
+  ctx->buffered = length;
+}
+
+static std::string sha256_final(Sha256* ctx) {
+  uint64_t bits = ctx->total * 8;
+  uint8_t padding[72] = {0x80};
+  size_t pad_length = (ctx->buffered < 56 ? 56 : 120) - ctx->buffered;
+  for (int i = 0; i < 8; i++) {
+    padding[pad_length + i] = static_cast<uint8_t>(bits >> (56 - i * 8));
+  }
+  sha256_update(ctx, padding, pad_length + 8);
+
+  char hex[65];
+  for (int i = 0; i < 8; i++) {
+    snprintf(hex + i * 8, 9, "%08x", ctx->state[i]);
+  }
+  return std::string(hex, 64);
+}
+
+// Streaming XXH64: not cryptographic, but several GB/s per core, for
+// integrity checks where SHA-256 is not required
+struct Xxh64 {
+  uint64_t acc[4];
+  uint8_t buffer[32];
+  size_t buffered = 0;
+  uint64_t total = 0;
+};
+
+static constexpr uint64_t kXxhPrime1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t kXxhPrime2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr uint64_t kXxhPrime3 = 0x165667B19E3779F9ULL;
+static constexpr uint64_t kXxhPrime4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr uint64_t kXxhPrime5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl64(uint64_t x, int n) {
+  return (x << n) | (x >> (64 - n));
+}
+
+static inline uint64_t read_u64_le(const uint8_t* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+  return rotl64(acc + input * kXxhPrime2, 31) * kXxhPrime1;
+}
+
+static void xxh64_init(Xxh64* ctx) {
+  ctx->acc[0] = kXxhPrime1 + kXxhPrime2;
+  ctx->acc[1] = kXxhPrime2;
+  ctx->acc[2] = 0;
+  ctx->acc[3] = -kXxhPrime1;
+}
+
+// The four lanes are independent, so the loop keeps several multiplies in
+// flight at once
+static const uint8_t* xxh64_stripes(Xxh64* ctx, const uint8_t* data, size_t stripes) {
+  uint64_t a0 = ctx->acc[0], a1 = ctx->acc[1], a2 = ctx->acc[2], a3 = ctx->acc[3];
+  for (; stripes > 0; stripes--, data += 32) {
+    a0 = xxh64_round(a0, read_u64_le(data));
+    a1 = xxh64_round(a1, read_u64_le(data + 8));
+    a2 = xxh64_round(a2, read_u64_le(data + 16));
+    a3 = xxh64_round(a3, read_u64_le(data + 24));
+  }
+  ctx->acc[0] = a0;
+  ctx->acc[1] = a1;
+  ctx->acc[2] = a2;
+  ctx->acc[3] = a3;
+  return data;
+}
+
+static void xxh64_update(Xxh64* ctx, const uint8_t* data, size_t length) {
+  ctx->total += length;
+
+  if (ctx->buffered > 0) {
+    size_t take = std::min(length, sizeof(ctx->buffer) - ctx->buffered);
+    memcpy(ctx->buffer + ctx->buffered, data, take);
+    ctx->buffered += take;
+    data += take;
+    length -= take;
+    if (ctx->buffered < sizeof(ctx->buffer)) {
+      return;
+    }
+    xxh64_stripes(ctx, ctx->buffer, 1);
+    ctx->buffered = 0;
+  }
+
+  data = xxh64_stripes(ctx, data, length / 32);
+  length &= 31;
+  memcpy(ctx->buffer, data, length);
+  ctx->buffered = length;
+}
+
+static std::string xxh64_final(Xxh64* ctx) {
+  uint64_t hash;
+  if (ctx->total >= 32) {
+    hash = rotl64(ctx->acc[0], 1) + rotl64(ctx->acc[1], 7) + rotl64(ctx->acc[2], 12) +
+           rotl64(ctx->acc[3], 18);
+    for (uint64_t acc : ctx->acc) {
+      hash = (hash ^ xxh64_round(0, acc)) * kXxhPrime1 + kXxhPrime4;
+    }
+  } else {
+    hash = kXxhPrime5;
+  }
+  hash += ctx->total;
+
+  const uint8_t* p = ctx->buffer;
+  size_t left = ctx->buffered;
+  for (; left >= 8; left -= 8, p += 8) {
+    hash = rotl64(hash ^ xxh64_round(0, read_u64_le(p)), 27) * kXxhPrime1 + kXxhPrime4;
+  }
+  if (left >= 4) {
+    uint32_t word;
+    memcpy(&word, p, sizeof(word));
+    hash = rotl64(hash ^ (word * kXxhPrime1), 23) * kXxhPrime2 + kXxhPrime3;
+    left -= 4;
+    p += 4;
+  }
+  for (; left > 0; left--, p++) {
+    hash = rotl64(hash ^ (*p * kXxhPrime5), 11) * kXxhPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kXxhPrime2;
+  hash ^= hash >> 29;
+  hash *= kXxhPrime3;
+  hash ^= hash >> 32;
+
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+  return hex;
+}
+
+enum HashAlgorithm {
+  kHashSha256,
+  kHashXxh64,
+};
+
+static bool hash_algorithm_parse(FlValue* value, HashAlgorithm* algorithm) {
+  if (value == nullptr || fl_value_get_type(value) == FL_VALUE_TYPE_NULL) {
+    *algorithm = kHashSha256;
+    return true;
+  }
+  if (fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return false;
+  }
+
+  const char* name = fl_value_get_string(value);
+  if (strcmp(name, "sha256") == 0) {
+    *algorithm = kHashSha256;
+  } else if (strcmp(name, "xxh64") == 0) {
+    *algorithm = kHashXxh64;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Files are hashed in chunks of this size
+static constexpr size_t kHashChunkSize = 1 << 20;
+
+// Most digests remembered by the cache
+static constexpr size_t kMaxCachedDigests = 8192;
+
+// Identity of a file's contents for the digest cache. Rewriting a file in
+// place changes its mtime and ctime; ctime cannot be set back by utimes().
+struct DigestKey {
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  int64_t mtime_ns;
+  int64_t ctime_ns;
+  HashAlgorithm algorithm;
+
+  bool operator==(const DigestKey& other) const {
+    return dev == other.dev && ino == other.ino && size == other.size &&
+           mtime_ns == other.mtime_ns && ctime_ns == other.ctime_ns &&
+           algorithm == other.algorithm;
+  }
+};
+
+struct DigestKeyHash {
+  size_t operator()(const DigestKey& key) const {
+    uint64_t hash = key.ino * kXxhPrime1 ^ key.dev;
+    hash = (hash ^ key.size) * kXxhPrime2 ^ key.mtime_ns;
+    return (hash ^ key.ctime_ns) * kXxhPrime3 + key.algorithm;
+  }
+};
+
+struct DigestCache {
+  std::mutex mutex;
+  std::unordered_map<DigestKey, std::string, DigestKeyHash> digests;
+};
+
+static DigestKey digest_key_new(const struct stat& st, HashAlgorithm algorithm) {
+  return {st.st_dev, st.st_ino, st.st_size,
+          st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec,
+          st.st_ctim.tv_sec * 1000000000LL + st.st_ctim.tv_nsec, algorithm};
+}
+
+// Hash an open file from the start. Returns false with errno set on a read error.
+static bool hash_fd(int fd, HashAlgorithm algorithm, std::vector<uint8_t>* buffer,
+                    std::string* digest) {
+  buffer->resize(kHashChunkSize);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  Sha256 sha;
+  Xxh64 xxh;
+  xxh64_init(&xxh);
+
+  for (off_t offset = 0;;) {
+    ssize_t n = pread_full(fd, buffer->data(), buffer->size(), offset);
+    if (n < 0) {
+      return false;
+    }
+    if (algorithm == kHashSha256) {
+      sha256_update(&sha, buffer->data(), n);
+    } else {
+      xxh64_update(&xxh, buffer->data(), n);
+    }
+    if (static_cast<size_t>(n) < buffer->size()) {
+      break;
+    }
+    offset += n;
+  }
+
+  *digest = algorithm == kHashSha256 ? sha256_final(&sha) : xxh64_final(&xxh);
+  return true;
+}
+
+// Digest one file inside a bookmark, consulting the cache first.
+// Sets `not_found` for missing files; returns false with `error` set otherwise.
+static bool hash_bookmarked_file(DirectoryBookmarksPlugin* self, int dir_fd, const char* filename,
+                                 HashAlgorithm algorithm, std::vector<uint8_t>* buffer,
+                                 std::string* digest, bool* not_found, std::string* error) {
+  int fd = open_bookmarked_file(dir_fd, filename, not_found, error);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  fstat(fd, &st);
+  DigestKey key = digest_key_new(st, algorithm);
+  {
+    std::lock_guard<std::mutex> lock(self->digests->mutex);
+    auto it = self->digests->digests.find(key);
+    if (it != self->digests->digests.end()) {
+      *digest = it->second;
+      close(fd);
+      return true;
+    }
+  }
+
+  bool ok = hash_fd(fd, algorithm, buffer, digest);
+  if (!ok) {
+    *error = strerror(errno);
+  }
+
+  // Only remember the digest if the file did not change while we read it
+  struct stat after;
+  if (ok && fstat(fd, &after) == 0 && digest_key_new(after, algorithm) == key) {
+    std::lock_guard<std::mutex> lock(self->digests->mutex);
+    if (self->digests->digests.size() >= kMaxCachedDigests) {
+      self->digests->digests.erase(self->digests->digests.begin());
+    }
+    self->digests->digests.emplace(key, *digest);
+  }
+
+  close(fd);
+  return ok;
+}
+
+// Method: hashFile
+static FlMethodResponse* hash_file(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+  FlValue* algorithm_value = fl_value_lookup_string(args, "algorithm");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  }
+
+  HashAlgorithm algorithm;
+  if (!hash_algorithm_parse(algorithm_value, &algorithm)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "algorithm must be 'sha256' or 'xxh64'", nullptr));
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+  const char* filename = fl_value_get_string(filename_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  std::vector<uint8_t> buffer;
+  std::string digest;
+  bool not_found = false;
+  std::string error;
+  if (!hash_bookmarked_file(self, dir->fd, filename, algorithm, &buffer, &digest, &not_found,
+                            &error)) {
+    if (not_found) {
+      return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_null()));
+    }
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "READ_ERROR", ("Cannot read file: " + error).c_str(), nullptr));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_string_safe(digest)));
+}
+
+// Method: hashFiles
+static FlMethodResponse* hash_files(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* names_value = fl_value_lookup_string(args, "fileNames");
+  FlValue* algorithm_value = fl_value_lookup_string(args, "algorithm");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (names_value == nullptr || fl_value_get_type(names_value) != FL_VALUE_TYPE_LIST) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "fileNames must be a list of strings", nullptr));
+  }
+
+  HashAlgorithm algorithm;
+  if (!hash_algorithm_parse(algorithm_value, &algorithm)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "algorithm must be 'sha256' or 'xxh64'", nullptr));
+  }
+
+  size_t count = fl_value_get_length(names_value);
+  std::vector<std::string> names(count);
+  for (size_t i = 0; i < count; i++) {
+    FlValue* name_value = fl_value_get_list_value(names_value, i);
+    if (fl_value_get_type(name_value) != FL_VALUE_TYPE_STRING) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "fileNames must be a list of strings", nullptr));
+    }
+    names[i] = fl_value_get_string(name_value);
+  }
+
+  const char* identifier = fl_value_get_string(identifier_value);
+
+  // Get bookmarked directory
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return bookmark_not_found_error(identifier);
+  }
+
+  // Files are handed out one at a time so a few large ones don't leave
+  // other threads idle
+  std::vector<std::string> digests(count);
+  std::vector<std::string> errors(count);
+  std::vector<bool> missing(count);
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    std::vector<uint8_t> buffer;
+    for (size_t i; (i = next++) < count;) {
+      bool not_found = false;
+      if (!hash_bookmarked_file(self, dir->fd, names[i].c_str(), algorithm, &buffer,
+                                &digests[i], &not_found, &errors[i])) {
+        missing[i] = not_found;
+      }
+    }
+  };
+
+  size_t threads = std::min<size_t>({std::max(1u, std::thread::hardware_concurrency()), 8, count});
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; i++) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : workers) {
+    thread.join();
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  for (size_t i = 0; i < count; i++) {
+    if (!errors[i].empty() && !missing[i]) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "READ_ERROR", ("Cannot read file '" + names[i] + "': " + errors[i]).c_str(), nullptr));
+    }
+    fl_value_set_take(result, fl_value_new_string_safe(names[i]),
+                      missing[i] ? fl_value_new_null() : fl_value_new_string_safe(digests[i]));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Whether `filename` is a regular file in the bookmarked directory.
+// Shared by the fileExists method and the C ABI.
+static bool bookmark_file_exists(DirectoryBookmarksPlugin* self, const char* identifier,
+                                 const char* filename) {
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return false;
+  }
+
+  struct stat st;
+  return fstatat(dir->fd, filename, &st, 0) == 0 && S_ISREG(st.st_mode);
+}
+
+// Whether the bookmarked directory is writable, from a recent validation if any.
+// Shared by the hasWritePermission method and the C ABI.
+static bool bookmark_writable(DirectoryBookmarksPlugin* self, const char* identifier) {
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return false;
+  }
+
+  DirValidation cached;
+  return validation_lookup(self, identifier, dir->path, &cached)
+             ? cached.writable
+             : faccessat(dir->fd, ".", W_OK, 0) == 0;
+}
+
+// Method: fileExists
+static FlMethodResponse* file_exists(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  FlValue* filename_value = fl_value_lookup_string(args, "fileName");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  if (filename_value == nullptr || fl_value_get_type(filename_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "fileName must be a string", nullptr));
+  }
+
+  bool exists = bookmark_file_exists(self, fl_value_get_string(identifier_value),
+                                     fl_value_get_string(filename_value));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(exists)));
+}
+
+// Method: hasWritePermission
+static FlMethodResponse* has_write_permission(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+
+  if (identifier_value == nullptr || fl_value_get_type(identifier_value) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "identifier must be a string", nullptr));
+  }
+
+  bool has_permission = bookmark_writable(self, fl_value_get_string(identifier_value));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(has_permission)));
+}
+
+static void dir_probe_run(std::shared_ptr<DirProbe> probe) {
+  struct statx stx;
+  bool exists = statx(AT_FDCWD, probe->path.c_str(), 0, STATX_TYPE, &stx) == 0 &&
+                S_ISDIR(stx.stx_mode);
+  bool writable = exists && access(probe->path.c_str(), W_OK) == 0;
+
+  std::lock_guard<std::mutex> lock(probe->mutex);
+  probe->exists = exists;
+  probe->writable = writable;
+  probe->device = exists ? makedev(stx.stx_dev_major, stx.stx_dev_minor) : 0;
+  probe->done = true;
+  probe->done_cv.notify_all();
+}
+
+// Method: validateBookmarks
+//
+// Checks every bookmarked directory at once: statx for existence and device,
+// access for writability. Each probe is given `timeoutMs` (default 2000);
+// one that does not answer in time is reported as timedOut and treated as
+// missing. Results younger than `maxAgeMs` (default 0) are reused, and
+// file operations and hasWritePermission reuse them for the configured
+// `validationTtlMs`.
+static FlMethodResponse* validate_bookmarks(DirectoryBookmarksPlugin* self, FlValue* args) {
+  int64_t timeout_ms = kDefaultValidationTimeoutMs;
+  int64_t max_age_ms = 0;
+  if (args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    FlValue* timeout_value = fl_value_lookup_string(args, "timeoutMs");
+    if (timeout_value != nullptr && fl_value_get_type(timeout_value) != FL_VALUE_TYPE_NULL) {
+      if (fl_value_get_type(timeout_value) != FL_VALUE_TYPE_INT ||
+          fl_value_get_int(timeout_value) <= 0) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "INVALID_ARGUMENT", "timeoutMs must be a positive integer", nullptr));
+      }
+      timeout_ms = fl_value_get_int(timeout_value);
+    }
+
+    FlValue* max_age_value = fl_value_lookup_string(args, "maxAgeMs");
+    if (max_age_value != nullptr && fl_value_get_type(max_age_value) != FL_VALUE_TYPE_NULL) {
+      if (fl_value_get_type(max_age_value) != FL_VALUE_TYPE_INT ||
+          fl_value_get_int(max_age_value) < 0) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "INVALID_ARGUMENT", "maxAgeMs must be a non-negative integer", nullptr));
+      }
+      max_age_ms = fl_value_get_int(max_age_value);
+    }
+  }
+
+  std::vector<std::pair<std::string, std::string>> bookmarks;
+  {
+    std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+    for (const auto& [id, bookmark] : store_get(self)["bookmarks"].items()) {
+      bookmarks.emplace_back(id, bookmark.value("path", ""));
+    }
+  }
+
+  Validations* validations = self->validations;
+  uint64_t now = monotonic_ns();
+  std::unordered_map<std::string, DirValidation> results;
+  std::unordered_map<std::string, std::shared_ptr<DirProbe>> probes;
+  {
+    std::lock_guard<std::mutex> lock(validations->mutex);
+    for (const auto& [id, path] : bookmarks) {
+      auto cached = validations->results.find(id);
+      if (cached != validations->results.end() && cached->second.path == path &&
+          now - cached->second.checked_ns <= static_cast<uint64_t>(max_age_ms) * 1000000) {
+        results[id] = cached->second;
+        continue;
+      }
+
+      // Bookmarks of the same directory share one probe
+      std::shared_ptr<DirProbe>& probe = validations->probing[path];
+      if (!probe) {
+        probe = std::make_shared<DirProbe>();
+        probe->path = path;
+        std::thread(dir_probe_run, probe).detach();
+      }
+      probes[path] = probe;
+    }
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  for (auto& [path, probe] : probes) {
+    std::unique_lock<std::mutex> lock(probe->mutex);
+    probe->done_cv.wait_until(lock, deadline, [&probe] { return probe->done; });
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  std::lock_guard<std::mutex> lock(validations->mutex);
+  now = monotonic_ns();
+  for (const auto& [id, path] : bookmarks) {
+    auto probe = probes.find(path);
+    if (probe != probes.end()) {
+      DirValidation& validation = results[id];
+      validation.path = path;
+      validation.checked_ns = now;
+
+      std::lock_guard<std::mutex> probe_lock(probe->second->mutex);
+      if (probe->second->done) {
+        validation.exists = probe->second->exists;
+        validation.writable = probe->second->writable;
+        validation.device = probe->second->device;
+        auto running = validations->probing.find(path);
+        if (running != validations->probing.end() && running->second == probe->second) {
+          validations->probing.erase(running);
+        }
+      } else {
+        validation.timed_out = true;
+      }
+    }
+
+    const DirValidation& validation = results[id];
+    FlValue* entry = fl_value_new_map();
+    fl_value_set_string_take(entry, "exists", fl_value_new_bool(validation.exists));
+    fl_value_set_string_take(entry, "writable", fl_value_new_bool(validation.writable));
+    fl_value_set_string_take(entry, "device", fl_value_new_int(static_cast<int64_t>(validation.device)));
+    fl_value_set_string_take(entry, "timedOut", fl_value_new_bool(validation.timed_out));
+    fl_value_set_string_take(result, id.c_str(), entry);
+  }
+
+  // Bookmarks deleted since the last sweep drop out here
+  validations->results = std::move(results);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Method: requestWritePermission
+static FlMethodResponse* request_write_permission(DirectoryBookmarksPlugin* self, FlValue* args) {
+  // On Linux desktop, we don't need runtime permission dialogs
+  // Just return the current write permission status
+  return has_write_permission(self, args);
+}
+
+// Method: configure
+static FlMethodResponse* configure(DirectoryBookmarksPlugin* self, FlValue* args) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "configure expects a map of options", nullptr));
+  }
+
+  Dispatcher* dispatcher = self->dispatcher;
+
+  FlValue* threads_value = fl_value_lookup_string(args, "workerThreads");
+  if (threads_value != nullptr && fl_value_get_type(threads_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(threads_value) != FL_VALUE_TYPE_INT ||
+        fl_value_get_int(threads_value) < 1) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "workerThreads must be a positive integer", nullptr));
+    }
+
+    dispatcher->max_threads = static_cast<guint>(fl_value_get_int(threads_value));
+    if (dispatcher->pool != nullptr) {
+      g_thread_pool_set_max_threads(dispatcher->pool, dispatcher->max_threads, nullptr);
+    }
+  }
+
+  FlValue* async_value = fl_value_lookup_string(args, "asyncDispatch");
+  if (async_value != nullptr && fl_value_get_type(async_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(async_value) != FL_VALUE_TYPE_BOOL) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "asyncDispatch must be a bool", nullptr));
+    }
+
+    dispatcher->async = fl_value_get_bool(async_value);
+  }
+
+  FlValue* ttl_value = fl_value_lookup_string(args, "validationTtlMs");
+  if (ttl_value != nullptr && fl_value_get_type(ttl_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(ttl_value) != FL_VALUE_TYPE_INT || fl_value_get_int(ttl_value) < 0 ||
+        fl_value_get_int(ttl_value) > G_MAXUINT) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "validationTtlMs must be a non-negative integer", nullptr));
+    }
+
+    std::lock_guard<std::mutex> lock(self->validations->mutex);
+    self->validations->ttl_ms = static_cast<guint>(fl_value_get_int(ttl_value));
+  }
+
+  BookmarkStore* store = self->store;
+
+  FlValue* durability_value = fl_value_lookup_string(args, "durability");
+  if (durability_value != nullptr && fl_value_get_type(durability_value) != FL_VALUE_TYPE_NULL) {
+    Durability durability;
+    if (!durability_parse(self, durability_value, &durability)) {
+      return durability_error();
+    }
+
+    store->durability = durability;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(store->mutex);
+
+  FlValue* multi_process_value = fl_value_lookup_string(args, "multiProcess");
+  if (multi_process_value != nullptr &&
+      fl_value_get_type(multi_process_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(multi_process_value) != FL_VALUE_TYPE_BOOL) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "multiProcess must be a bool", nullptr));
+    }
+
+    bool multi_process = fl_value_get_bool(multi_process_value);
+    if (multi_process && !store->multi_process) {
+      if (!shared_store_open(store)) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "WRITE_ERROR", ("Failed to open " + store->lock_path).c_str(), nullptr));
+      }
+
+      // Write anything queued by write-behind under the lock, then load
+      // afresh so the resident copy starts out matching a known generation
+      store->multi_process = true;
+      {
+        StoreWriteGuard guard(self);
+        if (!store_flush(self)) {
+          return FL_METHOD_RESPONSE(fl_method_error_response_new(
+              "WRITE_ERROR", "Failed to write pending bookmark changes", nullptr));
+        }
+      }
+      store->loaded = false;
+    } else if (!multi_process && store->multi_process) {
+      store->multi_process = false;
+      shared_store_close(store);
+      // Fall back to the inotify and file identity checks from a clean slate
+      store->loaded = false;
+    }
+  }
+
+  StoreWriteGuard guard(self);
+
+  FlValue* max_records_value = fl_value_lookup_string(args, "journalMaxRecords");
+  if (max_records_value != nullptr && fl_value_get_type(max_records_value) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(max_records_value) > 0) {
+    store->journal_max_records = fl_value_get_int(max_records_value);
+  }
+
+  FlValue* max_bytes_value = fl_value_lookup_string(args, "journalMaxBytes");
+  if (max_bytes_value != nullptr && fl_value_get_type(max_bytes_value) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(max_bytes_value) > 0) {
+    store->journal_max_bytes = fl_value_get_int(max_bytes_value);
+  }
+
+  FlValue* journal_value = fl_value_lookup_string(args, "journal");
+  if (journal_value != nullptr && fl_value_get_type(journal_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(journal_value) != FL_VALUE_TYPE_BOOL) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "journal must be a bool", nullptr));
+    }
+
+    bool journal = fl_value_get_bool(journal_value);
+    if (store->journal && !journal) {
+      // Leave a self-contained snapshot behind when going back to plain mode
+      store_get(self);
+      if (store->log_records > 0 && !store_write_snapshot(store)) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "WRITE_ERROR", "Failed to fold the journal into the snapshot", nullptr));
+      }
+    }
+    store->journal = journal;
+  }
+
+  FlValue* write_behind_value = fl_value_lookup_string(args, "writeBehindMs");
+  if (write_behind_value != nullptr && fl_value_get_type(write_behind_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(write_behind_value) != FL_VALUE_TYPE_INT ||
+        fl_value_get_int(write_behind_value) < 0) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "writeBehindMs must be a non-negative integer", nullptr));
+    }
+
+    store->write_behind_ms = static_cast<guint>(fl_value_get_int(write_behind_value));
+    if (store->write_behind_ms == 0 && !store_flush(self)) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "WRITE_ERROR", "Failed to write pending bookmark changes", nullptr));
+    }
+  }
+
+  FlValue* format_value = fl_value_lookup_string(args, "snapshotFormat");
+  if (format_value != nullptr && fl_value_get_type(format_value) != FL_VALUE_TYPE_NULL) {
+    const char* format = fl_value_get_type(format_value) == FL_VALUE_TYPE_STRING
+                             ? fl_value_get_string(format_value)
+                             : "";
+    if (strcmp(format, "json") != 0 && strcmp(format, "binary") != 0) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "snapshotFormat must be \"json\" or \"binary\"", nullptr));
+    }
+
+    bool binary = strcmp(format, "binary") == 0;
+    store_refresh(self);
+    store->format_configured = true;
+
+    // Migrate a snapshot left in the other format right away
+    bool stale = binary ? store->snapshot_identity.present : store->bin_identity.present;
+    store->binary = binary;
+    if (stale && !store_write_snapshot(store)) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "WRITE_ERROR", "Failed to migrate the bookmark snapshot", nullptr));
+    }
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(true)));
+}
+
+static FlMethodResponse* dispatch_method_call(DirectoryBookmarksPlugin* self,
+                                              const gchar* method,
+                                              FlValue* args);
+
+// Methods that only touch the bookmark store. executeBatch holds the store
+// lock across consecutive runs of these and drops it for anything else, so
+// file I/O in a batch never blocks other store calls.
+static bool batch_method_uses_store(const char* method) {
+  static const char* const kStoreMethods[] = {
+      "createBookmark",          "listBookmarks",      "getBookmark",
+      "bookmarkExists",          "deleteBookmark",     "updateBookmarkMetadata",
+      "patchBookmarkMetadata",   "findBookmarkByPath", "findContainingBookmark",
+      "flush",
+  };
+  for (const char* name : kStoreMethods) {
+    if (strcmp(method, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static const char* batch_operation_method(FlValue* operation) {
+  FlValue* method_value = fl_value_get_type(operation) == FL_VALUE_TYPE_MAP
+      ? fl_value_lookup_string(operation, "method") : nullptr;
+  if (method_value == nullptr || fl_value_get_type(method_value) != FL_VALUE_TYPE_STRING) {
+    return nullptr;
+  }
+  return fl_value_get_string(method_value);
+}
+
+// Method: executeBatch
+//
+// Runs a list of {method, arguments} operations in one call. Each run of
+// consecutive bookmark operations sees a single view of the store and is
+// persisted once, instead of after each operation; file operations between
+// runs execute without the store lock. With `atomic`, the batch may only
+// contain bookmark operations, stops at the first failed one and leaves the
+// store exactly as it was.
+static FlMethodResponse* execute_batch(DirectoryBookmarksPlugin* self, FlValue* args) {
+  FlValue* operations_value = fl_value_lookup_string(args, "operations");
+  FlValue* atomic_value = fl_value_lookup_string(args, "atomic");
+
+  if (operations_value == nullptr || fl_value_get_type(operations_value) != FL_VALUE_TYPE_LIST) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "INVALID_ARGUMENT", "operations must be a list", nullptr));
+  }
+
+  bool atomic = atomic_value != nullptr && fl_value_get_type(atomic_value) == FL_VALUE_TYPE_BOOL &&
+                fl_value_get_bool(atomic_value);
+  size_t count = fl_value_get_length(operations_value);
+
+  // Files written by an atomic batch could not be rolled back with the store
+  if (atomic) {
+    for (size_t i = 0; i < count; i++) {
+      const char* method = batch_operation_method(fl_value_get_list_value(operations_value, i));
+      if (method != nullptr && !batch_method_uses_store(method)) {
+        return FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "INVALID_ARGUMENT",
+            ("Atomic batches can only contain bookmark operations, not '" +
+             std::string(method) + "'").c_str(),
+            nullptr));
+      }
+    }
+  }
+
+  BookmarkStore* store = self->store;
+  std::unique_lock<std::recursive_mutex> lock(store->mutex, std::defer_lock);
+  std::optional<StoreWriteGuard> guard;
+  bool sync = commit_sync_requested(args);
+  json snapshot;
+
+  auto begin_run = [&]() {
+    lock.lock();
+    guard.emplace(self);
+    store->batch_depth++;
+  };
+
+  // Close the current run, persisting its changes unless they are discarded
+  auto end_run = [&](bool discard) {
+    store->batch_depth--;
+    std::set<std::string> changed;
+    changed.swap(store->batch_changes);
+
+    bool saved = true;
+    if (discard) {
+      store->data = std::move(snapshot);
+      store->path_index.valid = false;
+      store->query_index.valid = false;
+      store_clear_values(store);
+    } else if (!changed.empty()) {
+      saved = store_commit_changes(self, changed, sync);
+    }
+    guard.reset();
+    lock.unlock();
+    return saved;
+  };
+
+  if (atomic) {
+    begin_run();
+    snapshot = store_get(self);
+  }
+
+  bool failed = false;
+  g_autoptr(FlValue) results = fl_value_new_list();
+
+  for (size_t i = 0; i < count && !(atomic && failed); i++) {
+    FlValue* operation = fl_value_get_list_value(operations_value, i);
+    const char* method = batch_operation_method(operation);
+    g_autoptr(FlValue) result = fl_value_new_map();
+
+    if (method == nullptr || strcmp(method, "executeBatch") == 0) {
+      fl_value_set_string_take(result, "errorCode", fl_value_new_string("INVALID_ARGUMENT"));
+      fl_value_set_string_take(result, "errorMessage",
+                               fl_value_new_string("Each operation needs a method other than executeBatch"));
+      fl_value_append(results, result);
+      failed = true;
+      continue;
+    }
+
+    bool uses_store = batch_method_uses_store(method);
+    if (uses_store && !lock.owns_lock()) {
+      begin_run();
+    } else if (!uses_store && lock.owns_lock() && !end_run(false)) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "WRITE_ERROR", "Failed to save bookmarks after batch", nullptr));
+    }
+
+    FlValue* operation_args = fl_value_lookup_string(operation, "arguments");
+    g_autoptr(FlValue) empty_args = nullptr;
+    if (operation_args == nullptr || fl_value_get_type(operation_args) != FL_VALUE_TYPE_MAP) {
+      empty_args = fl_value_new_map();
+      operation_args = empty_args;
+    }
+
+    g_autoptr(FlMethodResponse) response = dispatch_method_call(self, method, operation_args);
+
+    if (FL_IS_METHOD_SUCCESS_RESPONSE(response)) {
+      FlValue* value = fl_method_success_response_get_result(FL_METHOD_SUCCESS_RESPONSE(response));
+      fl_value_set_string(result, "result", value);
+    } else if (FL_IS_METHOD_ERROR_RESPONSE(response)) {
+      FlMethodErrorResponse* error = FL_METHOD_ERROR_RESPONSE(response);
+      fl_value_set_string_take(result, "errorCode",
+                               fl_value_new_string(fl_method_error_response_get_code(error)));
+      const gchar* message = fl_method_error_response_get_message(error);
+      fl_value_set_string_take(result, "errorMessage",
+                               message != nullptr ? fl_value_new_string(message) : fl_value_new_null());
+      failed = true;
+    } else {
+      fl_value_set_string_take(result, "errorCode", fl_value_new_string("NOT_IMPLEMENTED"));
+      fl_value_set_string_take(result, "errorMessage", fl_value_new_null());
+      failed = true;
+    }
+
+    fl_value_append(results, result);
+  }
+
+  if (lock.owns_lock() && !end_run(atomic && failed)) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "WRITE_ERROR", "Failed to save bookmarks after batch", nullptr));
+  }
+
+  g_autoptr(FlValue) response = fl_value_new_map();
+  fl_value_set_string(response, "results", results);
+  fl_value_set_string_take(response, "committed", fl_value_new_bool(!(atomic && failed)));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(response));
+}
 
+static FlMethodResponse* invoke_method(DirectoryBookmarksPlugin* self,
+                                       const gchar* method,
+                                       FlValue* args) {
   if (strcmp(method, "createBookmark") == 0) {
-    response = create_bookmark(args);
+    return create_bookmark(self, args);
   } else if (strcmp(method, "listBookmarks") == 0) {
-    response = list_bookmarks();
+    return list_bookmarks(self, args);
   } else if (strcmp(method, "getBookmark") == 0) {
-    response = get_bookmark(args);
+    return get_bookmark(self, args);
   } else if (strcmp(method, "bookmarkExists") == 0) {
-    response = bookmark_exists(args);
+    return bookmark_exists(self, args);
   } else if (strcmp(method, "deleteBookmark") == 0) {
-    response = delete_bookmark(args);
+    return delete_bookmark(self, args);
   } else if (strcmp(method, "updateBookmarkMetadata") == 0) {
-    response = update_bookmark_metadata(args);
+    return update_bookmark_metadata(self, args);
+  } else if (strcmp(method, "patchBookmarkMetadata") == 0) {
+    return patch_bookmark_metadata(self, args);
+  } else if (strcmp(method, "validateBookmarks") == 0) {
+    return validate_bookmarks(self, args);
+  } else if (strcmp(method, "findBookmarkByPath") == 0) {
+    return find_bookmark_by_path(self, args);
+  } else if (strcmp(method, "findContainingBookmark") == 0) {
+    return find_containing_bookmark(self, args);
+  } else if (strcmp(method, "flush") == 0) {
+    return flush(self);
+  } else if (strcmp(method, "getStats") == 0) {
+    return get_stats(self);
+  } else if (strcmp(method, "resetStats") == 0) {
+    return reset_stats(self);
+  } else if (strcmp(method, "executeBatch") == 0) {
+    return execute_batch(self, args);
   } else if (strcmp(method, "saveFile") == 0) {
-    response = save_file(args);
+    return save_file(self, args);
+  } else if (strcmp(method, "saveFiles") == 0) {
+    return save_files(self, args);
+  } else if (strcmp(method, "beginWrite") == 0) {
+    return begin_write(self, args);
+  } else if (strcmp(method, "appendChunk") == 0) {
+    return append_chunk(self, args);
+  } else if (strcmp(method, "commitWrite") == 0) {
+    return commit_write(self, args);
+  } else if (strcmp(method, "abortWrite") == 0) {
+    return abort_write(self, args);
   } else if (strcmp(method, "readFile") == 0) {
-    response = read_file(args);
+    return read_file(self, args);
+  } else if (strcmp(method, "readFileRange") == 0) {
+    return read_file_range(self, args);
+  } else if (strcmp(method, "readFiles") == 0) {
+    return read_files(self, args);
+  } else if (strcmp(method, "startReadStream") == 0) {
+    return start_read_stream(self, args);
+  } else if (strcmp(method, "startWalk") == 0) {
+    return start_walk(self, args);
+  } else if (strcmp(method, "startSearch") == 0) {
+    return start_search(self, args);
+  } else if (strcmp(method, "getBookmarkUsage") == 0) {
+    return get_bookmark_usage(self, args);
+  } else if (strcmp(method, "startWatch") == 0) {
+    return start_watch(self, args);
+  } else if (strcmp(method, "cancelStream") == 0) {
+    return cancel_stream(self, args);
   } else if (strcmp(method, "listFiles") == 0) {
-    response = list_files(args);
+    return list_files(self, args);
+  } else if (strcmp(method, "listFilesPaged") == 0) {
+    return list_files_paged(self, args);
+  } else if (strcmp(method, "listFilesDetailed") == 0) {
+    return list_files_detailed(self, args);
   } else if (strcmp(method, "deleteFile") == 0) {
-    response = delete_file(args);
+    return delete_file(self, args);
+  } else if (strcmp(method, "copyFile") == 0) {
+    return copy_file(self, args);
+  } else if (strcmp(method, "moveFile") == 0) {
+    return move_file(self, args);
+  } else if (strcmp(method, "hashFile") == 0) {
+    return hash_file(self, args);
+  } else if (strcmp(method, "hashFiles") == 0) {
+    return hash_files(self, args);
   } else if (strcmp(method, "fileExists") == 0) {
-    response = file_exists(args);
+    return file_exists(self, args);
   } else if (strcmp(method, "hasWritePermission") == 0) {
-    response = has_write_permission(args);
+    return has_write_permission(self, args);
   } else if (strcmp(method, "requestWritePermission") == 0) {
-    response = request_write_permission(args);
+    return request_write_permission(self, args);
   } else {
-    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
   }
 
+}
+
+// Run a single method call to completion on the calling thread
+static FlMethodResponse* dispatch_method_call(DirectoryBookmarksPlugin* self,
+                                              const gchar* method,
+                                              FlValue* args) {
+  uint64_t start = monotonic_ns();
+  FlMethodResponse* response = invoke_method(self, method, args);
+
+  // Unknown methods are left out so the table only holds real handlers
+  bool error = FL_IS_METHOD_ERROR_RESPONSE(response);
+  if (error || FL_IS_METHOD_SUCCESS_RESPONSE(response)) {
+    stats_record_call(self, method, monotonic_ns() - start, error);
+  }
+
+  return response;
+}
+
+// A unit of work waiting for, or running on, the worker pool.
+// `run` must hand any result to the main context itself before returning.
+struct DispatchJob {
+  std::string lane;
+  std::function<void()> run;
+};
+
+static void dispatcher_worker(gpointer data, gpointer user_data) {
+  auto* job = static_cast<DispatchJob*>(data);
+  Dispatcher* dispatcher = static_cast<Dispatcher*>(user_data);
+
+  // The job posts its result before the next job on this lane starts, so
+  // replies for one bookmark reach Dart in the order the calls were made
+  job->run();
+
+  DispatchJob* next = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(dispatcher->mutex);
+    auto it = dispatcher->lanes.find(job->lane);
+    it->second.pop_front();
+    if (it->second.empty()) {
+      dispatcher->lanes.erase(it);
+    } else {
+      next = it->second.front();
+    }
+  }
+  delete job;
+
+  if (next != nullptr) {
+    g_thread_pool_push(dispatcher->pool, next, nullptr);
+  }
+}
+
+// Queue work on the worker pool, returning false if no pool is available
+static bool dispatcher_submit(DirectoryBookmarksPlugin* self, std::string lane,
+                              std::function<void()> run) {
+  Dispatcher* dispatcher = self->dispatcher;
+
+  if (dispatcher->pool == nullptr) {
+    dispatcher->pool = g_thread_pool_new(dispatcher_worker, dispatcher,
+                                         dispatcher->max_threads, FALSE, nullptr);
+    if (dispatcher->pool == nullptr) {
+      return false;
+    }
+  }
+
+  auto* job = new DispatchJob();
+  job->lane = std::move(lane);
+  job->run = std::move(run);
+
+  bool start = false;
+  {
+    std::lock_guard<std::mutex> lock(dispatcher->mutex);
+    auto& queue = dispatcher->lanes[job->lane];
+    queue.push_back(job);
+    start = queue.size() == 1;
+  }
+
+  if (start) {
+    g_thread_pool_push(dispatcher->pool, job, nullptr);
+  }
+
+  return true;
+}
+
+// A method call result waiting to be delivered on the main context
+struct PendingCall {
+  DirectoryBookmarksPlugin* self;
+  FlMethodCall* method_call;
+  FlMethodResponse* response = nullptr;
+};
+
+static gboolean pending_call_respond_cb(gpointer user_data) {
+  auto* call = static_cast<PendingCall*>(user_data);
+
+  fl_method_call_respond(call->method_call, call->response, nullptr);
+
+  g_object_unref(call->response);
+  g_object_unref(call->method_call);
+  g_object_unref(call->self);
+  delete call;
+
+  return G_SOURCE_REMOVE;
+}
+
+// Pick the lane for a method call from its arguments
+static std::string method_call_lane(FlValue* args) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return std::string();
+  }
+
+  FlValue* identifier_value = fl_value_lookup_string(args, "identifier");
+  if (identifier_value != nullptr &&
+      fl_value_get_type(identifier_value) == FL_VALUE_TYPE_STRING) {
+    return fl_value_get_string(identifier_value);
+  }
+
+  FlValue* session_value = fl_value_lookup_string(args, "session");
+  if (session_value != nullptr && fl_value_get_type(session_value) == FL_VALUE_TYPE_INT) {
+    // Chunks of one upload stay ordered without blocking its bookmark
+    return "session:" + std::to_string(fl_value_get_int(session_value));
+  }
+
+  return std::string();
+}
+
+// Queue a method call on the worker pool, returning false if no pool is available
+static bool dispatcher_enqueue(DirectoryBookmarksPlugin* self, FlMethodCall* method_call) {
+  auto* call = new PendingCall();
+  call->self = DIRECTORY_BOOKMARKS_PLUGIN(g_object_ref(self));
+  call->method_call = static_cast<FlMethodCall*>(g_object_ref(method_call));
+
+  bool queued = dispatcher_submit(self, method_call_lane(fl_method_call_get_args(method_call)),
+                                  [call]() {
+    call->response = dispatch_method_call(call->self,
+                                          fl_method_call_get_name(call->method_call),
+                                          fl_method_call_get_args(call->method_call));
+    g_main_context_invoke_full(nullptr, G_PRIORITY_DEFAULT, pending_call_respond_cb,
+                               call, nullptr);
+  });
+
+  if (!queued) {
+    g_object_unref(call->method_call);
+    g_object_unref(call->self);
+    delete call;
+  }
+
+  return queued;
+}
+
+// MethodChannel handler
+static void directory_bookmarks_plugin_handle_method_call(
+    DirectoryBookmarksPlugin* self,
+    FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  // Configuration always applies inline so it takes effect for the next call
+  if (strcmp(method, "configure") == 0) {
+    g_autoptr(FlMethodResponse) response = configure(self, args);
+    fl_method_call_respond(method_call, response, nullptr);
+    return;
+  }
+
+  if (self->dispatcher->async && dispatcher_enqueue(self, method_call)) {
+    return;
+  }
+
+  g_autoptr(FlMethodResponse) response = dispatch_method_call(self, method, args);
   fl_method_call_respond(method_call, response, nullptr);
 }
 
+// Raw binary file channel.
+//
+// File payloads on the method channel go through the standard codec and are
+// copied several times on the way. This channel carries them as raw bytes
+// behind a fixed little-endian header instead:
+//
+//   Request:  u8 op, u8 compression, u8 level, u8 durability,
+//             u32 identifier length, u32 name length,
+//             u32 reserved, u64 offset, u64 length,
+//             identifier bytes, file name bytes, payload
+//   Response: u8 status, u8[7] reserved, then the payload on success or a
+//             UTF-8 error message otherwise
+//
+// A read is pread straight into the response buffer, so the bytes are copied
+// once on the native side. A non-zero compression byte (a FileCompression)
+// gzips the payload of a write on its way to disk, with `level` 1-9 or 0 for
+// the default, and decompresses the whole file on a read. The file is deliberately not mmapped: truncation
+// by another process while the engine copies the mapping would SIGBUS.
+// A write's durability byte is a Durability plus one, or 0 for the default
+// set through configure.
+static constexpr size_t kBinaryRequestHeaderSize = 32;
+static constexpr size_t kBinaryResponseHeaderSize = 8;
+
+enum BinaryOp : uint8_t {
+  kBinaryOpRead = 1,   // Read `length` bytes at `offset` (UINT64_MAX: to the end)
+  kBinaryOpWrite = 2,  // Replace the file with the payload, like saveFile
+};
+
+enum BinaryStatus : uint8_t {
+  kBinaryStatusOk = 0,
+  kBinaryStatusFileNotFound = 1,
+  kBinaryStatusBookmarkNotFound = 2,
+  kBinaryStatusPermissionDenied = 3,
+  kBinaryStatusInvalidArgument = 4,
+  kBinaryStatusIoError = 5,
+};
+
+static GBytes* binary_response_new(BinaryStatus status, const std::string& message = "") {
+  size_t size = kBinaryResponseHeaderSize + message.size();
+  auto* buffer = static_cast<uint8_t*>(g_malloc0(size));
+  buffer[0] = status;
+  memcpy(buffer + kBinaryResponseHeaderSize, message.data(), message.size());
+  return g_bytes_new_take(buffer, size);
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+         static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+static uint64_t read_le64(const uint8_t* p) {
+  return static_cast<uint64_t>(read_le32(p)) | static_cast<uint64_t>(read_le32(p + 4)) << 32;
+}
+
+static GBytes* binary_read(DirectoryBookmarksPlugin* self, const char* identifier,
+                           const char* filename, uint64_t offset, uint64_t length,
+                           FileCompression compression) {
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return binary_response_new(kBinaryStatusBookmarkNotFound,
+        "Bookmark with identifier '" + std::string(identifier) + "' not found");
+  }
+
+  bool not_found = false;
+  std::string error;
+  int fd = open_bookmarked_file(dir->fd, filename, &not_found, &error);
+  if (fd < 0) {
+    return not_found ? binary_response_new(kBinaryStatusFileNotFound)
+                     : binary_response_new(kBinaryStatusPermissionDenied, error);
+  }
+
+  if (compression == kCompressionGzip) {
+    GByteArray* response = g_byte_array_sized_new(kBinaryResponseHeaderSize);
+    g_byte_array_set_size(response, kBinaryResponseHeaderSize);
+    memset(response->data, 0, kBinaryResponseHeaderSize);
+
+    bool ok = read_decompressed(fd, response, &error);
+    close(fd);
+
+    if (!ok) {
+      g_byte_array_unref(response);
+      return binary_response_new(kBinaryStatusIoError, error);
+    }
+
+    response->data[0] = kBinaryStatusOk;
+    stats_count_bytes(self, response->len - kBinaryResponseHeaderSize, 0);
+    return g_byte_array_free_to_bytes(response);
+  }
+
+  struct stat st;
+  fstat(fd, &st);
+  uint64_t size = st.st_size;
+  uint64_t available = offset < size ? size - offset : 0;
+  length = std::min(length, available);
+
+  auto* buffer = static_cast<uint8_t*>(g_malloc0(kBinaryResponseHeaderSize + length));
+  ssize_t n = pread_full(fd, buffer + kBinaryResponseHeaderSize, length, offset);
+  int saved_errno = errno;
+  close(fd);
+
+  if (n < 0) {
+    g_free(buffer);
+    return binary_response_new(kBinaryStatusIoError, strerror(saved_errno));
+  }
+
+  buffer[0] = kBinaryStatusOk;
+  stats_count_bytes(self, n, 0);
+  return g_bytes_new_take(buffer, kBinaryResponseHeaderSize + n);
+}
+
+static GBytes* binary_write(DirectoryBookmarksPlugin* self, const char* identifier,
+                            const char* filename, const uint8_t* data, size_t length,
+                            FileCompression compression, int level, Durability durability) {
+  std::shared_ptr<BookmarkDir> dir = bookmark_dir_get(self, identifier);
+  if (dir == nullptr) {
+    return binary_response_new(kBinaryStatusBookmarkNotFound,
+        "Bookmark with identifier '" + std::string(identifier) + "' not found");
+  }
+
+  // A directory without write permission fails the open
+  bool cannot_open = false;
+  std::string error;
+  bool ok = file_write(dir->fd, filename, data, length, compression, level, durability,
+                       &cannot_open, &error);
+  if (cannot_open) {
+    return binary_response_new(kBinaryStatusPermissionDenied, error);
+  }
+
+  if (!ok) {
+    return binary_response_new(kBinaryStatusIoError, error);
+  }
+
+  stats_count_bytes(self, 0, length);
+  return binary_response_new(kBinaryStatusOk);
+}
+
+// Decode and execute one binary channel request
+static GBytes* binary_handle_request(DirectoryBookmarksPlugin* self, GBytes* message) {
+  gsize size = 0;
+  const auto* data = static_cast<const uint8_t*>(g_bytes_get_data(message, &size));
+
+  if (data == nullptr || size < kBinaryRequestHeaderSize) {
+    return binary_response_new(kBinaryStatusInvalidArgument, "Truncated request header");
+  }
+
+  uint8_t op = data[0];
+  uint8_t compression = data[1];
+  int level = data[2] == 0 ? -1 : data[2];
+  uint8_t durability = data[3];
+  uint64_t identifier_length = read_le32(data + 4);
+  uint64_t name_length = read_le32(data + 8);
+  uint64_t offset = read_le64(data + 16);
+  uint64_t length = read_le64(data + 24);
+
+  if (kBinaryRequestHeaderSize + identifier_length + name_length > size) {
+    return binary_response_new(kBinaryStatusInvalidArgument, "Truncated request body");
+  }
+
+  const char* body = reinterpret_cast<const char*>(data + kBinaryRequestHeaderSize);
+  std::string identifier(body, identifier_length);
+  std::string filename(body + identifier_length, name_length);
+  const uint8_t* payload = data + kBinaryRequestHeaderSize + identifier_length + name_length;
+  size_t payload_length = size - (kBinaryRequestHeaderSize + identifier_length + name_length);
+
+  if (identifier.empty() || filename.empty() ||
+      offset > static_cast<uint64_t>(std::numeric_limits<off_t>::max())) {
+    return binary_response_new(kBinaryStatusInvalidArgument, "Invalid identifier, name or offset");
+  }
+
+  // Compressed files are only ever read whole
+  if (compression > kCompressionGzip || level > 9 ||
+      (compression != kCompressionNone && op == kBinaryOpRead && offset != 0)) {
+    return binary_response_new(kBinaryStatusInvalidArgument, "Invalid compression");
+  }
+
+  if (durability > kDurabilityDurable + 1) {
+    return binary_response_new(kBinaryStatusInvalidArgument, "Invalid durability");
+  }
+  Durability write_durability = durability == 0
+      ? static_cast<Durability>(self->store->durability.load())
+      : static_cast<Durability>(durability - 1);
+
+  uint64_t start = monotonic_ns();
+  GBytes* response;
+  const char* method;
+  switch (op) {
+    case kBinaryOpRead:
+      method = "binaryRead";
+      response = binary_read(self, identifier.c_str(), filename.c_str(), offset, length,
+                             static_cast<FileCompression>(compression));
+      break;
+    case kBinaryOpWrite:
+      method = "binaryWrite";
+      response = binary_write(self, identifier.c_str(), filename.c_str(), payload,
+                              payload_length, static_cast<FileCompression>(compression), level,
+                              write_durability);
+      break;
+    default:
+      return binary_response_new(kBinaryStatusInvalidArgument, "Unknown operation");
+  }
+
+  // A missing file is an ordinary result, as it is for readFile
+  uint8_t status = static_cast<const uint8_t*>(g_bytes_get_data(response, nullptr))[0];
+  stats_record_call(self, method, monotonic_ns() - start, status > kBinaryStatusFileNotFound);
+  return response;
+}
+
+// A binary channel reply waiting to be sent on the main context
+struct PendingBinaryResponse {
+  FlBinaryMessenger* messenger;
+  FlBinaryMessengerResponseHandle* handle;
+  GBytes* response = nullptr;
+};
+
+static gboolean pending_binary_respond_cb(gpointer user_data) {
+  auto* pending = static_cast<PendingBinaryResponse*>(user_data);
+
+  fl_binary_messenger_send_response(pending->messenger, pending->handle,
+                                    pending->response, nullptr);
+
+  g_bytes_unref(pending->response);
+  g_object_unref(pending->handle);
+  g_object_unref(pending->messenger);
+  delete pending;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void binary_message_cb(FlBinaryMessenger* messenger, const gchar* channel,
+                              GBytes* message, FlBinaryMessengerResponseHandle* response_handle,
+                              gpointer user_data) {
+  DirectoryBookmarksPlugin* self = DIRECTORY_BOOKMARKS_PLUGIN(user_data);
+
+  if (self->dispatcher->async) {
+    auto* pending = new PendingBinaryResponse();
+    pending->messenger = static_cast<FlBinaryMessenger*>(g_object_ref(messenger));
+    pending->handle = static_cast<FlBinaryMessengerResponseHandle*>(g_object_ref(response_handle));
+
+    // Requests share the lane of the bookmark they target
+    gsize size = 0;
+    const auto* data = static_cast<const uint8_t*>(g_bytes_get_data(message, &size));
+    std::string lane;
+    if (data != nullptr && size >= kBinaryRequestHeaderSize &&
+        kBinaryRequestHeaderSize + read_le32(data + 4) <= size) {
+      lane.assign(reinterpret_cast<const char*>(data + kBinaryRequestHeaderSize),
+                  read_le32(data + 4));
+    }
+
+    g_object_ref(self);
+    GBytes* request = g_bytes_ref(message);
+    bool queued = dispatcher_submit(self, lane, [self, request, pending]() {
+      pending->response = binary_handle_request(self, request);
+      g_bytes_unref(request);
+      object_unref_on_main(self);
+      g_main_context_invoke_full(nullptr, G_PRIORITY_DEFAULT, pending_binary_respond_cb,
+                                 pending, nullptr);
+    });
+    if (queued) {
+      return;
+    }
+
+    g_bytes_unref(request);
+    g_object_unref(self);
+    g_object_unref(pending->handle);
+    g_object_unref(pending->messenger);
+    delete pending;
+  }
+
+  g_autoptr(GBytes) response = binary_handle_request(self, message);
+  fl_binary_messenger_send_response(messenger, response_handle, response, nullptr);
+}
+
+// Instance the C ABI works on: the most recently registered plugin.
+// C ABI calls hold `ffi_mutex` shared for their duration; dispose takes it
+// exclusively to unpublish the instance before tearing it down.
+static std::shared_mutex ffi_mutex;
+static DirectoryBookmarksPlugin* ffi_plugin = nullptr;
+
 static void directory_bookmarks_plugin_dispose(GObject* object) {
+  DirectoryBookmarksPlugin* self = DIRECTORY_BOOKMARKS_PLUGIN(object);
+
+  {
+    std::unique_lock<std::shared_mutex> lock(ffi_mutex);
+    if (ffi_plugin == self) {
+      ffi_plugin = nullptr;
+    }
+  }
+
+  if (self->events != nullptr) {
+    fl_event_channel_set_stream_handlers(self->events, nullptr, nullptr, nullptr, nullptr);
+    g_object_unref(self->events);
+    self->events = nullptr;
+  }
+
+  if (self->write_sessions != nullptr) {
+    // Uploads that were never committed are discarded
+    for (auto& [id, session] : self->write_sessions->open) {
+      atomic_file_abort(&session->file);
+    }
+    delete self->write_sessions;
+    self->write_sessions = nullptr;
+  }
+
+  if (self->watcher != nullptr) {
+    // Watch streams live on the main loop and hold no plugin reference
+    if (self->watcher->fd_source != 0) {
+      g_source_remove(self->watcher->fd_source);
+    }
+    if (self->watcher->flush_source != 0) {
+      g_source_remove(self->watcher->flush_source);
+    }
+    if (self->watcher->fd >= 0) {
+      close(self->watcher->fd);
+    }
+    delete self->watcher;
+    self->watcher = nullptr;
+  }
+
+  if (self->streams != nullptr) {
+    // Other streams hold a plugin reference while running, so only watch
+    // streams can be left here
+    delete self->streams;
+    self->streams = nullptr;
+  }
+
+  if (self->dispatcher != nullptr) {
+    if (self->dispatcher->pool != nullptr) {
+      g_thread_pool_free(self->dispatcher->pool, FALSE, TRUE);
+    }
+    delete self->dispatcher;
+    self->dispatcher = nullptr;
+  }
+
+  if (self->dirs != nullptr) {
+    delete self->dirs;
+    self->dirs = nullptr;
+  }
+
+  if (self->digests != nullptr) {
+    delete self->digests;
+    self->digests = nullptr;
+  }
+
+  if (self->stats != nullptr) {
+    delete self->stats;
+    self->stats = nullptr;
+  }
+
+  // Probes still blocked on a dead mount keep their own reference
+  if (self->validations != nullptr) {
+    delete self->validations;
+    self->validations = nullptr;
+  }
+
+  if (self->usage != nullptr) {
+    delete self->usage;
+    self->usage = nullptr;
+  }
+
+  if (self->store != nullptr) {
+    {
+      // Nothing queued for write-behind may be lost on shutdown
+      std::lock_guard<std::recursive_mutex> lock(self->store->mutex);
+      if (!store_flush(self)) {
+        g_warning("directory_bookmarks: failed to write pending bookmark changes");
+      }
+    }
+    bookmark_store_free(self->store);
+    self->store = nullptr;
+  }
+
   G_OBJECT_CLASS(directory_bookmarks_plugin_parent_class)->dispose(object);
 }
 
@@ -733,7 +8848,37 @@ static void directory_bookmarks_plugin_class_init(DirectoryBookmarksPluginClass*
   G_OBJECT_CLASS(klass)->dispose = directory_bookmarks_plugin_dispose;
 }
 
-static void directory_bookmarks_plugin_init(DirectoryBookmarksPlugin* self) {}
+static void directory_bookmarks_plugin_init(DirectoryBookmarksPlugin* self) {
+  self->store = bookmark_store_new();
+  self->dispatcher = new Dispatcher();
+  self->dispatcher->max_threads = CLAMP(g_get_num_processors(), 2, 8);
+  self->streams = new EventStreams();
+  self->dirs = new BookmarkDirs();
+  self->write_sessions = new WriteSessions();
+  self->watcher = new Watcher();
+  self->digests = new DigestCache();
+  self->stats = new CallStats();
+  self->stats->since_us = g_get_real_time();
+  self->validations = new Validations();
+  self->usage = new UsageCache();
+}
+
+static FlMethodErrorResponse* events_listen_cb(FlEventChannel* channel, FlValue* args,
+                                               gpointer user_data) {
+  DirectoryBookmarksPlugin* self = DIRECTORY_BOOKMARKS_PLUGIN(user_data);
+  self->events_listening = true;
+  return nullptr;
+}
+
+static FlMethodErrorResponse* events_cancel_cb(FlEventChannel* channel, FlValue* args,
+                                               gpointer user_data) {
+  DirectoryBookmarksPlugin* self = DIRECTORY_BOOKMARKS_PLUGIN(user_data);
+  self->events_listening = false;
+
+  // Nobody is left to receive results
+  streams_cancel_all(self);
+  return nullptr;
+}
 
 static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
                           gpointer user_data) {
@@ -754,5 +8899,106 @@ void directory_bookmarks_plugin_register_with_registrar(FlPluginRegistrar* regis
                                            g_object_ref(plugin),
                                            g_object_unref);
 
+  fl_binary_messenger_set_message_handler_on_channel(
+      fl_plugin_registrar_get_messenger(registrar),
+      "com.example.directory_bookmarks/binary",
+      binary_message_cb, g_object_ref(plugin), g_object_unref);
+
+  // The plugin owns the events channel, so the handlers borrow it unreferenced
+  plugin->events = fl_event_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                                        "com.example.directory_bookmarks/events",
+                                        FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(plugin->events, events_listen_cb, events_cancel_cb,
+                                       plugin, nullptr);
+
+  {
+    std::unique_lock<std::shared_mutex> lock(ffi_mutex);
+    ffi_plugin = plugin;
+  }
+
   g_object_unref(plugin);
 }
+
+// Synchronous C ABI for dart:ffi.
+//
+// These run on the calling (Dart) thread against the same resident store
+// and directory handles as the method channel, which their locking already
+// allows. Only read-only queries are offered; anything that mutates or may
+// block for long stays on the channel.
+
+int32_t directory_bookmarks_ffi_version(void) {
+  return 2;
+}
+
+void* directory_bookmarks_ffi_alloc(size_t size) {
+  return g_malloc(size);
+}
+
+void directory_bookmarks_ffi_free(void* pointer) {
+  g_free(pointer);
+}
+
+int32_t directory_bookmarks_ffi_bookmark_exists(const char* identifier) {
+  std::shared_lock<std::shared_mutex> lock(ffi_mutex);
+  if (ffi_plugin == nullptr) {
+    return -1;
+  }
+
+  std::lock_guard<std::recursive_mutex> store_lock(ffi_plugin->store->mutex);
+  return store_find(ffi_plugin, identifier) != nullptr ? 1 : 0;
+}
+
+int32_t directory_bookmarks_ffi_get_bookmark(const char* identifier, char** encoded_json,
+                                             size_t* length) {
+  std::shared_lock<std::shared_mutex> lock(ffi_mutex);
+  *encoded_json = nullptr;
+  *length = 0;
+  if (ffi_plugin == nullptr) {
+    return -1;
+  }
+
+  std::string encoded;
+  {
+    std::lock_guard<std::recursive_mutex> store_lock(ffi_plugin->store->mutex);
+    const json* bookmark = store_find(ffi_plugin, identifier);
+    if (bookmark == nullptr) {
+      return 0;
+    }
+
+    // Same shape as the getBookmark method result
+    auto field = [bookmark](const char* key) {
+      auto it = bookmark->find(key);
+      return it != bookmark->end() && it->is_string() ? *it : json("");
+    };
+    auto metadata = bookmark->find("metadata");
+    encoded = json{
+      {"identifier", field("id")},
+      {"path", field("path")},
+      {"createdAt", field("createdAt")},
+      {"metadata", metadata != bookmark->end() && metadata->is_object() ? *metadata
+                                                                       : json::object()},
+    }.dump();
+  }
+
+  *length = encoded.size();
+  *encoded_json = g_strndup(encoded.data(), encoded.size());
+  return 1;
+}
+
+int32_t directory_bookmarks_ffi_file_exists(const char* identifier, const char* file_name) {
+  std::shared_lock<std::shared_mutex> lock(ffi_mutex);
+  if (ffi_plugin == nullptr) {
+    return -1;
+  }
+
+  return bookmark_file_exists(ffi_plugin, identifier, file_name) ? 1 : 0;
+}
+
+int32_t directory_bookmarks_ffi_has_write_permission(const char* identifier) {
+  std::shared_lock<std::shared_mutex> lock(ffi_mutex);
+  if (ffi_plugin == nullptr) {
+    return -1;
+  }
+
+  return bookmark_writable(ffi_plugin, identifier) ? 1 : 0;
+}
@@ -2,6 +2,8 @@
 #define FLUTTER_PLUGIN_DIRECTORY_BOOKMARKS_PLUGIN_H_
 
 #include <flutter_linux/flutter_linux.h>
+#include <stddef.h>
+#include <stdint.h>
 
 G_BEGIN_DECLS
 
@@ -21,6 +23,36 @@ FLUTTER_PLUGIN_EXPORT GType directory_bookmarks_plugin_get_type();
 FLUTTER_PLUGIN_EXPORT void directory_bookmarks_plugin_register_with_registrar(
     FlPluginRegistrar* registrar);
 
+// Synchronous C ABI used through dart:ffi for hot read-only lookups.
+//
+// Strings are NUL-terminated UTF-8. Functions returning int32_t give 1 for
+// true, 0 for false and -1 when no plugin instance is registered, in which
+// case callers should fall back to the method channel. Buffers passed in or
+// returned are allocated with directory_bookmarks_ffi_alloc and released
+// with directory_bookmarks_ffi_free.
+
+// Bumped whenever a signature below changes
+FLUTTER_PLUGIN_EXPORT int32_t directory_bookmarks_ffi_version(void);
+
+FLUTTER_PLUGIN_EXPORT void* directory_bookmarks_ffi_alloc(size_t size);
+FLUTTER_PLUGIN_EXPORT void directory_bookmarks_ffi_free(void* pointer);
+
+FLUTTER_PLUGIN_EXPORT int32_t directory_bookmarks_ffi_bookmark_exists(const char* identifier);
+
+// On 1, `json` receives the bookmark as a JSON object shaped like the
+// getBookmark result and `length` its byte length; release it with
+// directory_bookmarks_ffi_free. On 0 (no such bookmark) or -1, `json` is set
+// to NULL.
+FLUTTER_PLUGIN_EXPORT int32_t directory_bookmarks_ffi_get_bookmark(const char* identifier,
+                                                                   char** json,
+                                                                   size_t* length);
+
+FLUTTER_PLUGIN_EXPORT int32_t directory_bookmarks_ffi_file_exists(const char* identifier,
+                                                                  const char* file_name);
+
+FLUTTER_PLUGIN_EXPORT int32_t directory_bookmarks_ffi_has_write_permission(
+    const char* identifier);
+
 G_END_DECLS
 
 #endif  // FLUTTER_PLUGIN_DIRECTORY_BOOKMARKS_PLUGIN_H_
@@ -0,0 +1,150 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:directory_bookmarks/directory_bookmarks.dart';
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+// Must match kBinaryRequestHeaderSize and the offsets binary_handle_request
+// reads in linux/directory_bookmarks_plugin.cc
+const _channel = 'com.example.directory_bookmarks/binary';
+const _requestHeaderSize = 32;
+const _responseHeaderSize = 8;
+
+/// A decoded request header, read exactly as the native side does
+class _Request {
+  final Uint8List bytes;
+  late final ByteData _header = ByteData.sublistView(bytes, 0, _requestHeaderSize);
+
+  _Request(this.bytes);
+
+  int get op => _header.getUint8(0);
+  int get compression => _header.getUint8(1);
+  int get level => _header.getUint8(2);
+  int get durability => _header.getUint8(3);
+  int get identifierLength => _header.getUint32(4, Endian.little);
+  int get nameLength => _header.getUint32(8, Endian.little);
+  int get reserved => _header.getUint32(12, Endian.little);
+  int get offset => _header.getInt64(16, Endian.little);
+  int get length => _header.getInt64(24, Endian.little);
+
+  String get identifier => utf8.decode(bytes.sublist(
+      _requestHeaderSize, _requestHeaderSize + identifierLength));
+  String get name => utf8.decode(bytes.sublist(
+      _requestHeaderSize + identifierLength,
+      _requestHeaderSize + identifierLength + nameLength));
+  Uint8List get payload =>
+      bytes.sublist(_requestHeaderSize + identifierLength + nameLength);
+}
+
+ByteData _response(int status, [List<int> body = const []]) {
+  final bytes = Uint8List(_responseHeaderSize + body.length);
+  bytes[0] = status;
+  bytes.setRange(_responseHeaderSize, bytes.length, body);
+  return ByteData.sublistView(bytes);
+}
+
+void main() {
+  TestWidgetsFlutterBinding.ensureInitialized();
+  final messenger =
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger;
+
+  late List<_Request> requests;
+  ByteData reply = _response(0);
+
+  setUp(() {
+    debugDefaultTargetPlatformOverride = TargetPlatform.linux;
+    requests = [];
+    reply = _response(0);
+    messenger.setMockMessageHandler(_channel, (message) async {
+      requests.add(_Request(Uint8List.fromList(message!.buffer
+          .asUint8List(message.offsetInBytes, message.lengthInBytes))));
+      return reply;
+    });
+  });
+
+  tearDown(() {
+    messenger.setMockMessageHandler(_channel, null);
+    debugDefaultTargetPlatformOverride = null;
+  });
+
+  test('writes put op, options and lengths at fixed little-endian offsets',
+      () async {
+    expect(
+      await PlatformHandler.saveFile('bookmark', 'dir/é.bin', [1, 2, 3, 4],
+          compression: FileCompression.gzip,
+          compressionLevel: 6,
+          durability: FileDurability.durable),
+      isTrue,
+    );
+
+    final request = requests.single;
+    expect(request.bytes.length,
+        _requestHeaderSize + 'bookmark'.length + utf8.encode('dir/é.bin').length + 4);
+    expect(request.op, 2);
+    expect(request.compression, FileCompression.gzip.index);
+    expect(request.level, 6);
+    // Durability index plus one; 0 means the configured default
+    expect(request.durability, FileDurability.durable.index + 1);
+    expect(request.identifierLength, 8);
+    expect(request.nameLength, utf8.encode('dir/é.bin').length);
+    expect(request.reserved, 0);
+    expect(request.offset, 0);
+    expect(request.length, -1);
+    expect(request.identifier, 'bookmark');
+    expect(request.name, 'dir/é.bin');
+    expect(request.payload, [1, 2, 3, 4]);
+  });
+
+  test('writes without options leave their header bytes zero', () async {
+    await PlatformHandler.saveFile('b', 'f', const []);
+
+    final request = requests.single;
+    expect(request.bytes.sublist(0, 4), [2, 0, 0, 0]);
+    expect(request.payload, isEmpty);
+  });
+
+  test('range reads carry the offset and length as 64-bit values', () async {
+    reply = _response(0, [9, 8, 7]);
+    final data =
+        await PlatformHandler.readFileRange('b', 'f', 0x100000002, 0x30000);
+
+    expect(data, [9, 8, 7]);
+    final request = requests.single;
+    expect(request.op, 1);
+    expect(request.offset, 0x100000002);
+    expect(request.length, 0x30000);
+    expect(request.bytes.sublist(16, 32),
+        [2, 0, 0, 0, 1, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0]);
+    expect(request.payload, isEmpty);
+  });
+
+  test('whole-file reads ask for length -1', () async {
+    await PlatformHandler.readFile('b', 'f',
+        compression: FileCompression.gzip);
+
+    final request = requests.single;
+    expect(request.op, 1);
+    expect(request.compression, FileCompression.gzip.index);
+    expect(request.length, -1);
+    expect(request.bytes.sublist(24, 32), List.filled(8, 0xff));
+  });
+
+  test('response statuses map to results and exceptions', () async {
+    reply = _response(1);
+    expect(await PlatformHandler.readFile('b', 'missing'), isNull);
+
+    reply = _response(2, utf8.encode("Bookmark with identifier 'b' not found"));
+    await expectLater(PlatformHandler.readFile('b', 'f'),
+        throwsA(isA<BookmarkNotFoundException>()));
+
+    reply = _response(5, utf8.encode('Input/output error'));
+    await expectLater(
+      PlatformHandler.readFile('b', 'f'),
+      throwsA(isA<PlatformException>()
+          .having((e) => e.code, 'code', 'READ_ERROR')
+          .having((e) => e.message, 'message', 'Input/output error')),
+    );
+  });
+}
@@ -0,0 +1,90 @@
+import 'package:directory_bookmarks/directory_bookmarks.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+void main() {
+  group('MetadataPatch.toJson', () {
+    test('set carries its value, including nested values', () {
+      expect(const MetadataPatch.set('tags', ['a', 'b']).toJson(), {
+        'op': 'set',
+        'key': 'tags',
+        'value': ['a', 'b'],
+      });
+      expect(
+        const MetadataPatch.set('owner', {'name': 'x', 'id': 7}).toJson(),
+        {
+          'op': 'set',
+          'key': 'owner',
+          'value': {'name': 'x', 'id': 7},
+        },
+      );
+    });
+
+    test('set keeps an explicit null value', () {
+      final json = const MetadataPatch.set('note', null).toJson();
+      expect(json.containsKey('value'), isTrue);
+      expect(json['value'], isNull);
+    });
+
+    test('remove has no value', () {
+      expect(const MetadataPatch.remove('note').toJson(), {
+        'op': 'remove',
+        'key': 'note',
+      });
+    });
+
+    test('increment defaults to 1', () {
+      expect(const MetadataPatch.increment('opens').toJson(), {
+        'op': 'increment',
+        'key': 'opens',
+        'value': 1,
+      });
+      expect(const MetadataPatch.increment('size', -2.5).toJson()['value'], -2.5);
+    });
+
+    test('patchBookmarkMetadata batch operations encode each patch', () {
+      final operation = BatchOperation.patchBookmarkMetadata('id', const [
+        MetadataPatch.set('k', 'v'),
+        MetadataPatch.remove('old'),
+      ]);
+      expect(operation.toJson(), {
+        'method': 'patchBookmarkMetadata',
+        'arguments': {
+          'identifier': 'id',
+          'operations': [
+            {'op': 'set', 'key': 'k', 'value': 'v'},
+            {'op': 'remove', 'key': 'old'},
+          ],
+        },
+      });
+    });
+  });
+
+  group('BatchResult.fromJson', () {
+    test('a result without an error code is a success', () {
+      final result = BatchResult.fromJson(const {
+        'result': {'identifier': 'id', 'path': '/tmp'},
+      });
+      expect(result.isSuccess, isTrue);
+      expect(result.value, {'identifier': 'id', 'path': '/tmp'});
+      expect(result.errorCode, isNull);
+      expect(result.errorMessage, isNull);
+    });
+
+    test('a null result is still a success', () {
+      final result = BatchResult.fromJson(const {'result': null});
+      expect(result.isSuccess, isTrue);
+      expect(result.value, isNull);
+    });
+
+    test('an error code marks a failure', () {
+      final result = BatchResult.fromJson(const {
+        'errorCode': 'BOOKMARK_NOT_FOUND',
+        'errorMessage': "Bookmark with identifier 'x' not found",
+      });
+      expect(result.isSuccess, isFalse);
+      expect(result.value, isNull);
+      expect(result.errorCode, 'BOOKMARK_NOT_FOUND');
+      expect(result.errorMessage, "Bookmark with identifier 'x' not found");
+    });
+  });
+}